@@ -48,6 +48,7 @@
 #include "openlcb/If.hxx"
 #include "openlcb/AliasAllocator.hxx"
 #include "openlcb/DefaultNode.hxx"
+#include "openlcb/MemoryConfig.hxx"
 #include "openlcb/NodeInitializeFlow.hxx"
 #include "utils/socket_listener.hxx"
 
@@ -60,11 +61,15 @@ CanHubFlow can_hub0(&g_service);
 
 static const openlcb::NodeID NODE_ID = 0x05010101181FULL;
 
+/// How many nodes can be updated at the same time at most (-j).
+static const unsigned MAX_PARALLEL = 8;
+
 openlcb::IfCan g_if_can(&g_executor, &can_hub0, 3, 3, 2);
 openlcb::InitializeFlow g_init_flow{&g_service};
-openlcb::CanDatagramService g_datagram_can(&g_if_can, 10, 2);
+openlcb::CanDatagramService g_datagram_can(&g_if_can, 10, MAX_PARALLEL);
 static openlcb::AddAliasAllocator g_alias_allocator(NODE_ID, &g_if_can);
 openlcb::DefaultNode g_node(&g_if_can, NODE_ID);
+openlcb::MemoryConfigHandler g_memcfg(&g_datagram_can, &g_node, 3);
 
 namespace openlcb
 {
@@ -77,8 +82,9 @@ const char *host = "localhost";
 const char *device_path = nullptr;
 const char *filename = nullptr;
 const char *dump_filename = nullptr;
-uint64_t destination_nodeid = 0;
-uint64_t destination_alias = 0;
+std::vector<openlcb::NodeHandle> destinations;
+unsigned parallel = 4;
+bool delta = false;
 int memory_space_id = openlcb::MemoryConfigDefs::SPACE_FIRMWARE;
 const char *checksum_algorithm = nullptr;
 bool request_reboot = false;
@@ -93,8 +99,8 @@ void usage(const char *e)
     fprintf(stderr,
         "Usage: %s ([-i destination_host] [-p port] | [-d device_path]) [-s "
         "memory_space_id] [-c csum_algo [-m hw_magic] [-M hw_magic2]] [-r] [-t] [-x] "
-        "[-w dg_timeout] [-W stream_timeout] [-D dump_filename] "
-        "(-n nodeid | -a alias) -f filename\n",
+        "[-w dg_timeout] [-W stream_timeout] [-D dump_filename] [-j parallel] "
+        "[-u] (-n nodeid | -a alias)... -f filename\n",
         e);
     fprintf(stderr, "Connects to an openlcb bus and performs the "
                     "bootloader protocol on openlcb node with id nodeid with "
@@ -112,6 +118,17 @@ void usage(const char *e)
     fprintf(stderr,
         "\n\talias should be a 3-char hex string with 0x prefix and no "
         "separators, like '-a 0x3F9'\n");
+    fprintf(stderr,
+        "\n\t-n and -a can be given multiple times to update many nodes "
+        "with the same file.\n");
+    fprintf(stderr,
+        "\n\t-j parallel sets how many nodes are updated at the same time "
+        "(1..%u, default 4).\n",
+        MAX_PARALLEL);
+    fprintf(stderr,
+        "\n\t-u reads back the page checksums from the target and only "
+        "writes the pages that changed. Targets that do not support it get "
+        "the entire file.\n");
     fprintf(stderr,
         "\n\tmemory_space_id defines which memory space to write the "
         "data into. Default is '-s 0xEF'.\n");
@@ -137,7 +154,7 @@ void usage(const char *e)
 void parse_args(int argc, char *argv[])
 {
     int opt;
-    while ((opt = getopt(argc, argv, "hp:i:rtd:n:a:s:f:c:m:M:xw:W:D:")) >= 0)
+    while ((opt = getopt(argc, argv, "hp:i:rtd:n:a:s:f:c:m:M:xw:W:D:j:u")) >= 0)
     {
         switch (opt)
         {
@@ -160,10 +177,18 @@ void parse_args(int argc, char *argv[])
                 dump_filename = optarg;
                 break;
             case 'n':
-                destination_nodeid = strtoll(optarg, nullptr, 16);
+                destinations.emplace_back(
+                    openlcb::NodeID(strtoll(optarg, nullptr, 16)));
                 break;
             case 'a':
-                destination_alias = strtoul(optarg, nullptr, 16);
+                destinations.emplace_back(
+                    openlcb::NodeAlias(strtoul(optarg, nullptr, 16)));
+                break;
+            case 'j':
+                parallel = atoi(optarg);
+                break;
+            case 'u':
+                delta = true;
                 break;
             case 's':
                 memory_space_id = strtol(optarg, nullptr, 16);
@@ -197,14 +222,18 @@ void parse_args(int argc, char *argv[])
                 usage(argv[0]);
         }
     }
-    if (!filename || (!destination_nodeid && !destination_alias && !dump_filename))
+    if (!filename || (destinations.empty() && !dump_filename))
+    {
+        usage(argv[0]);
+    }
+    if (parallel < 1 || parallel > MAX_PARALLEL)
     {
         usage(argv[0]);
     }
 }
 
 openlcb::BootloaderClient bootloader_client(
-    &g_node, &g_datagram_can, &g_if_can);
+    &g_node, &g_datagram_can, &g_if_can, &g_memcfg);
 openlcb::BootloaderResponse response;
 
 void maybe_checksum(string *firmware)
@@ -311,23 +340,30 @@ void maybe_checksum(string *firmware)
     }
 }
 
+/// Fills in a request from the command line arguments, except the
+/// destination.
+void fill_request_template(openlcb::BootloaderRequest *r)
+{
+    r->memory_space = memory_space_id;
+    r->offset = 0;
+    r->response = &response;
+    r->request_reboot = request_reboot ? 1 : 0;
+    r->request_reboot_after = request_reboot_after ? 1 : 0;
+    r->skip_pip = skip_pip ? 1 : 0;
+    r->delta = delta ? 1 : 0;
+    r->data = read_file_to_string(filename);
+    printf("Read %zu bytes from file %s.\n", r->data.size(), filename);
+    maybe_checksum(&r->data);
+}
+
+/// @return a request for the (first) destination node.
 Buffer<openlcb::BootloaderRequest> *fill_request()
 {
     Buffer<openlcb::BootloaderRequest> *b;
     mainBufferPool->alloc(&b);
 
-    b->data()->dst.alias = destination_alias;
-    b->data()->dst.id = destination_nodeid;
-    b->data()->memory_space = memory_space_id;
-    b->data()->offset = 0;
-    b->data()->response = &response;
-    b->data()->request_reboot = request_reboot ? 1 : 0;
-    b->data()->request_reboot_after = request_reboot_after ? 1 : 0;
-    b->data()->skip_pip = skip_pip ? 1 : 0;
-    b->data()->data = read_file_to_string(filename);
-    printf("Read %" PRIdPTR " bytes from file %s.\n", b->data()->data.size(),
-        filename);
-    maybe_checksum(&b->data()->data);
+    fill_request_template(b->data());
+    b->data()->dst = destinations[0];
 
     return b;
 }
@@ -108,6 +108,30 @@ private:
     int fd_; ///< file descriptor for the connection
 };
 
+/// Updates all nodes given on the command line, some of them in parallel.
+/// @return 0 if all nodes were successfully updated.
+int update_fleet()
+{
+    openlcb::BootloaderFleet fleet(
+        &g_node, &g_datagram_can, &g_if_can, &g_memcfg, parallel);
+    openlcb::BootloaderRequest tmpl;
+    fill_request_template(&tmpl);
+    auto b = invoke_flow(&fleet, destinations, tmpl,
+        [](openlcb::BootloaderFleetRequest *r, unsigned i) {
+            const auto &dst = r->nodes[i];
+            const auto &resp = r->responses[i];
+            printf("Node %012" PRIx64 " (alias %03x): result %04x %s, "
+                   "%u bytes written\n",
+                dst.id, dst.alias, resp.error_code,
+                resp.error_details.c_str(), (unsigned)resp.bytes_written);
+        });
+    printf("Updated %u nodes, %u failed.\n",
+        (unsigned)(destinations.size() - b->data()->num_failed),
+        b->data()->num_failed);
+    exit(b->data()->num_failed ? 1 : 0);
+    return 0;
+}
+
 /** Entry point to application.
  * @param argc number of command line arguments
  * @param argv array of command line arguments
@@ -129,12 +153,16 @@ int appl_main(int argc, char *argv[])
     g_executor.start_thread("g_executor", 0, 1024);
     usleep(400000);
 
+    if (destinations.size() > 1)
+    {
+        return update_fleet();
+    }
+
     SyncNotifiable n;
     BarrierNotifiable bn(&n);
     Buffer<openlcb::BootloaderRequest> *b = fill_request();
 
     b->set_done(&bn);
-    maybe_checksum(&b->data()->data);
 
     bootloader_client.send(b);
     n.wait_for_notification();
@@ -42,7 +42,7 @@
 #include "openlcb/EventHandlerTemplates.hxx"
 #include "dcc/Loco.hxx"
 #include "dcc/Logon.hxx"
-#include "dcc/SimpleUpdateLoop.hxx"
+#include "dcc/PriorityUpdateLoop.hxx"
 #include "dcc/LocalTrackIf.hxx"
 #include "dcc/RailcomHub.hxx"
 #include "dcc/RailcomPortDebug.hxx"
@@ -142,7 +142,7 @@ public:
 OVERRIDE_CONST(num_memory_spaces, 10);
 
 dcc::LocalTrackIf track(stack.service(), 2);
-dcc::SimpleUpdateLoop updateLoop(stack.service(), &track);
+dcc::PriorityUpdateLoop updateLoop(stack.service(), &track);
 PoolToQueueFlow<Buffer<dcc::Packet>> pool_translator(
     stack.service(), track.pool(), &updateLoop);
 
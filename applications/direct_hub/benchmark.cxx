@@ -0,0 +1,234 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file benchmark.cxx
+ *
+ * Fan-out benchmark for the DirectHub. Connects a growing number of local
+ * clients to the hub, sends timestamped GridConnect frames from one of them,
+ * and measures the throughput and the latency at which the frames arrive at
+ * all the other clients.
+ *
+ * @author Balazs Racz
+ * @date 17 Oct 2026
+ */
+
+#include <algorithm>
+#include <memory>
+#include <poll.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#include "executor/Notifiable.hxx"
+#include "os/OS.hxx"
+#include "utils/DirectHub.hxx"
+#include "utils/FdUtils.hxx"
+#include "utils/StringPrintf.hxx"
+
+namespace
+{
+
+/// Length of one benchmark frame on the wire: ":X195B4111N" + 16 hex digits
+/// + ";".
+static constexpr unsigned FRAME_LEN = 11 + 16 + 1;
+
+/// How long a receiver waits for missing data before giving up.
+static constexpr int RECEIVE_TIMEOUT_MSEC = 5000;
+
+/// Reads benchmark frames from the client end of one hub port, and records
+/// the fan-out latency of each frame.
+class BenchmarkReceiver : public OSThread
+{
+public:
+    /// @param fd client end of the socket.
+    /// @param expected number of frames to wait for.
+    BenchmarkReceiver(int fd, unsigned expected)
+        : fd_(fd)
+        , expected_(expected)
+    {
+        latencies_.reserve(expected);
+    }
+
+    /// Blocks until the receiver thread is done.
+    void wait()
+    {
+        done_.wait();
+    }
+
+    /// Frame latencies seen, in nanoseconds.
+    std::vector<long long> latencies_;
+
+private:
+    void *entry() override
+    {
+        char buf[4096];
+        string partial;
+        while (latencies_.size() < expected_)
+        {
+            struct pollfd pfd = {fd_, POLLIN, 0};
+            if (::poll(&pfd, 1, RECEIVE_TIMEOUT_MSEC) <= 0)
+            {
+                break;
+            }
+            ssize_t ret = ::read(fd_, buf, sizeof(buf));
+            if (ret <= 0)
+            {
+                break;
+            }
+            long long now = os_get_time_monotonic();
+            partial.append(buf, ret);
+            size_t ofs = 0;
+            while (true)
+            {
+                size_t start = partial.find(':', ofs);
+                if (start == string::npos)
+                {
+                    ofs = partial.size();
+                    break;
+                }
+                size_t end = partial.find(';', start);
+                if (end == string::npos)
+                {
+                    ofs = start;
+                    break;
+                }
+                if (end - start + 1 == FRAME_LEN)
+                {
+                    long long ts = strtoull(
+                        partial.substr(start + 11, 16).c_str(), nullptr, 16);
+                    latencies_.push_back(now - ts);
+                }
+                ofs = end + 1;
+            }
+            partial.erase(0, ofs);
+        }
+        done_.post();
+        return nullptr;
+    }
+
+    /// Client end of the socket.
+    int fd_;
+    /// How many frames we are waiting for.
+    unsigned expected_;
+    /// Posted when the thread exits.
+    OSSem done_;
+};
+
+/// Creates a socketpair, and attaches one end of it to the hub.
+/// @param hub the hub under test.
+/// @param done will get a child which is notified when the port exits.
+/// @return the client end of the socket.
+int create_client(ByteDirectHubInterface *hub, BarrierNotifiable *done)
+{
+    int fd[2];
+    ERRNOCHECK("socketpair", socketpair(AF_UNIX, SOCK_STREAM, 0, fd));
+    create_port_for_fd(hub, fd[0],
+        std::unique_ptr<MessageSegmenter>(create_gc_message_segmenter()),
+        done->new_child());
+    return fd[1];
+}
+
+/// Runs one round of the benchmark with a given number of clients.
+/// @param hub the hub under test.
+/// @param num_clients how many clients to connect, including the sender.
+/// @param num_frames how many frames the sender shall send.
+void run_round(
+    ByteDirectHubInterface *hub, unsigned num_clients, unsigned num_frames)
+{
+    SyncNotifiable ports_exited;
+    BarrierNotifiable bn(&ports_exited);
+    std::vector<int> fds;
+    for (unsigned i = 0; i < num_clients; ++i)
+    {
+        fds.push_back(create_client(hub, &bn));
+    }
+    std::vector<std::unique_ptr<BenchmarkReceiver>> receivers;
+    for (unsigned i = 1; i < num_clients; ++i)
+    {
+        receivers.emplace_back(new BenchmarkReceiver(fds[i], num_frames));
+        receivers.back()->start("bench_rx", 0, 2048);
+    }
+    // Gives the ports time to register with the hub.
+    usleep(50000);
+
+    static constexpr unsigned FRAMES_PER_WRITE = 16;
+    long long start = os_get_time_monotonic();
+    for (unsigned sent = 0; sent < num_frames; sent += FRAMES_PER_WRITE)
+    {
+        string chunk;
+        long long ts = os_get_time_monotonic();
+        for (unsigned i = 0; i < FRAMES_PER_WRITE && sent + i < num_frames;
+             ++i)
+        {
+            chunk += StringPrintf(":X195B4111N%016llX;", ts);
+        }
+        FdUtils::repeated_write(fds[0], chunk.data(), chunk.size());
+    }
+    for (auto &r : receivers)
+    {
+        r->wait();
+    }
+    long long elapsed = os_get_time_monotonic() - start;
+
+    std::vector<long long> all;
+    for (auto &r : receivers)
+    {
+        all.insert(all.end(), r->latencies_.begin(), r->latencies_.end());
+    }
+    std::sort(all.begin(), all.end());
+    long long p50 = all.empty() ? 0 : all[all.size() / 2];
+    long long p99 = all.empty() ? 0 : all[(all.size() * 99) / 100];
+    double fps = all.size() * 1e9 / (elapsed ? elapsed : 1);
+    printf("%8u %12zu %14.0f %12.1f %12.1f\n", num_clients, all.size(), fps,
+        p50 / 1000.0, p99 / 1000.0);
+    fflush(stdout);
+
+    for (int fd : fds)
+    {
+        ::close(fd);
+    }
+    bn.notify();
+    ports_exited.wait_for_notification();
+}
+
+} // namespace
+
+/// Runs the fan-out benchmark on a hub. The number of clients doubles in
+/// each round until max_clients is reached.
+/// @param hub the hub under test. Must not have any other ports.
+/// @param max_clients maximum number of clients to connect.
+/// @param num_frames how many frames to send in each round.
+void run_direct_hub_benchmark(
+    ByteDirectHubInterface *hub, unsigned max_clients, unsigned num_frames)
+{
+    printf("%8s %12s %14s %12s %12s\n", "clients", "frames rcvd",
+        "frames/sec", "p50 usec", "p99 usec");
+    for (unsigned n = 2; n <= max_clients; n *= 2)
+    {
+        run_round(hub, n, num_frames);
+    }
+}
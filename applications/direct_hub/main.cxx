@@ -39,6 +39,7 @@
 #include <unistd.h>
 
 #include <memory>
+#include <vector>
 
 #include "executor/Executor.hxx"
 #include "executor/Service.hxx"
@@ -52,7 +53,7 @@
 Executor<1> g_executor("g_executor", 0, 1024);
 Service g_service(&g_executor);
 
-std::unique_ptr<ByteDirectHubInterface> g_direct_hub {create_hub(&g_executor)};
+std::unique_ptr<ByteDirectHubInterface> g_direct_hub;
 
 CanHubFlow can_hub0(&g_service);
 
@@ -70,6 +71,12 @@ bool timestamped = false;
 bool export_mdns = false;
 const char *mdns_name = "openmrn_hub";
 bool printpackets = false;
+unsigned num_shards = 0;
+unsigned benchmark_clients = 0;
+unsigned benchmark_frames = 10000;
+
+void run_direct_hub_benchmark(
+    ByteDirectHubInterface *hub, unsigned max_clients, unsigned num_frames);
 
 void usage(const char *e)
 {
@@ -79,7 +86,7 @@ void usage(const char *e)
 #if defined(__linux__)
         "[-s socketcan_interface] "
 #endif
-        "[-t] [-l]\n\n",
+        "[-t] [-l] [-j shards] [-B max_clients] [-F frames]\n\n",
         e);
     fprintf(stderr,
         "GridConnect CAN HUB.\nListens to a specific TCP port, "
@@ -106,6 +113,15 @@ void usage(const char *e)
         "\t-q upstream_port   is the port number for the upstream hub.\n");
     fprintf(stderr, "\t-t prints timestamps for each packet.\n");
     fprintf(stderr, "\t-l print all packets.\n");
+    fprintf(stderr,
+        "\t-j shards   distributes the output ports across this many "
+        "executor threads.\n");
+    fprintf(stderr,
+        "\t-B max_clients   runs a fan-out benchmark with up to this many "
+        "local clients, then exits.\n");
+    fprintf(stderr,
+        "\t-F frames   number of frames to send in each benchmark round, "
+        "default is 10000.\n");
 #ifdef HAVE_AVAHI_CLIENT
     fprintf(stderr, "\t-m exports the current service on mDNS.\n");
     fprintf(
@@ -117,7 +133,7 @@ void usage(const char *e)
 void parse_args(int argc, char *argv[])
 {
     int opt;
-    while ((opt = getopt(argc, argv, "hp:d:s:u:q:tlmn:")) >= 0)
+    while ((opt = getopt(argc, argv, "hp:d:s:u:q:tlmn:j:B:F:")) >= 0)
     {
         switch (opt)
         {
@@ -154,6 +170,15 @@ void parse_args(int argc, char *argv[])
             case 'l':
                 printpackets = true;
                 break;
+            case 'j':
+                num_shards = atoi(optarg);
+                break;
+            case 'B':
+                benchmark_clients = atoi(optarg);
+                break;
+            case 'F':
+                benchmark_frames = atoi(optarg);
+                break;
             default:
                 fprintf(stderr, "Unknown option %c\n", opt);
                 usage(argv[0]);
@@ -161,6 +186,27 @@ void parse_args(int argc, char *argv[])
     }
 }
 
+/// Instantiates the hub, with output port sharding if requested on the
+/// command line.
+void create_direct_hub()
+{
+    if (num_shards > 0)
+    {
+        std::vector<ExecutorBase *> shards;
+        for (unsigned i = 0; i < num_shards; ++i)
+        {
+            // The shard executors are never destroyed.
+            shards.push_back(new Executor<1>("hub_shard", 0, 1024));
+        }
+        g_direct_hub.reset(
+            create_sharded_hub(&g_executor, shards.data(), num_shards));
+    }
+    else
+    {
+        g_direct_hub.reset(create_hub(&g_executor));
+    }
+}
+
 void create_legacy_bridge() {
     static bool is_created = false;
     if (!is_created) {
@@ -177,6 +223,13 @@ void create_legacy_bridge() {
 int appl_main(int argc, char *argv[])
 {
     parse_args(argc, argv);
+    create_direct_hub();
+    if (benchmark_clients)
+    {
+        run_direct_hub_benchmark(
+            g_direct_hub.get(), benchmark_clients, benchmark_frames);
+        return 0;
+    }
     // GcPacketPrinter packet_printer(&can_hub0, timestamped);
     GcPacketPrinter *packet_printer = NULL;
     if (printpackets)
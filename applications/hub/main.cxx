@@ -40,16 +40,24 @@
 #include <memory>
 
 #include "executor/Executor.hxx"
+#include "executor/MultiExecutor.hxx"
 #include "executor/Service.hxx"
 #include "os/os.h"
 #include "utils/ClientConnection.hxx"
 #include "utils/GcTcpHub.hxx"
 #include "utils/Hub.hxx"
 #include "utils/HubDeviceSelect.hxx"
+#include "utils/HubDeviceSelectBatch.hxx"
 #include "utils/SocketCan.hxx"
 #include "utils/constants.hxx"
 
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+/// The ports of the hub are processed on all CPU cores.
+MultiExecutor<1> g_executor(
+    "g_executor", 0, 1024, std::max(1L, sysconf(_SC_NPROCESSORS_ONLN)));
+#else
 Executor<1> g_executor("g_executor", 0, 1024);
+#endif
 Service g_service(&g_executor);
 CanHubFlow can_hub0(&g_service);
 
@@ -197,7 +205,7 @@ int appl_main(int argc, char *argv[])
         int s = socketcan_open(socket_can_path, 1);
         if (s >= 0)
         {
-            new HubDeviceSelect<CanHubFlow>(&can_hub0, s);
+            new HubDeviceSelectCanBatch(&can_hub0, s);
             fprintf(stderr, "Opened SocketCan %s: fd %d\n", socket_can_path, s);
         }
         else
@@ -58,7 +58,9 @@
 #include "openlcb/DefaultNode.hxx"
 #include "openlcb/NodeInitializeFlow.hxx"
 #include "openlcb/MemoryConfig.hxx"
+#include "openlcb/MemoryConfigBackup.hxx"
 #include "openlcb/MemoryConfigClient.hxx"
+#include "openlcb/StreamTransport.hxx"
 #include "utils/socket_listener.hxx"
 
 NO_THREAD nt;
@@ -70,9 +72,13 @@ OVERRIDE_CONST(gc_generate_newlines, 1);
 
 static const openlcb::NodeID NODE_ID = 0x05010101181FULL;
 
-openlcb::IfCan g_if_can(&g_executor, &can_hub0, 3, 3, 2);
+/// Maximum number of nodes to talk to in parallel in bulk mode.
+static constexpr unsigned MAX_PARALLEL = 16;
+
+openlcb::IfCan g_if_can(&g_executor, &can_hub0, 3, 300, 2);
 openlcb::InitializeFlow g_init_flow{&g_service};
-openlcb::CanDatagramService g_datagram_can(&g_if_can, 10, 2);
+openlcb::CanDatagramService g_datagram_can(&g_if_can, 10, MAX_PARALLEL);
+openlcb::StreamTransportCan g_stream_transport(&g_if_can, 1);
 static openlcb::AddAliasAllocator g_alias_allocator(NODE_ID, &g_if_can);
 openlcb::DefaultNode g_node(&g_if_can, NODE_ID);
 openlcb::MemoryConfigHandler g_memcfg(&g_datagram_can, &g_node, 10);
@@ -96,6 +102,12 @@ static uint32_t len = NLEN;
 static bool partial_read = false;
 static bool do_read = false;
 static bool do_write = false;
+/// All node IDs given on the command line, for the bulk operations.
+static std::vector<openlcb::NodeHandle> bulk_nodes;
+static const char *backup_filename = nullptr;
+static const char *restore_filename = nullptr;
+static unsigned parallel = 8;
+static bool use_stream = false;
 
 void usage(const char *e)
 {
@@ -104,6 +116,14 @@ void usage(const char *e)
         "memory_space_id] [-o offset] [-l len] [-c csum_algo] (-r|-w)  "
         "(-n nodeid | -a alias) -f filename\n",
         e);
+    fprintf(stderr,
+        "       %s ([-i destination_host] [-p port] | [-d serial_port]) [-s "
+        "memory_space_id] [-j parallel] [-S] (-n nodeid)... -B archive\n",
+        e);
+    fprintf(stderr,
+        "       %s ([-i destination_host] [-p port] | [-d serial_port]) [-j "
+        "parallel] -R archive\n",
+        e);
     fprintf(stderr,
         "Connects to an openlcb bus and performs memory configuration protocol "
         "operations on openlcb node with id `nodeid` with the contents of a "
@@ -124,6 +144,15 @@ void usage(const char *e)
         "data into. Default is '-s 0x%02x'.\n",
         openlcb::MemoryConfigDefs::SPACE_CONFIG);
     fprintf(stderr, "\t-r or -w  defines whether to read or write.\n");
+    fprintf(stderr,
+        "\t-B backs up the memory space of every node given with -n into "
+        "an archive file. -R writes the contents of an archive back to the "
+        "nodes.\n");
+    fprintf(stderr,
+        "\t-j sets how many nodes to talk to in parallel in -B and -R "
+        "mode (at most %u, default %u). -S reads using stream transport "
+        "from the nodes that support it.\n",
+        MAX_PARALLEL, parallel);
     fprintf(stderr,
         "\tIf offset and len are skipped for a read, then the entire memory "
         "space will be downloaded.\n");
@@ -136,7 +165,7 @@ void usage(const char *e)
 void parse_args(int argc, char *argv[])
 {
     int opt;
-    while ((opt = getopt(argc, argv, "hp:i:d:n:a:s:f:rwo:l:D")) >= 0)
+    while ((opt = getopt(argc, argv, "hp:i:d:n:a:s:f:rwo:l:DB:R:j:S")) >= 0)
     {
         switch (opt)
         {
@@ -157,6 +186,8 @@ void parse_args(int argc, char *argv[])
                 break;
             case 'n':
                 destination_nodeid = strtoll(optarg, nullptr, 16);
+                bulk_nodes.push_back(
+                    openlcb::NodeHandle(openlcb::NodeID(destination_nodeid)));
                 break;
             case 'a':
                 destination_alias = strtoul(optarg, nullptr, 16);
@@ -176,6 +207,18 @@ void parse_args(int argc, char *argv[])
             case 'w':
                 do_write = true;
                 break;
+            case 'B':
+                backup_filename = optarg;
+                break;
+            case 'R':
+                restore_filename = optarg;
+                break;
+            case 'j':
+                parallel = atoi(optarg);
+                break;
+            case 'S':
+                use_stream = true;
+                break;
 #ifdef __EMSCRIPTEN__
             case 'D':
                 JSSerialPort::list_ports();
@@ -186,6 +229,26 @@ void parse_args(int argc, char *argv[])
                 usage(argv[0]);
         }
     }
+    if (parallel < 1 || parallel > MAX_PARALLEL)
+    {
+        fprintf(stderr, "Parallel count must be between 1 and %u.\n\n",
+            MAX_PARALLEL);
+        usage(argv[0]);
+    }
+    if (backup_filename || restore_filename)
+    {
+        if (do_read || do_write || (backup_filename && restore_filename))
+        {
+            fprintf(stderr,
+                "Must set exactly one of options -r, -w, -B and -R.\n\n");
+            usage(argv[0]);
+        }
+        if (backup_filename && bulk_nodes.empty())
+        {
+            usage(argv[0]);
+        }
+        return;
+    }
     partial_read = do_read && ((offset != 0) || (len != NLEN));
     if ((!filename && !partial_read) ||
         (!destination_nodeid && !destination_alias))
@@ -214,6 +277,10 @@ public:
     /// Application business logic.
     Action send_request()
     {
+        if (backup_filename || restore_filename)
+        {
+            return call_immediately(STATE(send_bulk_request));
+        }
         openlcb::NodeHandle dst;
         dst.alias = destination_alias;
         dst.id = destination_nodeid;
@@ -258,6 +325,54 @@ public:
         return call_immediately(STATE(flow_done));
     }        
 
+    /// Starts a backup or restore of many nodes.
+    Action send_bulk_request()
+    {
+        bulk_.reset(new openlcb::MemoryConfigBackup(
+            &g_node, &g_memcfg, parallel, use_stream));
+        auto cb = [](openlcb::MemoryConfigBackupRequest *rq) {
+            printf("Done %u, failed %u\n", rq->num_ok, rq->num_failed);
+        };
+        if (backup_filename)
+        {
+            bulkFd_ = ::open(
+                backup_filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            HASSERT(bulkFd_ >= 0);
+            writer_.reset(new openlcb::MemoryConfigArchiveWriter(bulkFd_));
+            printf("Backing up memory space 0x%02x of %u nodes\n",
+                (unsigned)memory_space_id, (unsigned)bulk_nodes.size());
+            return invoke_subflow_and_wait(bulk_.get(), STATE(bulk_done),
+                openlcb::MemoryConfigBackupRequest::BACKUP, bulk_nodes,
+                std::vector<uint8_t> {(uint8_t)memory_space_id},
+                writer_.get(), std::move(cb));
+        }
+        bulkFd_ = ::open(restore_filename, O_RDONLY);
+        HASSERT(bulkFd_ >= 0);
+        reader_.reset(new openlcb::MemoryConfigArchiveReader(bulkFd_));
+        if (!reader_->valid())
+        {
+            fprintf(stderr, "%s is not a config archive.\n", restore_filename);
+            hasError_ = true;
+            return call_immediately(STATE(flow_done));
+        }
+        printf("Restoring from %s\n", restore_filename);
+        return invoke_subflow_and_wait(bulk_.get(), STATE(bulk_done),
+            openlcb::MemoryConfigBackupRequest::RESTORE, reader_.get(),
+            std::move(cb));
+    }
+
+    /// Invoked when a backup or restore is complete. Prints result and
+    /// terminates.
+    Action bulk_done()
+    {
+        auto b = get_buffer_deleter(full_allocation_result(bulk_.get()));
+        ::close(bulkFd_);
+        printf("Result: %04x, %u memory spaces done, %u failed\n",
+            b->data()->resultCode, b->data()->num_ok, b->data()->num_failed);
+        hasError_ = b->data()->resultCode != 0;
+        return call_immediately(STATE(flow_done));
+    }
+
     /// Invoked when a write operation is complete. Prints result and
     /// terminates.
     Action write_done() {
@@ -303,6 +418,12 @@ public:
 
     StateFlowTimer timer_{this};
     bool hasError_ = false;
+    /// Engine for the bulk operations.
+    std::unique_ptr<openlcb::MemoryConfigBackup> bulk_;
+    /// Archive file for the bulk operations.
+    int bulkFd_ = -1;
+    std::unique_ptr<openlcb::MemoryConfigArchiveWriter> writer_;
+    std::unique_ptr<openlcb::MemoryConfigArchiveReader> reader_;
 } helper_flow;
 
 
@@ -136,6 +136,16 @@ DECLARE_CONST(directhub_port_max_incoming_packets);
 /// will allocate at least this many bytes dedicated for each input port.
 DECLARE_CONST(directhub_port_incoming_buffer_size);
 
+/// Number of queue entries that can refer to a shared buffer at the same
+/// time. These are used by Hubs and Dispatchers to deliver a message to
+/// multiple shared ports without copying. See @ref MulticastEntry.
+DECLARE_CONST(multicast_entry_pool_size);
+
+/// How many free buffers each thread may cache per bucket size in the main
+/// buffer pool. 0 turns off the thread caches. See
+/// DynamicPool::set_thread_cache_size.
+DECLARE_CONST(buffer_pool_thread_cache_size);
+
 /** Number of entries in the remote alias cache */
 DECLARE_CONST(remote_alias_cache_size);
 
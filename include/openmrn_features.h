@@ -91,6 +91,26 @@
 #define OPENMRN_FEATURE_EXECUTOR_SELECT 1
 #endif
 
+#if defined(__linux__) && defined(OPENMRN_HAVE_PSELECT) &&                     \
+    !defined(__EMSCRIPTEN__)
+/// Uses a persistent epoll set instead of rebuilding fd_sets for ::pselect in
+/// the Executor. Makes select/unselect constant time and removes the
+/// FD_SETSIZE limit on the watched file descriptors.
+#define OPENMRN_FEATURE_EXECUTOR_EPOLL 1
+#endif
+
+#if (defined(__linux__) || defined(__MACH__)) && !defined(__EMSCRIPTEN__)
+/// Uses a lock-free queue (utils/MPSCQueue.hxx) for the input queue of the
+/// Executor. Adding to the executor from other threads does not take a mutex.
+#define OPENMRN_FEATURE_EXECUTOR_MPSC_QUEUE 1
+#endif
+
+#if (defined(__linux__) || defined(__MACH__)) && !defined(__EMSCRIPTEN__)
+/// Allows DynamicPool to keep per-thread caches of free buffers (see
+/// DynamicPool::set_thread_cache_size).
+#define OPENMRN_FEATURE_BUFFER_THREAD_CACHE 1
+#endif
+
 #if (defined(ARDUINO) && !defined(ESP_PLATFORM)) || defined(ESP_NONOS) ||      \
     defined(__EMSCRIPTEN__)
 /// A loop() function is calling the executor in the single-threaded OS context.
@@ -171,6 +191,18 @@
 
 #endif
 
+// OPENMRN_FEATURE_EVENT_REGISTRY_HASH is not defined by default. Add
+// -DOPENMRN_FEATURE_EVENT_REGISTRY_HASH to the compiler flags to make the
+// EventService use HashEventHandlers instead of TreeEventHandlers. This is
+// faster for nodes with thousands of single-event registrations, at the cost
+// of about 33% more RAM per registered event.
+
+// OPENMRN_FEATURE_ALIAS_CACHE_FLAT is not defined by default. Add
+// -DOPENMRN_FEATURE_ALIAS_CACHE_FLAT to the compiler flags to make IfCan use
+// FlatAliasCache for the remote alias cache. This makes alias lookups
+// constant time in large caches (gateways), at the cost of 8 kbytes for the
+// direct alias table and 8 bytes more RAM per cache entry.
+
 #if !defined(__MACH__)
 /// Compiles support for calling reboot() in ConfigUpdateFlow.hxx and
 /// MemoryConfig.cxx.
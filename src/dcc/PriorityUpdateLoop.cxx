@@ -0,0 +1,248 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file PriorityUpdateLoop.cxx
+ *
+ * Command station update loop that sends change notifications ahead of the
+ * background refresh and weights the refresh by source priority.
+ *
+ * @author Balazs Racz
+ * @date 17 Oct 2026
+ */
+
+#include "dcc/PriorityUpdateLoop.hxx"
+
+#include <algorithm>
+
+#include "dcc/Loco.hxx"
+#include "dcc/Packet.hxx"
+#include "dcc/PacketSource.hxx"
+
+namespace dcc
+{
+
+constexpr unsigned PriorityUpdateLoop::MAX_URGENT_IN_A_ROW;
+constexpr long long PriorityUpdateLoop::MIN_REFRESH_INTERVAL_NSEC;
+constexpr long long PriorityUpdateLoop::MAX_REFRESH_AGE_NSEC;
+
+PriorityUpdateLoop::PriorityUpdateLoop(Service *service, TrackIf *track_send)
+    : StateFlow(service)
+    , trackSend_(track_send)
+{
+}
+
+PriorityUpdateLoop::~PriorityUpdateLoop()
+{
+}
+
+bool PriorityUpdateLoop::add_refresh_source(
+    dcc::PacketSource *source, unsigned priority)
+{
+    OSMutexLock h(&lock_);
+    bool ret = exclusivePriority_ <= priority;
+    RefreshSource *s = find_source(source);
+    if (s)
+    {
+        s->priority = priority;
+    }
+    else
+    {
+        refreshSources_.push_back({source, priority, 0});
+    }
+    update_exclusive_priority();
+    return ret;
+}
+
+void PriorityUpdateLoop::remove_refresh_source(dcc::PacketSource *source)
+{
+    OSMutexLock h(&lock_);
+    refreshSources_.erase(std::remove_if(refreshSources_.begin(),
+                              refreshSources_.end(),
+                              [source](const RefreshSource &s)
+                              { return s.source == source; }),
+        refreshSources_.end());
+    urgent_.erase(std::remove_if(urgent_.begin(), urgent_.end(),
+                      [source](const UrgentEntry &e)
+                      { return e.source == source; }),
+        urgent_.end());
+    update_exclusive_priority();
+}
+
+void PriorityUpdateLoop::notify_update(PacketSource *source, unsigned code)
+{
+    OSMutexLock h(&lock_);
+    if (!find_source(source))
+    {
+        return;
+    }
+    for (const auto &e : urgent_)
+    {
+        if (e.source == source && e.code == code)
+        {
+            // The packet will be generated from the current state of the
+            // source, so a single pending entry is enough.
+            return;
+        }
+    }
+    if (code == ESTOP)
+    {
+        urgent_.push_front({source, code});
+    }
+    else
+    {
+        urgent_.push_back({source, code});
+    }
+}
+
+StateFlowBase::Action PriorityUpdateLoop::entry()
+{
+    PacketSource *source;
+    unsigned code = 0;
+    {
+        OSMutexLock h(&lock_);
+        source = choose_source(os_get_time_monotonic(), &code);
+    }
+    if (source)
+    {
+        source->get_next_packet(code, message()->data());
+    }
+    else
+    {
+        // Nothing is due: no locomotives at all, or the only ones were
+        // refreshed too recently.
+        message()->data()->set_dcc_idle();
+    }
+    // We pass on the filled packet to the track processor.
+    trackSend_->send(transfer_message());
+    return exit();
+}
+
+PacketSource *PriorityUpdateLoop::choose_source(long long now, unsigned *code)
+{
+    PacketSource *ret;
+    if (exclusivePriority_)
+    {
+        ret = choose_urgent(now, exclusivePriority_, code);
+        return ret ? ret : choose_refresh(now, exclusivePriority_, code);
+    }
+    if (urgentInARow_ >= MAX_URGENT_IN_A_ROW &&
+        (urgent_.empty() || urgent_.front().code != ESTOP))
+    {
+        urgentInARow_ = 0;
+        if ((ret = choose_refresh(now, 0, code)) != nullptr)
+        {
+            return ret;
+        }
+    }
+    if ((ret = choose_urgent(now, 0, code)) != nullptr)
+    {
+        ++urgentInARow_;
+        return ret;
+    }
+    urgentInARow_ = 0;
+    return choose_refresh(now, 0, code);
+}
+
+PacketSource *PriorityUpdateLoop::choose_urgent(
+    long long now, unsigned min_priority, unsigned *code)
+{
+    for (auto it = urgent_.begin(); it != urgent_.end(); ++it)
+    {
+        RefreshSource *s = find_source(it->source);
+        HASSERT(s);
+        if (s->priority < min_priority)
+        {
+            continue;
+        }
+        *code = it->code;
+        urgent_.erase(it);
+        s->lastSent = now;
+        return s->source;
+    }
+    return nullptr;
+}
+
+PacketSource *PriorityUpdateLoop::choose_refresh(
+    long long now, unsigned min_priority, unsigned *code)
+{
+    // Exclusive sources own every slot, so they are not rate limited.
+    bool rate_limit = min_priority < EXCLUSIVE_MIN_PRIORITY;
+    RefreshSource *best = nullptr;
+    long long best_score = -1;
+    for (auto &s : refreshSources_)
+    {
+        if (s.priority < min_priority)
+        {
+            continue;
+        }
+        long long age = std::min(now - s.lastSent, MAX_REFRESH_AGE_NSEC);
+        if (rate_limit && age < MIN_REFRESH_INTERVAL_NSEC)
+        {
+            continue;
+        }
+        long long score = age * (s.priority + 1);
+        if (score > best_score)
+        {
+            best = &s;
+            best_score = score;
+        }
+    }
+    if (!best)
+    {
+        return nullptr;
+    }
+    best->lastSent = now;
+    *code = 0;
+    return best->source;
+}
+
+PriorityUpdateLoop::RefreshSource *PriorityUpdateLoop::find_source(
+    PacketSource *source)
+{
+    for (auto &s : refreshSources_)
+    {
+        if (s.source == source)
+        {
+            return &s;
+        }
+    }
+    return nullptr;
+}
+
+void PriorityUpdateLoop::update_exclusive_priority()
+{
+    exclusivePriority_ = 0;
+    for (const auto &s : refreshSources_)
+    {
+        if (s.priority >= EXCLUSIVE_MIN_PRIORITY &&
+            s.priority > exclusivePriority_)
+        {
+            exclusivePriority_ = s.priority;
+        }
+    }
+}
+
+} // namespace dcc
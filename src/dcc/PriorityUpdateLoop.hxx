@@ -0,0 +1,201 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file PriorityUpdateLoop.hxx
+ *
+ * Command station update loop that sends change notifications ahead of the
+ * background refresh and weights the refresh by source priority.
+ *
+ * @author Balazs Racz
+ * @date 17 Oct 2026
+ */
+
+#ifndef _DCC_PRIORITYUPDATELOOP_HXX_
+#define _DCC_PRIORITYUPDATELOOP_HXX_
+
+#include <deque>
+#include <vector>
+
+#include "dcc/UpdateLoop.hxx"
+#include "executor/StateFlow.hxx"
+#include "os/OS.hxx"
+
+namespace dcc
+{
+
+/// Implementation of a command station update loop that is aware of changes
+/// and refresh source priorities.
+///
+/// - Every notify_update() call enqueues the (source, code) pair in an urgent
+///   queue. The next free packet slot is used for the front of this queue, so
+///   a speed or function change reaches the track within a few packets
+///   independent of how many locomotives are being refreshed. Pending
+///   duplicates are merged; emergency stop notifications jump the queue. To
+///   avoid starving the refresh when a throttle floods changes, every
+///   MAX_URGENT_IN_A_ROW urgent packets one refresh slot is inserted.
+///
+/// - Background refresh picks the source with the largest product of the time
+///   since its last packet and (priority + 1). Sources of equal priority are
+///   thus refreshed round-robin, higher priority sources proportionally more
+///   often, and a source that just got an urgent packet is deferred. The same
+///   source is not refreshed twice within MIN_REFRESH_INTERVAL_NSEC; an idle
+///   packet is sent instead.
+///
+/// - When a source with priority at least EXCLUSIVE_MIN_PRIORITY is
+///   registered (e.g. ESTOP_PRIORITY, PROGRAMMING_PRIORITY), all packet slots
+///   go to the registered source(s) with the highest priority. Notifications
+///   of other sources are held back until the exclusive source goes away.
+///
+/// Usage is the same as @ref SimpleUpdateLoop:
+///
+/// - Instantiate a state flow for sending outgoing dcc packets to the command
+///  station driver, usually dcc::LocalTrackIf.
+///
+/// - instantiate PriorityUpdateLoop, passing the LocalTrackIf pointer.
+///
+/// - send all packets from the track's pool to the updateloop using a
+///   PoolToQueueFlow.
+class PriorityUpdateLoop : public StateFlow<Buffer<dcc::Packet>, QList<1>>,
+                           private UpdateLoopBase
+{
+public:
+    /// Constructor.
+    /// @param service defines the executor to run on.
+    /// @param track_send where to forward the filled packets.
+    PriorityUpdateLoop(Service *service, TrackIf *track_send);
+    ~PriorityUpdateLoop();
+
+    /// Adds a new refresh source to the background refresh packets. Calling
+    /// again for an existing source updates its priority.
+    /// @param source the packet source.
+    /// @param priority refresh weight, or exclusive class (see @ref
+    /// UpdateLoopBase).
+    /// @return false if there is an exclusive source with higher priority
+    /// than the one being added.
+    bool add_refresh_source(
+        dcc::PacketSource *source, unsigned priority) OVERRIDE;
+
+    /// Deletes a packet refresh source, together with its pending
+    /// notifications. @param source the packet source.
+    void remove_refresh_source(dcc::PacketSource *source) OVERRIDE;
+
+    /// Enqueues an urgent packet for a source.
+    /// @param source a registered packet source. Notifications of unknown
+    /// sources are ignored.
+    /// @param code source-specific update code, non-zero.
+    void notify_update(PacketSource *source, unsigned code) OVERRIDE;
+
+    /// Entry to the state flow -- when a new packet needs to be sent.
+    Action entry() OVERRIDE;
+
+    /// @return the number of notifications waiting to be sent.
+    size_t pending_updates()
+    {
+        OSMutexLock h(&lock_);
+        return urgent_.size();
+    }
+
+    /// How many urgent packets may be sent back-to-back before a refresh
+    /// packet is inserted.
+    static constexpr unsigned MAX_URGENT_IN_A_ROW = 4;
+    /// Minimum time between two refresh packets of the same source.
+    static constexpr long long MIN_REFRESH_INTERVAL_NSEC = MSEC_TO_NSEC(5);
+    /// Refresh ages are clamped to this value in order to avoid overflow in
+    /// the weighting.
+    static constexpr long long MAX_REFRESH_AGE_NSEC = SEC_TO_NSEC(10);
+
+private:
+    /// Registered background refresh source.
+    struct RefreshSource
+    {
+        /// The packet source.
+        PacketSource *source;
+        /// Priority as given by add_refresh_source.
+        unsigned priority;
+        /// Monotonic time of the last packet from this source (either urgent
+        /// or refresh), 0 if never.
+        long long lastSent;
+    };
+
+    /// Entry in the urgent queue.
+    struct UrgentEntry
+    {
+        /// The packet source.
+        PacketSource *source;
+        /// Code to pass to get_next_packet.
+        unsigned code;
+    };
+
+    /// Chooses the source of the next outgoing packet. Must be called with
+    /// the lock held. The packet is generated after releasing the lock, so
+    /// that the packet source may call notify_update.
+    /// @param now current monotonic time.
+    /// @param code will be set to the code to pass to get_next_packet.
+    /// @return the source to generate the packet, or nullptr if there is
+    /// nothing to send.
+    PacketSource *choose_source(long long now, unsigned *code);
+
+    /// Takes the first pending notification whose source has at least the
+    /// given priority. @param now current time. @param min_priority priority
+    /// limit. @param code will be set to the notification code. @return the
+    /// source, or nullptr if there is no such notification.
+    PacketSource *choose_urgent(
+        long long now, unsigned min_priority, unsigned *code);
+
+    /// Chooses the best source with at least the given priority for a
+    /// background refresh packet. @param now current time. @param
+    /// min_priority priority limit. @param code will be set to the code of a
+    /// refresh packet. @return the source, or nullptr if no source is due.
+    PacketSource *choose_refresh(
+        long long now, unsigned min_priority, unsigned *code);
+
+    /// @return the registration of a source, or nullptr if not registered.
+    /// @param source the packet source to look up.
+    RefreshSource *find_source(PacketSource *source);
+
+    /// Recomputes exclusivePriority_ from the registered sources.
+    void update_exclusive_priority();
+
+    /// Protects the sources and the urgent queue. This is a mutex and not an
+    /// Atomic, because the queue may allocate memory and the scans are linear
+    /// in the number of sources; neither should run with interrupts
+    /// disabled.
+    OSMutex lock_;
+    /// Place where we forward the packets filled in.
+    TrackIf *trackSend_;
+    /// Packet sources to ask about refreshing data periodically.
+    std::vector<RefreshSource> refreshSources_;
+    /// Pending notifications, in the order they should be sent.
+    std::deque<UrgentEntry> urgent_;
+    /// Highest registered priority if that is an exclusive one, otherwise 0.
+    unsigned exclusivePriority_ {0};
+    /// How many urgent packets were sent since the last refresh packet.
+    unsigned urgentInARow_ {0};
+};
+
+} // namespace dcc
+
+#endif // _DCC_PRIORITYUPDATELOOP_HXX_
@@ -46,7 +46,9 @@ namespace dcc
 
 /// Implementation of a command station update loop. This loop iterates over
 /// all locomotive implementations and polls them for the next packet in a
-/// strict round-robin behavior (no prioritization).
+/// strict round-robin behavior (no prioritization). See @ref
+/// PriorityUpdateLoop for an implementation that reacts to change
+/// notifications and honors the source priorities.
 ///
 /// Usage:
 ///
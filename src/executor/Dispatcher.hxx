@@ -83,8 +83,11 @@ protected:
        one
        @param handler is the flow to forward message to. It must stay alive so
        long as *this is alive or the handler is removed.
+       @param shared if true, the handler gets a reference to the same buffer
+       instead of a copy. See DispatchFlow::register_shared_handler.
      */
-    void register_handler(UntypedHandler *handler, ID id, ID mask);
+    void register_handler(
+        UntypedHandler *handler, ID id, ID mask, bool shared = false);
 
     /// Removes a specific instance of a handler from this dispatcher.
     ///
@@ -119,6 +122,20 @@ protected:
      */
     virtual void send_transfer() = 0;
 
+    /** Sends a reference to the current message to lastHandlerToCall, via a
+     * multicast entry. @return false if no multicast entry was available; in
+     * this case the caller has to send a copy instead. */
+    virtual bool send_shared() = 0;
+
+    /** Called for every handler whose registration matches the current
+     * message, if filterHandlers_ is set. Called with the handler lock held.
+     * @param handler is the registered handler.
+     * @return false to skip this handler for the current message. */
+    virtual bool filter_handler(UntypedHandler *handler)
+    {
+        return true;
+    }
+
     /*typedef typename StateFlow<MessageType, QList<NUM_PRIO>>::Callback Callback;
     using StateFlow<MessageType, QList<NUM_PRIO>>::again;
     using StateFlow<MessageType, QList<NUM_PRIO>>::allocate_and_call;
@@ -157,13 +174,16 @@ private:
     /// identifier, mask, handler pointer.
     struct HandlerInfo
     {
-        HandlerInfo() : handler(nullptr)
+        HandlerInfo() : handler(nullptr), shared(false)
         {
         }
         ID id; ///< Bits that this handler is registered for.
         ID mask; ///< Mask that should be applied for the bits check.
         /// Handler to call. NULL if the handler has been removed.
         UntypedHandler *handler;
+        /// True if the handler does not modify the messages, so it can get a
+        /// reference instead of a copy.
+        bool shared;
 
         /// Equality comparison function on the handlers. Used for remove()
         /// calls.
@@ -190,9 +210,16 @@ private:
 protected:
     /// If non-NULL we still need to call this handler.
     UntypedHandler *lastHandlerToCall_{nullptr};
+    /// True if lastHandlerToCall_ was registered as a shared handler.
+    bool lastShared_{false};
+    /// True if a reference to the current message was sent to a shared
+    /// handler.
+    bool sentShared_{false};
     /// Handler to give all messages that were not matched by any other handler
     /// registration.
     UntypedHandler *fallbackHandler_{nullptr};
+    /// If true, filter_handler() is consulted for every matching handler.
+    bool filterHandlers_{false};
 private:
     /// Protects handler add / remove against iteration.
     OSMutex lock_;
@@ -257,6 +284,28 @@ public:
         Base::register_handler(handler, id, mask);
     }
 
+    /**
+       Adds a new handler that receives the messages without copying.
+
+       The handler is called under the same conditions as with
+       register_handler. Instead of a private copy of the message, it gets a
+       reference to the same buffer as other shared handlers. This saves an
+       allocation and a copy of the payload per handler.
+
+       The handler must not modify the message it receives, and it must be a
+       StateFlow (or otherwise take its messages through the queue of a
+       StateFlowWithQueue), because the buffer might arrive wrapped in a
+       @ref MulticastEntry.
+
+       @param id is the identifier of the message to listen to.
+       @param mask is the mask of the ID matcher.
+       @param handler is the flow to forward message to.
+     */
+    void register_shared_handler(HandlerType *handler, ID id, ID mask)
+    {
+        Base::register_handler(handler, id, mask, true);
+    }
+
     /// Removes a specific instance of a handler from this dispatcher.
     ///
     /// @param handler handler pointer to unregister.
@@ -320,6 +369,22 @@ protected:
         HandlerType* h = static_cast<HandlerType *>(this->lastHandlerToCall_);
         h->send(this->transfer_message());
     }
+
+    /// Sends a new reference of the current message to the target flow
+    /// wrapped in a multicast entry. @return false if the multicast entry
+    /// pool is exhausted.
+    bool send_shared() OVERRIDE {
+        HandlerType* h = static_cast<HandlerType *>(this->lastHandlerToCall_);
+        BufferBase *e = MulticastEntry::create(this->message()->ref());
+        if (!e)
+        {
+            this->message()->unref();
+            return false;
+        }
+        // The receiving StateFlow will turn this back into the message.
+        h->send(static_cast<MessageType *>(e));
+        return true;
+    }
 };
 
 
@@ -355,8 +420,8 @@ size_t DispatchFlowBase<NUM_PRIO>::size()
 }
 
 template<int NUM_PRIO>
-void DispatchFlowBase<NUM_PRIO>::register_handler(UntypedHandler *handler,
-                                                  ID id, ID mask)
+void DispatchFlowBase<NUM_PRIO>::register_handler(
+    UntypedHandler *handler, ID id, ID mask, bool shared)
 {
     OSMutexLock h(&lock_);
     size_t idx = 0;
@@ -371,6 +436,7 @@ void DispatchFlowBase<NUM_PRIO>::register_handler(UntypedHandler *handler,
     handlers_[idx].handler = handler;
     handlers_[idx].id = id;
     handlers_[idx].mask = mask;
+    handlers_[idx].shared = shared;
 }
 
 template<int NUM_PRIO>
@@ -421,6 +487,7 @@ StateFlowBase::Action DispatchFlowBase<NUM_PRIO>::entry()
 {
     currentIndex_ = 0;
     lastHandlerToCall_ = nullptr;
+    sentShared_ = false;
     return call_immediately(STATE(iterate));
 }
 
@@ -447,11 +514,16 @@ StateFlowBase::Action DispatchFlowBase<NUM_PRIO>::iterate()
             {
                 continue;
             }
+            if (filterHandlers_ && !filter_handler(h.handler))
+            {
+                continue;
+            }
             // At this point: we have another handler.
             if (!lastHandlerToCall_)
             {
                 // This was the first we found.
                 lastHandlerToCall_ = handlers_[currentIndex_].handler;
+                lastShared_ = handlers_[currentIndex_].shared;
                 continue;
             }            
             break;
@@ -462,14 +534,27 @@ StateFlowBase::Action DispatchFlowBase<NUM_PRIO>::iterate()
         return iteration_done();
     }
     // Now: we have at least two different handler. We need to clone the
-    // message. We use the pool of the last handler to call by default.
+    // message, unless the handler is happy with a reference. We use the pool
+    // of the last handler to call by default.
+    if (lastShared_ && lastHandlerToCall_ && send_shared())
+    {
+        sentShared_ = true;
+        return call_immediately(STATE(clone_done));
+    }
     return allocate_and_clone();
 }
 
 template<int NUM_PRIO>
 StateFlowBase::Action DispatchFlowBase<NUM_PRIO>::clone_done()
 {
+    if (currentIndex_ >= handlers_.size())
+    {
+        // Copy for the last handler from iteration_done() was sent.
+        lastHandlerToCall_ = nullptr;
+        return release_and_exit();
+    }
     lastHandlerToCall_ = handlers_[currentIndex_].handler;
+    lastShared_ = handlers_[currentIndex_].shared;
     ++currentIndex_;
     return call_immediately(STATE(iterate));
 }
@@ -479,6 +564,12 @@ StateFlowBase::Action DispatchFlowBase<NUM_PRIO>::iteration_done()
 {
     if (lastHandlerToCall_)
     {
+        if (!lastShared_ && sentShared_ && this->message()->references() > 1)
+        {
+            // Shared handlers are holding references to the message, but
+            // this handler may modify it. It needs a copy.
+            return allocate_and_clone();
+        }
         send_transfer();
     }
     else if (fallbackHandler_)
@@ -46,6 +46,11 @@
 #include <sys/select.h>
 #endif
 
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+#include <errno.h>
+#include <sys/epoll.h>
+#endif
+
 #ifdef __EMSCRIPTEN__
 #include <emscripten.h>
 #endif
@@ -77,10 +82,15 @@ ExecutorBase::ExecutorBase()
     , started_(0)
     , selectPrescaler_(0)
 {
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+    epollFd_ = epoll_create1(EPOLL_CLOEXEC);
+    HASSERT(epollFd_ >= 0);
+#else
     FD_ZERO(&selectRead_);
     FD_ZERO(&selectWrite_);
     FD_ZERO(&selectExcept_);
     selectNFds_ = 0;
+#endif
 }
 
 /** Lookup an executor by its name.
@@ -329,6 +339,167 @@ void *ExecutorBase::entry()
     return NULL;
 }
 
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+
+void ExecutorBase::select(Selectable *job)
+{
+    on_select(job);
+    unsigned fd = job->fd_;
+    OSMutexLock h(&epollLock_);
+    if (fd >= epollSlots_.size())
+    {
+        epollSlots_.resize(fd + 1);
+    }
+    Selectable *&waiter = epollSlots_[fd].waiters[job->selectType_ - 1];
+    if (waiter)
+    {
+        LOG(FATAL,
+            "Multiple Selectables are waiting for the same fd %d type %u", fd,
+            job->selectType_);
+    }
+    HASSERT(!job->next);
+    waiter = job;
+    epoll_update(fd);
+}
+
+bool ExecutorBase::is_selected(Selectable *job)
+{
+    unsigned fd = job->fd_;
+    OSMutexLock h(&epollLock_);
+    return fd < epollSlots_.size() &&
+        epollSlots_[fd].waiters[job->selectType_ - 1] != nullptr;
+}
+
+void ExecutorBase::unselect(Selectable *job)
+{
+    unsigned fd = job->fd_;
+    OSMutexLock h(&epollLock_);
+    if (fd >= epollSlots_.size() ||
+        epollSlots_[fd].waiters[job->selectType_ - 1] != job)
+    {
+        LOG(FATAL, "Tried to remove a non-active selectable: fd %d type %u", fd,
+            job->selectType_);
+    }
+    // The kernel registration stays. Any event arriving for this fd and type
+    // will be ignored.
+    epollSlots_[fd].waiters[job->selectType_ - 1] = nullptr;
+    on_select_done(job);
+}
+
+void ExecutorBase::epoll_update(unsigned fd)
+{
+    EpollSlot &slot = epollSlots_[fd];
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.data.fd = fd;
+    // Edge triggered, so that events for a type whose waiter was woken up or
+    // unselected since the last update do not keep waking us up.
+    ev.events = EPOLLET;
+    if (slot.waiters[Selectable::READ - 1])
+    {
+        ev.events |= EPOLLIN | EPOLLRDHUP;
+    }
+    if (slot.waiters[Selectable::WRITE - 1])
+    {
+        ev.events |= EPOLLOUT;
+    }
+    if (slot.waiters[Selectable::EXCEPT - 1])
+    {
+        ev.events |= EPOLLPRI;
+    }
+    // Modifying the registration makes the kernel re-evaluate the readiness
+    // of the fd, so a condition that became true while nobody was waiting
+    // will be reported in the next epoll_wait. If the fd was closed since the
+    // last use (which silently drops it from the epoll set), the number might
+    // have been reused; in this case MOD fails and we add it again.
+    int ret;
+    if (slot.registered)
+    {
+        ret = epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev);
+        if (ret < 0 && errno == ENOENT)
+        {
+            ret = epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev);
+        }
+    }
+    else
+    {
+        ret = epoll_ctl(epollFd_, EPOLL_CTL_ADD, fd, &ev);
+        if (ret < 0 && errno == EEXIST)
+        {
+            ret = epoll_ctl(epollFd_, EPOLL_CTL_MOD, fd, &ev);
+        }
+    }
+    if (ret == 0)
+    {
+        slot.registered = true;
+        return;
+    }
+    slot.registered = false;
+    if (errno == EPERM)
+    {
+        // Regular files do not support epoll. select() reports them always
+        // ready.
+        for (auto &w : slot.waiters)
+        {
+            epoll_wakeup(&w);
+        }
+        return;
+    }
+    LOG(FATAL, "epoll_ctl failed for fd %u: %s", fd, strerror(errno));
+}
+
+void ExecutorBase::epoll_wakeup(Selectable **waiter)
+{
+    Selectable *job = *waiter;
+    if (job)
+    {
+        *waiter = nullptr;
+        on_select_done(job);
+        add(job->wakeup_, job->priority_);
+    }
+}
+
+void ExecutorBase::wait_with_select(long long wait_length)
+{
+    // We will check the queue for any prior wakeups after this call. If we
+    // already processed the executables, the wakeup is not necessary.
+    selectHelper_.clear_wakeup();
+    if (!empty())
+    {
+        wait_length = 0;
+    }
+    long long max_sleep = MSEC_TO_NSEC(config_executor_max_sleep_msec());
+    if (wait_length > max_sleep)
+    {
+        wait_length = max_sleep;
+    }
+    struct epoll_event events[EPOLL_MAX_EVENTS];
+    int ret = selectHelper_.epoll_wait(
+        epollFd_, events, EPOLL_MAX_EVENTS, wait_length);
+    OSMutexLock h(&epollLock_);
+    for (int i = 0; i < ret; ++i)
+    {
+        EpollSlot &slot = epollSlots_[events[i].data.fd];
+        uint32_t ev = events[i].events;
+        // These match the conditions under which select() reports the fd in
+        // the respective fd_set.
+        if (ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+        {
+            epoll_wakeup(&slot.waiters[Selectable::READ - 1]);
+        }
+        if (ev & (EPOLLOUT | EPOLLERR))
+        {
+            epoll_wakeup(&slot.waiters[Selectable::WRITE - 1]);
+        }
+        if (ev & EPOLLPRI)
+        {
+            epoll_wakeup(&slot.waiters[Selectable::EXCEPT - 1]);
+        }
+    }
+}
+
+#else // not epoll
+
 void ExecutorBase::select(Selectable *job)
 {
     fd_set *s = get_select_set(job->type());
@@ -425,6 +596,7 @@ void ExecutorBase::wait_with_select(long long wait_length)
     selectNFds_ = max_fd;
 }
 
+#endif // epoll
 #endif
 
 #if defined(ARDUINO)
@@ -458,4 +630,7 @@ ExecutorBase::~ExecutorBase()
     {
         shutdown();
     }
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+    ::close(epollFd_);
+#endif
 }
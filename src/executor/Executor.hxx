@@ -38,11 +38,13 @@
 
 #include <functional>
 #include <atomic>
+#include <vector>
 
 #include "executor/Executable.hxx"
 #include "executor/Notifiable.hxx"
 #include "executor/Selectable.hxx"
 #include "executor/Timer.hxx"
+#include "utils/MPSCQueue.hxx"
 #include "utils/Queue.hxx"
 #include "utils/SimpleQueue.hxx"
 #include "utils/LinkedObject.hxx"
@@ -102,7 +104,8 @@ public:
      * @param job Selectable structure that describes the descriptor to watch.
      * The pointer must stay alive until it is activated, or is unselected.
      *
-     * Must be called on the executor thread.
+     * Must be called on the executor thread. With the epoll backend it may
+     * be called from any thread.
      *
      * @param job is a Selectable pointer that is not currently watched.
      */
@@ -121,7 +124,8 @@ public:
      * This stops watching the given file descriptor. The job must have been
      * previously inserted into the Executor and must be not yet activated.
      *
-     * Must be called on the executor thread.
+     * Must be called on the executor thread. With the epoll backend it may
+     * be called from any thread.
      *
      * @param job is a Selectable pointer that was previously inserted.
      */
@@ -156,8 +160,13 @@ public:
 
     OSThread& thread() { return *this; }
     
-    /// Die if we are not on the current executor.
-    void assert_current() { HASSERT(os_thread_self() == thread_handle()); }
+    /// Die if we are not on the current executor. Call this before accessing
+    /// state that is owned by the executor thread.
+    void assert_current()
+    {
+        bool ok = enter_current();
+        HASSERT(ok);
+    }
     
     /// @return a number that gets incremented by one every time an executable
     /// runs.
@@ -178,6 +187,30 @@ protected:
     /** Helper object for interruptible select calls. */
     OSSelectWakeup selectHelper_;
 
+    /// Called at the beginning of select(), before the Selectable is
+    /// registered. Allows executors running on multiple threads to bind the
+    /// waiting Executable to the thread doing the select loop.
+    /// @param job the Selectable being registered.
+    virtual void on_select(Selectable *job)
+    {
+    }
+
+    /// Called when a Selectable stops being registered, because it was woken
+    /// up or unselected. Called with the select lock held.
+    /// @param job the Selectable.
+    virtual void on_select_done(Selectable *job)
+    {
+    }
+
+    /// Called by assert_current(). Executors running their executables on
+    /// multiple threads override this to serialize the callers.
+    /// @return true if the calling thread is allowed to access the state
+    /// owned by the executor thread.
+    virtual bool enter_current()
+    {
+        return os_thread_self() == thread_handle();
+    }
+
 private:
     /** Retrieve an item from the front of the queue.
      * @param priority pass back the priority of the queue pulled from
@@ -192,6 +225,29 @@ private:
      * @param next_timer_nsec is the maximum time to sleep in nanoseconds. */
     void wait_with_select(long long next_timer_nsec);
 
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+    /// Registration of a single file descriptor in the epoll set.
+    struct EpollSlot
+    {
+        /// Selectable waiting for the given fd, indexed by select type - 1.
+        Selectable *waiters[3] = {nullptr, nullptr, nullptr};
+        /// True if the fd was added to the epoll set.
+        bool registered = false;
+    };
+
+    /// How many epoll events we retrieve in one call.
+    static constexpr int EPOLL_MAX_EVENTS = 32;
+
+    /// Updates the kernel's registration of an fd after a new Selectable was
+    /// added for it.
+    /// @param fd file descriptor.
+    void epoll_update(unsigned fd);
+
+    /// Schedules the Selectable that is waiting in a given slot, and clears
+    /// the slot.
+    /// @param waiter slot in EpollSlot::waiters.
+    void epoll_wakeup(Selectable **waiter);
+#else
     /// Helper function.
     ///
     /// @param type a select type: READ, WRITE or EXCEPT
@@ -209,6 +265,7 @@ private:
         LOG(FATAL, "Unexpected select type %d", type);
         return nullptr;
     }
+#endif
 
     /** name of this Executor */
     const char *name_;
@@ -219,6 +276,15 @@ private:
     /** List of active timers. */
     ActiveTimers activeTimers_;
 
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+    /** epoll instance holding every fd that was ever selected. The
+     * registrations are edge triggered and persistent. */
+    int epollFd_;
+    /** Protects epollSlots_. */
+    OSMutex epollLock_;
+    /** Waiting Selectables, indexed by fd. */
+    std::vector<EpollSlot> epollSlots_;
+#else
     /** fd to select for read. */
     fd_set selectRead_;
     /** fd to select for write. */
@@ -229,6 +295,7 @@ private:
     int selectNFds_;
     /** Head of the linked list for the select calls. */
     TypedQueue<Selectable> selectables_;
+#endif
 
     /** Set to 1 when the executor thread has exited and it is safe to delete
      * *this. */
@@ -373,7 +440,11 @@ private:
     DISALLOW_COPY_AND_ASSIGN(Executor);
 
     /// Internal queue of executables waiting to be scheduled.
+#if OPENMRN_FEATURE_EXECUTOR_MPSC_QUEUE
+    MPSCQList<NUM_PRIO> queue_;
+#else
     QListProtected<NUM_PRIO> queue_;
+#endif
 };
 
 /** This class can be given an executor, and will notify itself when that
@@ -0,0 +1,520 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file MultiExecutor.hxx
+ * Executor that runs its executables on a pool of threads.
+ *
+ * @author Balazs Racz
+ * @date 17 Oct 2026
+ */
+
+#ifndef _EXECUTOR_MULTIEXECUTOR_HXX_
+#define _EXECUTOR_MULTIEXECUTOR_HXX_
+
+#include <memory>
+#include <unordered_map>
+
+#include "executor/Executor.hxx"
+#include "nmranet_config.h"
+#include "os/OS.hxx"
+
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+
+/// Executor that runs the executables on a pool of worker threads. This
+/// allows a process with many independent Services to scale with the number
+/// of CPU cores without partitioning the Services across executors by hand.
+///
+/// Theory of operation:
+///
+/// Every worker thread has its own priority queue. Executables added from a
+/// worker thread go to the queue of that thread; executables added from
+/// outside threads are distributed round-robin. A worker takes work from its
+/// own queue first, and when that is empty, steals from the queues of the
+/// other workers.
+///
+/// Worker 0 is the executor thread in the sense of ExecutorBase: it runs the
+/// timers and the select loop. It has an additional queue that is never
+/// stolen from.
+///
+/// An executable never runs concurrently with itself. When a worker takes an
+/// executable that is currently running on a different worker (because it
+/// was notified again while running), it is moved to a deferred queue of the
+/// worker running it, and is re-queued when that run completes.
+///
+/// State that is owned by the executor thread is protected by
+/// assert_current() (e.g. the alias caches of IfCan). The first call to
+/// assert_current() in a run takes a lock that is held until the run
+/// completes, so these runs are serialized with each other, no matter which
+/// worker they are on. Together with the above, StateFlows and other
+/// Executables need no changes to run on a MultiExecutor. Different flows
+/// that share data without calling assert_current() do run in parallel; such
+/// data needs the same locking as when the flows are on different executors.
+/// The workers start right away in the constructor, so setup code that
+/// touches such state from a different thread (e.g. creating the local nodes
+/// of an IfCan) has to run via sync_run() and call assert_current() first.
+///
+/// Executables that wait for a file descriptor (i.e. call select()) are
+/// pinned to worker 0 while the Selectable is registered. Select wakeups and
+/// timed select unregistrations are thus serialized with the Executable
+/// owning the Selectable, the same way as on the single-threaded Executor.
+/// Unselecting a Selectable from a different Executable should happen on
+/// worker 0 as well (such as from a pinned flow).
+///
+/// Only available on Linux hosts, because it relies on the thread-safe epoll
+/// backend for select.
+template <unsigned NUM_PRIO> class MultiExecutor : public ExecutorBase
+{
+public:
+    /// Constructor.
+    /// @param name name of executor
+    /// @param priority thread priority
+    /// @param stack_size thread stack size
+    /// @param num_threads how many threads to run the executables on. Must be
+    /// at least 1.
+    MultiExecutor(
+        const char *name, int priority, size_t stack_size, unsigned num_threads)
+        : numWorkers_(num_threads)
+        , workers_(new Worker[num_threads])
+    {
+        HASSERT(num_threads >= 1);
+        for (unsigned i = 1; i < numWorkers_; ++i)
+        {
+            workers_[i].thread.reset(new HelperThread(this, i));
+            workers_[i].thread->start(name, priority, stack_size);
+        }
+        OSThread::start(name, priority, stack_size);
+    }
+
+    /// Destructor. Stops all threads.
+    ~MultiExecutor()
+    {
+        shutdown();
+        stopping_ = 1;
+        for (unsigned i = 1; i < numWorkers_; ++i)
+        {
+            idleSem_.post();
+        }
+        while (helpersDone_ + 1 < numWorkers_)
+        {
+            usleep(100);
+        }
+    }
+
+    /// @return the number of worker threads.
+    unsigned num_threads()
+    {
+        return numWorkers_;
+    }
+
+    /** Send a message to this Executor's queue.
+     * @param msg Executable instance to insert into the input queue
+     * @param priority priority of message
+     */
+    void add(Executable *msg, unsigned priority = UINT_MAX) override
+    {
+        if (priority >= NUM_PRIO)
+        {
+            priority = NUM_PRIO - 1;
+        }
+        if (msg == static_cast<Executable *>(this) || is_pinned(msg))
+        {
+            pinnedQueue_.insert(msg, priority);
+            selectHelper_.wakeup();
+            return;
+        }
+        unsigned w;
+        if (tlsExecutor_ == this)
+        {
+            w = tlsWorker_;
+        }
+        else
+        {
+            w = nextWorker_++ % numWorkers_;
+        }
+        workers_[w].queue.insert(msg, priority);
+        if (idleHelpers_ > 0)
+        {
+            idleSem_.post();
+        }
+        if (w == 0 || idleHelpers_ == 0)
+        {
+            // Worker 0 might be sleeping in select, and either this is its
+            // own work, or it should steal it.
+            selectHelper_.wakeup();
+        }
+    }
+
+    /// @return true if there are no executables waiting to be executed. Other
+    /// workers might still be running an executable.
+    bool empty() override
+    {
+        if (!pinnedQueue_.empty())
+        {
+            return false;
+        }
+        for (unsigned i = 0; i < numWorkers_; ++i)
+        {
+            if (!workers_[i].queue.empty())
+            {
+                return false;
+            }
+        }
+        AtomicHolder h(&runLock_);
+        for (unsigned i = 0; i < numWorkers_; ++i)
+        {
+            if (!workers_[i].deferred.empty())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// @return a number that gets incremented by one every time an
+    /// executable runs.
+    uint32_t sequence() override
+    {
+        return runCount_;
+    }
+
+    /// @return the number of executables that are currently pinned to worker
+    /// 0. Used for testing.
+    size_t num_pinned()
+    {
+        AtomicHolder h(&runLock_);
+        return pinned_.size();
+    }
+
+protected:
+    /// Pins the Executable waiting for the fd, as well as the one calling
+    /// select (these differ for timed selects), to the select thread.
+    /// @param job the Selectable being registered.
+    void on_select(Selectable *job) override
+    {
+        AtomicHolder h(&runLock_);
+        ++pinned_[job->parent()];
+        if (tlsExecutor_ == this && workers_[tlsWorker_].running &&
+            workers_[tlsWorker_].running != job->parent())
+        {
+            Executable *e = workers_[tlsWorker_].running;
+            ++pinned_[e];
+            selectors_[job] = e;
+        }
+    }
+
+    /// Releases the pins taken by on_select.
+    /// @param job the Selectable that is not registered anymore.
+    void on_select_done(Selectable *job) override
+    {
+        AtomicHolder h(&runLock_);
+        unpin(job->parent());
+        auto it = selectors_.find(job);
+        if (it != selectors_.end())
+        {
+            unpin(it->second);
+            selectors_.erase(it);
+        }
+    }
+
+    /// Takes the lock for the executor thread state, which is released when
+    /// the current executable's run completes.
+    /// @return true if called from a worker of this executor.
+    bool enter_current() override
+    {
+        if (tlsExecutor_ != this)
+        {
+            return false;
+        }
+        Worker &wk = workers_[tlsWorker_];
+        if (!wk.current)
+        {
+            currentLock_.lock();
+            wk.current = true;
+        }
+        return true;
+    }
+
+private:
+    /// Thread running the executables for one of the workers other than 0.
+    class HelperThread : public OSThread
+    {
+    public:
+        /// Constructor.
+        /// @param parent the executor.
+        /// @param index worker index.
+        HelperThread(MultiExecutor *parent, unsigned index)
+            : parent_(parent)
+            , index_(index)
+        {
+        }
+
+    protected:
+        void *entry() override
+        {
+            parent_->helper_loop(index_);
+            return nullptr;
+        }
+
+    private:
+        /// Executor that owns this thread.
+        MultiExecutor *parent_;
+        /// Worker index.
+        unsigned index_;
+    };
+
+    /// State of one worker thread.
+    struct Worker
+    {
+        /// Executables scheduled on this worker. Has its own lock.
+        QList<NUM_PRIO> queue;
+        /// Executables that were taken off a queue while running on this
+        /// worker. Protected by runLock_.
+        QList<NUM_PRIO> deferred;
+        /// Executable currently running on this worker. Protected by
+        /// runLock_.
+        Executable *running {nullptr};
+        /// True if this worker holds currentLock_. Only accessed by the
+        /// worker's own thread.
+        bool current {false};
+        /// Thread object for workers other than 0.
+        std::unique_ptr<HelperThread> thread;
+    };
+
+    /// Called by the ExecutorBase loop on worker 0.
+    /// @param priority will be filled with the priority of the executable.
+    /// @return the next executable to run, or nullptr if there is no work.
+    Executable *next(unsigned *priority) override
+    {
+        tlsExecutor_ = this;
+        tlsWorker_ = 0;
+        // The base loop calls next() after the previous executable is done.
+        release(0);
+        return take(0, priority);
+    }
+
+    /// Main loop of the helper threads.
+    /// @param w worker index.
+    void helper_loop(unsigned w)
+    {
+        tlsExecutor_ = this;
+        tlsWorker_ = w;
+        unsigned priority;
+        while (!stopping_)
+        {
+            Executable *e = take(w, &priority);
+            if (e)
+            {
+                e->run();
+                release(w);
+                continue;
+            }
+            ++idleHelpers_;
+            // Re-check after announcing that we are idle, to not miss a
+            // wakeup from an add() that happened in between.
+            if (!has_work(w) && !stopping_)
+            {
+                idleSem_.timedwait(
+                    MSEC_TO_NSEC(config_executor_max_sleep_msec()));
+            }
+            --idleHelpers_;
+        }
+        ++helpersDone_;
+    }
+
+    /// @return true if worker w would find something to take.
+    /// @param w worker index.
+    bool has_work(unsigned w)
+    {
+        if (w == 0 && !pinnedQueue_.empty())
+        {
+            return true;
+        }
+        for (unsigned i = 0; i < numWorkers_; ++i)
+        {
+            if (!workers_[i].queue.empty())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Takes the next executable that may run on a given worker, and marks
+    /// it as running there.
+    /// @param w worker index.
+    /// @param priority will be filled with the priority of the executable.
+    /// @return executable, or nullptr if there is no work.
+    Executable *take(unsigned w, unsigned *priority)
+    {
+        while (true)
+        {
+            Result r;
+            if (w == 0)
+            {
+                r = pinnedQueue_.next();
+            }
+            for (unsigned i = 0; !r.item && i < numWorkers_; ++i)
+            {
+                r = workers_[(w + i) % numWorkers_].queue.next();
+            }
+            if (!r.item)
+            {
+                return nullptr;
+            }
+            Executable *e = static_cast<Executable *>(r.item);
+            if (claim(w, e, r.index))
+            {
+                *priority = r.index;
+                return e;
+            }
+        }
+    }
+
+    /// Marks an executable as running on a worker, unless it is running on a
+    /// different worker or it is pinned to worker 0.
+    /// @param w worker index.
+    /// @param e executable taken off a queue.
+    /// @param priority priority of the executable.
+    /// @return true if the executable may run now on worker w, false if it
+    /// was put into a different queue.
+    bool claim(unsigned w, Executable *e, unsigned priority)
+    {
+        AtomicHolder h(&runLock_);
+        for (unsigned i = 0; i < numWorkers_; ++i)
+        {
+            if (workers_[i].running == e)
+            {
+                workers_[i].deferred.insert_locked(e, priority);
+                return false;
+            }
+        }
+        if (w != 0 && !pinned_.empty() && pinned_.count(e))
+        {
+            pinnedQueue_.insert(e, priority);
+            selectHelper_.wakeup();
+            return false;
+        }
+        workers_[w].running = e;
+        ++runCount_;
+        return true;
+    }
+
+    /// Marks the end of the run of the current executable on a worker.
+    /// @param w worker index.
+    void release(unsigned w)
+    {
+        Worker &wk = workers_[w];
+        if (wk.current)
+        {
+            wk.current = false;
+            currentLock_.unlock();
+        }
+        AtomicHolder h(&runLock_);
+        wk.running = nullptr;
+        Result r;
+        while ((r = wk.deferred.next_locked()).item)
+        {
+            auto *e = static_cast<Executable *>(r.item);
+            if (pinned_.count(e))
+            {
+                pinnedQueue_.insert(e, r.index);
+                selectHelper_.wakeup();
+            }
+            else
+            {
+                wk.queue.insert(e, r.index);
+            }
+        }
+    }
+
+    /// Drops one pin of an executable. Must be called with runLock_ held.
+    /// @param e executable.
+    void unpin(Executable *e)
+    {
+        auto it = pinned_.find(e);
+        HASSERT(it != pinned_.end());
+        if (--it->second == 0)
+        {
+            pinned_.erase(it);
+        }
+    }
+
+    /// @return true if the executable is pinned to worker 0.
+    /// @param e executable.
+    bool is_pinned(Executable *e)
+    {
+        AtomicHolder h(&runLock_);
+        return !pinned_.empty() && pinned_.count(e);
+    }
+
+    /// Total number of worker threads (including the executor thread).
+    unsigned numWorkers_;
+    /// Per-thread state.
+    std::unique_ptr<Worker[]> workers_;
+    /// Executables that must run on worker 0. Never stolen.
+    QList<NUM_PRIO> pinnedQueue_;
+    /// Protects the running and deferred members of all workers, pinned_ and
+    /// selectors_.
+    Atomic runLock_;
+    /// Held by the worker whose current run called assert_current().
+    OSMutex currentLock_;
+    /// Executables that have a registered Selectable, with the number of
+    /// such Selectables.
+    std::unordered_map<Executable *, unsigned> pinned_;
+    /// For registered Selectables that were selected by a different
+    /// Executable than the one they wake up, the selecting Executable.
+    std::unordered_map<Selectable *, Executable *> selectors_;
+    /// Idle helper threads are waiting on this.
+    OSSem idleSem_;
+    /// How many helper threads are waiting (or about to wait) on idleSem_.
+    std::atomic<unsigned> idleHelpers_ {0};
+    /// How many helper threads have exited.
+    std::atomic<unsigned> helpersDone_ {0};
+    /// Round-robin counter for adds from outside threads.
+    std::atomic<unsigned> nextWorker_ {0};
+    /// Counts the executables run.
+    std::atomic<uint32_t> runCount_ {0};
+    /// 1 when the helper threads should exit.
+    std::atomic<uint8_t> stopping_ {0};
+
+    /// Which MultiExecutor the current thread is a worker of.
+    static thread_local MultiExecutor *tlsExecutor_;
+    /// Worker index of the current thread in tlsExecutor_.
+    static thread_local unsigned tlsWorker_;
+
+    DISALLOW_COPY_AND_ASSIGN(MultiExecutor);
+};
+
+template <unsigned NUM_PRIO>
+thread_local MultiExecutor<NUM_PRIO> *MultiExecutor<NUM_PRIO>::tlsExecutor_ =
+    nullptr;
+
+template <unsigned NUM_PRIO>
+thread_local unsigned MultiExecutor<NUM_PRIO>::tlsWorker_ = 0;
+
+#endif // OPENMRN_FEATURE_EXECUTOR_EPOLL
+
+#endif // _EXECUTOR_MULTIEXECUTOR_HXX_
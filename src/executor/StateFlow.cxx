@@ -78,6 +78,7 @@ StateFlowBase::Action StateFlowWithQueue::wait_for_message()
     currentMessage_ = static_cast<BufferBase *>(queue_next(&priority));
     if (currentMessage_)
     {
+        currentMessage_ = MulticastEntry::resolve(currentMessage_);
         isWaiting_ = 0;
         currentPriority_ = priority;
         queueSize_--;
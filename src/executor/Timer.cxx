@@ -32,6 +32,8 @@
  * @date 16 Mar 2014
  */
 
+#include <utility>
+
 #include "executor/Timer.hxx"
 #include "executor/Executor.hxx"
 #include "os/os.h"
@@ -44,12 +46,11 @@ Timer::~Timer()
 
 void Timer::run()
 {
-    isExpired_ = 0;
+    activeTimers_->clear_expired(this);
     long long new_period = timeout();
     if (new_period == RESTART)
     {
         when_ += period_;
-        isActive_ = 1;
         activeTimers_->schedule_timer(this);
     }
     else if (new_period == DELETE)
@@ -85,32 +86,29 @@ long long ActiveTimers::get_next_timeout()
 {
     OSMutexLock l(&lock_);
 
-    QMember **last = &activeTimers_.next;
-    Timer *current_timer = static_cast<Timer *>(*last);
     long long now = OSTime::get_monotonic();
     bool found_timer = false;
-    while (current_timer && current_timer->when_ <= now)
+    // All expired timers are handed to the executor in one pass.
+    while (root_ && root_->when_ <= now)
     {
-        // Deques next timer.
+        Timer *current_timer = root_;
         found_timer = true;
-        *last = current_timer->next;
-        current_timer->next = nullptr;
+        root_ = merge_pairs(current_timer->heapChild_);
+        current_timer->heapChild_ = nullptr;
 
         current_timer->isActive_ = 0;
         current_timer->isExpired_ = 1;
         // Puts it on the executor.
         executor_->add(current_timer, current_timer->priority_);
-        // Takes the next timer.
-        current_timer = static_cast<Timer *>(*last);
     }
 
     if (found_timer)
     {
         return 0;
     }
-    else if (current_timer)
+    else if (root_)
     {
-        long long ret = current_timer->when_ - now;
+        long long ret = root_->when_ - now;
         return ret;
     }
     else
@@ -123,50 +121,135 @@ long long ActiveTimers::get_next_timeout()
 
 bool ActiveTimers::empty() {
     OSMutexLock l(&lock_);
-
-    QMember **last = &activeTimers_.next;
-    Timer *current_timer = static_cast<Timer *>(*last);
-    return (current_timer == nullptr);
+    return root_ == nullptr;
 }
 
 void ActiveTimers::schedule_timer(Timer *timer)
 {
     OSMutexLock l(&lock_);
+    timer->isActive_ = 1;
     insert_locked(timer);
 }
 
+void ActiveTimers::clear_expired(Timer *timer)
+{
+    OSMutexLock l(&lock_);
+    timer->isExpired_ = 0;
+}
+
+bool ActiveTimers::earlier(const Timer *a, const Timer *b)
+{
+    if (a->when_ != b->when_)
+    {
+        return a->when_ < b->when_;
+    }
+    // Wraparound-safe comparison of the sequence numbers.
+    return (int32_t)(a->seq_ - b->seq_) < 0;
+}
+
+Timer *ActiveTimers::meld(Timer *a, Timer *b)
+{
+    if (!a)
+    {
+        return b;
+    }
+    if (!b)
+    {
+        return a;
+    }
+    if (earlier(b, a))
+    {
+        std::swap(a, b);
+    }
+    b->next = a->heapChild_;
+    if (b->next)
+    {
+        static_cast<Timer *>(b->next)->heapPrev_ = b;
+    }
+    b->heapPrev_ = a;
+    a->heapChild_ = b;
+    return a;
+}
+
+Timer *ActiveTimers::merge_pairs(Timer *first)
+{
+    // First pass: melds the siblings in pairs from left to right. The results
+    // are stacked up via heapPrev_.
+    Timer *stack = nullptr;
+    while (first)
+    {
+        Timer *a = first;
+        Timer *b = static_cast<Timer *>(a->next);
+        first = b ? static_cast<Timer *>(b->next) : nullptr;
+        a->next = nullptr;
+        a->heapPrev_ = nullptr;
+        if (b)
+        {
+            b->next = nullptr;
+            b->heapPrev_ = nullptr;
+        }
+        Timer *m = meld(a, b);
+        m->heapPrev_ = stack;
+        stack = m;
+    }
+    // Second pass: melds the pairs from right to left.
+    Timer *root = nullptr;
+    while (stack)
+    {
+        Timer *m = stack;
+        stack = m->heapPrev_;
+        m->heapPrev_ = nullptr;
+        root = meld(m, root);
+    }
+    return root;
+}
+
 void ActiveTimers::insert_locked(Timer *timer)
 {
     HASSERT(timer);
     HASSERT(timer->next == nullptr);
+    HASSERT(timer->heapPrev_ == nullptr);
+    HASSERT(timer->heapChild_ == nullptr);
 
-    QMember **last = &activeTimers_.next;
-    Timer *current_timer = static_cast<Timer *>(*last);
-    while (current_timer && current_timer->when_ <= timer->when_)
+    timer->seq_ = nextSeq_++;
+    root_ = meld(root_, timer);
+    if (root_ == timer)
     {
-        last = &current_timer->next;
-        current_timer = static_cast<Timer *>(*last);
+        // This will wake up the executor, which will schedule all expired
+        // timers and recompute sleep length. Timers that are not the earliest
+        // one do not change the sleep length.
+        notify();
     }
-    // Inserts into the queue.
-    timer->next = current_timer;
-    *last = timer;
-
-    // This will wake up the executor, which will schedule all expired timers
-    // and recompute sleep length.
-    notify();
 }
 
 void ActiveTimers::remove_locked(Timer *timer)
 {
     HASSERT(timer);
-    // Removes the timer from the queue.
-    QMember **last = &activeTimers_.next;
-    while (*last && *last != timer)
+    if (timer == root_)
     {
-        last = &((*last)->next);
+        root_ = merge_pairs(timer->heapChild_);
     }
-    HASSERT(*last == timer);
-    *last = timer->next;
+    else
+    {
+        // Cuts the subtree of timer from its parent.
+        HASSERT(timer->heapPrev_);
+        Timer *next = static_cast<Timer *>(timer->next);
+        if (timer->heapPrev_->heapChild_ == timer)
+        {
+            timer->heapPrev_->heapChild_ = next;
+        }
+        else
+        {
+            timer->heapPrev_->next = next;
+        }
+        if (next)
+        {
+            next->heapPrev_ = timer->heapPrev_;
+        }
+        root_ = meld(root_, merge_pairs(timer->heapChild_));
+    }
+    timer->heapChild_ = nullptr;
+    timer->heapPrev_ = nullptr;
     timer->next = nullptr;
 }
 
@@ -182,6 +265,50 @@ void ActiveTimers::remove_timer(Timer *timer)
 {
     HASSERT(timer);
     OSMutexLock l(&lock_);
+    HASSERT(!timer->isExpired_);
+    timer->isCancelled_ = 1;
+    if (timer->isActive_)
+    {
+        remove_locked(timer);
+        timer->isActive_ = 0;
+    }
+    // This will ensure the we don't get from active to expired from now on.
+    timer->when_ = INT64_MAX;
+}
+
+void ActiveTimers::restart_timer(Timer *timer)
+{
+    HASSERT(timer);
+    OSMutexLock l(&lock_);
+    if (timer->isExpired_)
+    {
+        return;
+    }
+    if (timer->isActive_)
+    {
+        remove_locked(timer);
+    }
+    timer->isActive_ = 1;
+    timer->isCancelled_ = 0;
+    timer->when_ = OSTime::get_monotonic() + timer->period_;
+    insert_locked(timer);
+}
+
+void ActiveTimers::trigger_timer(Timer *timer, bool must_be_active)
+{
+    HASSERT(timer);
+    OSMutexLock l(&lock_);
+    if (timer->isExpired_)
+    {
+        return;
+    }
+    if (!timer->isActive_)
+    {
+        HASSERT(!must_be_active);
+        return;
+    }
     remove_locked(timer);
-    timer->isActive_ = 0;
+    timer->isCancelled_ = 1;
+    timer->when_ = 2; // in the past
+    insert_locked(timer);
 }
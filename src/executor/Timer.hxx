@@ -44,7 +44,13 @@ class Timer;
 class ExecutorBase;
 
 /** Class that manages the list of active timers. The Executor uses this class
- * tightly in its sleep-execute loop. */
+ * tightly in its sleep-execute loop.
+ *
+ * The active timers are kept in a pairing heap ordered by expiration time. A
+ * schedule is O(1), a remove or update is O(log n) amortized, and the earliest
+ * timer is always at the root. The executor is only woken up when a timer
+ * becomes the earliest one. Timers with the same expiration time run in the
+ * order they were scheduled. */
 class ActiveTimers : public Executable
 {
 public:
@@ -75,21 +81,43 @@ public:
      * scheduled. */
     void schedule_timer(::Timer *timer);
 
-    /** Updates the expiration time of an already scheduled timer. This call is
-     * somewhat expensive, because it needs to walk the entire queue of active
-     * timers. May wake up the executor.
+    /** Marks an expired timer as not expired anymore. Called when the timer
+     * starts running on the executor.
+     *
+     * @param timer is the expired timer. */
+    void clear_expired(::Timer *timer);
+
+    /** Updates the expiration time of an already scheduled timer. May wake up
+     * the executor.
      *
      * @param timer is the timer whose next execution time has been updated. It
      * must already be scheduled. */
     void update_timer(::Timer *timer);
 
-    /** Deletes an already scheduled but not yet expired timer. This call is
-     * somewhat expensive, because it needs to walk the entire queue of active
-     * timers. Asserts that the timer is in fact not yet expired.
+    /** Deletes a not yet expired timer, and marks it as cancelled. Asserts
+     * that the timer is in fact not yet expired. Does nothing else if the
+     * timer is not scheduled.
      *
      * @param timer is the timer to delete. */
     void remove_timer(::Timer *timer);
 
+    /** Restarts a timer with its period from the current time. Does nothing
+     * if the timer is already expired. The check and the update are atomic
+     * with respect to the expiration of the timer.
+     *
+     * @param timer is the timer to restart. */
+    void restart_timer(::Timer *timer);
+
+    /** Makes a scheduled timer expire immediately. Does nothing if the timer
+     * is already expired. The check and the update are atomic with respect
+     * to the expiration of the timer.
+     *
+     * @param timer is the timer to trigger.
+     * @param must_be_active if true, asserts that the timer is either
+     * scheduled or expired. If false, does nothing for a timer that is not
+     * scheduled. */
+    void trigger_timer(::Timer *timer, bool must_be_active);
+
     /** @returns the executor on which the timers will be scheduled. */
     ExecutorBase *executor()
     {
@@ -104,21 +132,42 @@ public:
     void run() override;
 
 private:
-    /** Removes a timer from the active list. Assert fails if it is not
-     * there. Caller must hold the lock. 
-     * @param timer what to remove from the active list. */
+    /** Removes a timer from the active heap. Caller must hold the lock.
+     * @param timer what to remove from the active heap. */
     void remove_locked(::Timer *timer);
 
-    /** Inserts a timer into the active list. Caller must hold the lock.
-     * @param timer what to insert into the active list. */
+    /** Inserts a timer into the active heap. Caller must hold the lock. Wakes
+     * up the executor if this timer is the next one to expire.
+     * @param timer what to insert into the active heap. */
     void insert_locked(::Timer *timer);
 
+    /** Heap order of the timers.
+     * @param a first timer.
+     * @param b second timer.
+     * @return true if a has to run before b: it expires earlier, or at the
+     * same time but was scheduled earlier. */
+    static bool earlier(const ::Timer *a, const ::Timer *b);
+
+    /** Merges two heaps. The root that runs later becomes the leftmost child
+     * of the other.
+     * @param a root of the first heap, may be nullptr.
+     * @param b root of the second heap, may be nullptr.
+     * @return the root of the merged heap. */
+    static ::Timer *meld(::Timer *a, ::Timer *b);
+
+    /** Merges a list of sibling subtrees into one heap (two-pass pairing).
+     * @param first leftmost sibling, may be nullptr.
+     * @return the root of the merged heap. */
+    static ::Timer *merge_pairs(::Timer *first);
+
     /// Parent.
     ExecutorBase *executor_;
     /// Protects the timer list.
     OSMutex lock_;
-    /// List of timers that are scheduled.
-    QMember activeTimers_;
+    /// Root of the heap of timers that are scheduled.
+    ::Timer *root_{nullptr};
+    /// Sequence number for the next timer scheduled.
+    uint32_t nextSeq_{0};
     /// 1 if we in the executor's queue.
     std::atomic_uint_least8_t isPending_;
 
@@ -141,6 +190,9 @@ public:
         , priority_(UINT_MAX)
         , when_(0)
         , period_(0)
+        , heapChild_(nullptr)
+        , heapPrev_(nullptr)
+        , seq_(0)
         , isActive_(0)
         , isExpired_(0)
         , isCancelled_(0)
@@ -186,7 +238,6 @@ public:
     {
         HASSERT(!isActive_);
         HASSERT(!isExpired_);
-        isActive_ = 1;
         isCancelled_ = 0;
         when_ = OSTime::get_monotonic() + period;
         period_ = period;
@@ -200,7 +251,6 @@ public:
     {
         HASSERT(!isActive_);
         HASSERT(!isExpired_);
-        isActive_ = 1;
         isCancelled_ = 0;
         when_ = expiry_time_nsec;
         period_ = when_ - OSTime::get_monotonic();
@@ -214,19 +264,7 @@ public:
     void restart()
     {
         /// @todo(balazs.racz) assert here that we are on the given executor.
-        if (isExpired_)
-            return;
-        when_ = OSTime::get_monotonic() + period_;
-        isCancelled_ = 0;
-        if (isActive_)
-        {
-            activeTimers_->update_timer(this);
-        }
-        else
-        {
-            isActive_ = 1;
-            activeTimers_->schedule_timer(this);
-        }
+        activeTimers_->restart_timer(this);
     }
 
     /** This will wakeup the timer prematurely, immediately.  The timer must be
@@ -237,18 +275,13 @@ public:
     void trigger()
     {
         /// @todo(balazs.racz) assert here that we are on the given executor.
-        if (isExpired_)
-            return;
-        HASSERT(isActive_);
-        isCancelled_ = 1;
-        when_ = 2; // in the past
-        activeTimers_->update_timer(this);
+        activeTimers_->trigger_timer(this, true);
     }
 
     /** Triggers the timer if it is not expired yet. */
     void ensure_triggered()
     {
-        if (isActive_) trigger();
+        activeTimers_->trigger_timer(this, false);
     }
 
     /** Dangerous, do not call. Contains a race condition. Production users
@@ -259,13 +292,7 @@ public:
      * from outside the main executor. */
     void cancel()
     {
-        when_ = INT64_MAX;  // This will ensure the we don't get from active to
-                            // expired from now on.
-        HASSERT(!isExpired_);
-        isCancelled_ = 1;
-        if (isActive_) {
-            activeTimers_->remove_timer(this);
-        }
+        activeTimers_->remove_timer(this);
     }
 
     /** @returns true if the timer was triggered due to cancel() or trigger();
@@ -293,6 +320,7 @@ protected:
 private:
     friend class ActiveTimers;  // for scheduling an expiring timers
     friend class CountingTimer; // for testing
+    friend class TimerTest;     // for testing
 
     /** Points to the executor's timer structure. Not owned. */
     ActiveTimers *activeTimers_;
@@ -302,6 +330,15 @@ private:
     long long when_;
     /** period in nanoseconds for timer */
     long long period_;
+    /** Leftmost child in the active timers heap. The next sibling is
+     * linked via QMember::next. */
+    Timer *heapChild_;
+    /** Previous sibling in the active timers heap, or the parent for a
+     * leftmost child, or nullptr for the root. */
+    Timer *heapPrev_;
+    /** Sequence number assigned when the timer was last scheduled. Breaks the
+     * ties between timers with the same expiration time. */
+    uint32_t seq_;
     /** true when the timer is in the active timers list */
     unsigned isActive_ : 1;
     /** True when the timer is in the pending executables list of the
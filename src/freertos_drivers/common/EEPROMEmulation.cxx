@@ -116,6 +116,33 @@ void EEPROMEmulation::mount()
         /* turn on shadowing */
         shadowInRam_ = true;
     }
+    else if (INDEX_IN_RAM)
+    {
+        build_index();
+    }
+}
+
+/** Fills index_ from the journal in the active sector.
+ */
+void EEPROMEmulation::build_index()
+{
+    unsigned count = fblock_count();
+    if (!index_)
+    {
+        index_ = new uint16_t[count];
+    }
+    memset(index_, 0, count * sizeof(uint16_t));
+    /* later slots override earlier ones */
+    for (unsigned block_index = slot_first();
+         block_index < rawBlockCount_ - availableSlots_; ++block_index)
+    {
+        unsigned fblock = *block(activeSector_, block_index) >> 16;
+        if (fblock < count)
+        {
+            index_[fblock] = block_index;
+        }
+    }
+    indexInRam_ = true;
 }
 
 /** Write to the EEPROM.  NOTE!!! This is not necessarily atomic across
@@ -216,6 +243,10 @@ void EEPROMEmulation::write_fblock(unsigned int index, const uint8_t data[])
                            (data[(i * 2) + 0] << 0);
         }
         flash_program(activeSector_, rawBlockCount_ - availableSlots_, slot_data, BLOCK_SIZE);
+        if (indexInRam_)
+        {
+            index_[index] = rawBlockCount_ - availableSlots_;
+        }
         --availableSlots_;
     }
     else
@@ -232,7 +263,7 @@ void EEPROMEmulation::write_fblock(unsigned int index, const uint8_t data[])
         unsigned available_slots = slot_count();
 
         /* move any existing data over */
-        for (unsigned int fblock = 0; fblock < (file_size() / BYTES_PER_BLOCK); ++fblock)
+        for (unsigned int fblock = 0; fblock < fblock_count(); ++fblock)
         {
             uint32_t slot_data[MAX_BLOCK_SIZE / sizeof(uint32_t)];
             if (fblock == index) // the new data to be written
@@ -251,6 +282,10 @@ void EEPROMEmulation::write_fblock(unsigned int index, const uint8_t data[])
                 if (!read_fblock(fblock, read_data))
                 {
                     /* nothing to write, this is the default "erased" value */
+                    if (indexInRam_)
+                    {
+                        index_[fblock] = 0;
+                    }
                     continue;
                 }
                 for (unsigned int i = 0; i < BLOCK_SIZE / sizeof(uint32_t); ++i)
@@ -262,6 +297,11 @@ void EEPROMEmulation::write_fblock(unsigned int index, const uint8_t data[])
             }
             /* commit the write */
             flash_program(new_sector, rawBlockCount_ - available_slots, slot_data, BLOCK_SIZE);
+            if (indexInRam_)
+            {
+                /* this entry is not needed anymore for the old sector */
+                index_[fblock] = rawBlockCount_ - available_slots;
+            }
             --available_slots;
         }
         /* finalize the data move and write */
@@ -290,6 +330,27 @@ void EEPROMEmulation::read(unsigned int offset, void *buf, size_t len)
     }
 
     uint8_t *byte_data = (uint8_t *)buf;
+
+    if (indexInRam_)
+    {
+        while (len)
+        {
+            unsigned lsa = offset & (BYTES_PER_BLOCK - 1);
+            size_t copylen = BYTES_PER_BLOCK - lsa;
+            if (copylen > len)
+            {
+                copylen = len;
+            }
+            uint8_t data[MAX_BLOCK_SIZE];
+            read_fblock(offset / BYTES_PER_BLOCK, data);
+            memcpy(byte_data, data + lsa, copylen);
+            offset += copylen;
+            byte_data += copylen;
+            len -= copylen;
+        }
+        return;
+    }
+
     memset(byte_data, 0xff, len); // default if data not found
 
     for (unsigned block_index = slot_first();
@@ -309,11 +370,7 @@ void EEPROMEmulation::read(unsigned int offset, void *buf, size_t len)
         }
         // Reads the block
         uint8_t data[MAX_BLOCK_SIZE];
-        for (unsigned int i = 0; i < BLOCK_SIZE / sizeof(uint32_t); ++i)
-        {
-            data[(i * 2) + 0] = (address[i] >> 0) & 0xFF;
-            data[(i * 2) + 1] = (address[i] >> 8) & 0xFF;
-        }
+        decode_slot(address, data);
         // Copies the right part into the output buffer.
         unsigned slotofs, bufofs;
         if (slot_offset < offset)
@@ -355,6 +412,17 @@ bool EEPROMEmulation::read_fblock(unsigned int index, uint8_t data[])
         }
         return false;
     }
+    else if (indexInRam_)
+    {
+        unsigned raw_block = index_[index];
+        if (!raw_block)
+        {
+            memset(data, 0xFF, BYTES_PER_BLOCK);
+            return false;
+        }
+        decode_slot(block(activeSector_, raw_block), data);
+        return true;
+    }
     else
     {
         /* default data value if not found */
@@ -369,11 +437,7 @@ bool EEPROMEmulation::read_fblock(unsigned int index, uint8_t data[])
             if (index == (*address >> 16))
             {
                 /* found the data */
-                for (unsigned int i = 0; i < BLOCK_SIZE / sizeof(uint32_t); ++i)
-                {
-                    data[(i * 2) + 0] = (address[i] >> 0) & 0xFF;
-                    data[(i * 2) + 1] = (address[i] >> 8) & 0xFF;
-                }
+                decode_slot(address, data);
                 return true;
             }
         }
@@ -381,3 +445,17 @@ bool EEPROMEmulation::read_fblock(unsigned int index, uint8_t data[])
 
     return false;
 }
+
+/** Decodes the data payload of a slot.
+ * @param address the slot's data
+ * @param data location to place the data, array size must be @ref
+ *           BYTES_PER_BLOCK large
+ */
+void EEPROMEmulation::decode_slot(const uint32_t *address, uint8_t data[])
+{
+    for (unsigned int i = 0; i < BLOCK_SIZE / sizeof(uint32_t); ++i)
+    {
+        data[(i * 2) + 0] = (address[i] >> 0) & 0xFF;
+        data[(i * 2) + 1] = (address[i] >> 8) & 0xFF;
+    }
+}
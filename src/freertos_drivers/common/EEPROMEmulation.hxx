@@ -99,6 +99,13 @@ extern const char __eeprom_end;
  *  be allocated in RAM that will be pre-filled with the entire eeprom
  *  data. Dramatically speeds up reads, because reads will not have to go
  *  through the log anymore.
+ *  @param INDEX_IN_RAM: a boolean, if set to true, a table is allocated in
+ *  RAM with one 16-bit entry per BYTES_PER_BLOCK bytes of the file, holding
+ *  the location of the latest journal slot for that data. The table is built
+ *  at mount and kept up to date by writes; reads take constant time without
+ *  scanning the journal. Takes 2 / BYTES_PER_BLOCK of the RAM that
+ *  SHADOW_IN_RAM would use (so it only helps when BYTES_PER_BLOCK > 2).
+ *  Ignored if SHADOW_IN_RAM is set.
  *  @param file_size: The total number of bytes held by the emulated eeprom
  *  file. Reads from address 0 .. file_size - 1 will be valid. Must be smaller
  *  than half of one sector, but should be realistically about 35% of the
@@ -123,6 +130,9 @@ extern const char __eeprom_end;
  * The efficiency is not great: only 25% of the allocated flash space can be
  * used for data storage. Users should leave some additional buffer to avoid
  * too frequent overflowing of sectors.
+ * @ref WearLevelEEPROMEmulation spreads the data over all sectors and
+ * compacts incrementally, for applications that need more space or bounded
+ * write latency.
  *
  * The file size is limited to 64k - BLOCK_SIZE because the address is stored
  * on 2 bytes in each block.
@@ -199,6 +209,12 @@ private:
      */
     static const bool SHADOW_IN_RAM;
 
+    /** Keep an index of the latest slot for each file block in RAM. This
+     * will increase read performance at the expense of 2 bytes of RAM per
+     * BYTES_PER_BLOCK bytes of file.
+     */
+    static const bool INDEX_IN_RAM;
+
 protected:
     /** magic marker for an intact block */
     static const uint32_t MAGIC_INTACT;
@@ -232,6 +248,26 @@ private:
      */
     void write_fblock(unsigned int index, const uint8_t data[]);
 
+    /** Fills index_ from the journal in the active sector, and turns on
+     * indexInRam_.
+     */
+    void build_index();
+
+    /** @return the number of blocks in the file, including the partial block
+     * at the end if the file size is not a multiple of BYTES_PER_BLOCK.
+     */
+    unsigned fblock_count()
+    {
+        return (file_size() + BYTES_PER_BLOCK - 1) / BYTES_PER_BLOCK;
+    }
+
+    /** Decodes the data payload of a slot.
+     * @param address the slot's data from @ref block()
+     * @param data location to place the data, array size must be @ref
+     *           BYTES_PER_BLOCK large
+     */
+    static void decode_slot(const uint32_t *address, uint8_t data[]);
+
     /** Read from the EEPROM on a native block boundary.
      * @param index block within EEPROM address space to read
      * @param data location to place read data, array size must be @ref
@@ -327,6 +363,14 @@ protected:
     /** pointer to RAM for shadowing EEPROM. */
     uint8_t *shadow_{nullptr};
 
+    /** Specifies whether the index_ is active. */
+    bool indexInRam_{false};
+
+    /** For each file block, the raw block index of the slot in the active
+     * sector that holds its latest data, or 0 if it was never written (raw
+     * block 0 is a magic block, never a slot). */
+    uint16_t *index_{nullptr};
+
 
     /** Default constructor.
      */
@@ -0,0 +1,412 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file WearLevelEEPROMEmulation.cxx
+ * Log-structured EEPROM emulation in FLASH that spreads the data across many
+ * sectors and compacts incrementally.
+ *
+ * @author Balazs Racz
+ * @date 17 Oct 2026
+ */
+
+#include "WearLevelEEPROMEmulation.hxx"
+
+#include <climits>
+#include <cstring>
+
+#include "utils/Crc.hxx"
+
+constexpr unsigned WearLevelEEPROMEmulation::MAX_BLOCK_SIZE;
+constexpr unsigned WearLevelEEPROMEmulation::FREE_SECTOR_TARGET;
+constexpr unsigned WearLevelEEPROMEmulation::FORCED_FREE_SECTORS;
+constexpr unsigned WearLevelEEPROMEmulation::SLOTS_PER_WRITE;
+constexpr unsigned WearLevelEEPROMEmulation::RESERVE_SECTORS;
+constexpr uint32_t WearLevelEEPROMEmulation::ERASED;
+constexpr uint16_t WearLevelEEPROMEmulation::NONE;
+
+WearLevelEEPROMEmulation::WearLevelEEPROMEmulation(const char *name,
+    size_t file_size, unsigned sector_count, size_t sector_size,
+    size_t block_size)
+    : EEPROM(name, file_size)
+    , sectorCount_(sector_count)
+    , blockSize_(block_size)
+    , payloadSize_(block_size - 4)
+    , rawBlockCount_(sector_size / block_size)
+    , fblockCount_((file_size + block_size - 5) / (block_size - 4))
+    , sequence_(new uint32_t[sector_count])
+    , liveCount_(new uint16_t[sector_count])
+    , index_(new uint16_t[fblockCount_])
+{
+    HASSERT(sector_count >= 4 && sector_count < 255);
+    HASSERT(block_size >= 8); // need a header word and some payload
+    HASSERT(block_size <= MAX_BLOCK_SIZE); // this is how big our buffers are.
+    HASSERT((block_size % 4) == 0); // block size must be on 4 byte boundary
+    HASSERT((sector_size % block_size) == 0);
+    // index_ entries are 16 bits, 0 is reserved
+    HASSERT(sector_count * rawBlockCount_ <= 0xFFFF);
+    HASSERT(file_size <= max_file_size(sector_count, sector_size, block_size));
+    HASSERT(fblockCount_ < 0xFFFF);
+}
+
+void WearLevelEEPROMEmulation::mount()
+{
+    memset(index_.get(), 0, fblockCount_ * sizeof(uint16_t));
+    memset(liveCount_.get(), 0, sectorCount_ * sizeof(uint16_t));
+    liveTotal_ = 0;
+    freeCount_ = 0;
+    victim_ = NONE;
+    nextSequence_ = 1;
+
+    /* find the sectors with a valid header, erase everything else. */
+    std::unique_ptr<uint8_t[]> order(new uint8_t[sectorCount_]);
+    unsigned used = 0;
+    for (unsigned s = 0; s < sectorCount_; ++s)
+    {
+        const uint32_t *hdr = block(s, 0);
+        uint32_t seq = hdr[0];
+        if (seq != ERASED && hdr[1] == ~seq)
+        {
+            sequence_[s] = seq;
+            if (seq >= nextSequence_)
+            {
+                nextSequence_ = seq + 1;
+            }
+            /* insertion sort by sequence number */
+            unsigned i = used++;
+            while (i > 0 && sequence_[order[i - 1]] > seq)
+            {
+                order[i] = order[i - 1];
+                --i;
+            }
+            order[i] = s;
+            continue;
+        }
+        /* interrupted erase or interrupted header write */
+        sequence_[s] = 0;
+        for (unsigned blk = 0; blk < rawBlockCount_; ++blk)
+        {
+            if (!block_erased(s, blk))
+            {
+                flash_erase(s);
+                break;
+            }
+        }
+        ++freeCount_;
+    }
+
+    if (!used)
+    {
+        /* fresh flash */
+        headSector_ = sectorCount_ - 1;
+        open_head();
+        return;
+    }
+
+    /* replay the log, later slots override earlier ones */
+    for (unsigned i = 0; i < used; ++i)
+    {
+        unsigned s = order[i];
+        unsigned blk = 1;
+        for (; blk < rawBlockCount_; ++blk)
+        {
+            const uint32_t *slot = block(s, blk);
+            if (slot[0] == ERASED && block_erased(s, blk))
+            {
+                break;
+            }
+            if (!slot_valid(slot))
+            {
+                /* interrupted write, the slot is lost */
+                continue;
+            }
+            unsigned fblock = slot[0] >> 16;
+            uint16_t old = index_[fblock];
+            if (old)
+            {
+                --liveCount_[old / rawBlockCount_];
+            }
+            else
+            {
+                ++liveTotal_;
+            }
+            index_[fblock] = s * rawBlockCount_ + blk;
+            ++liveCount_[s];
+        }
+        headSector_ = s;
+        headNext_ = blk;
+    }
+}
+
+void WearLevelEEPROMEmulation::write(
+    unsigned int offset, const void *buf, size_t len)
+{
+    HASSERT((offset + len) <= file_size());
+
+    const uint8_t *byte_data = (const uint8_t *)buf;
+    while (len)
+    {
+        unsigned fblock = offset / payloadSize_;
+        unsigned lsa = offset - fblock * payloadSize_;
+        size_t write_size = payloadSize_ - lsa;
+        if (write_size > len)
+        {
+            write_size = len;
+        }
+        uint8_t data[MAX_BLOCK_SIZE];
+        read_fblock(fblock, data);
+        if (memcmp(data + lsa, byte_data, write_size) != 0)
+        {
+            /* at least some data has changed */
+            memcpy(data + lsa, byte_data, write_size);
+            make_room();
+            append(fblock, data);
+        }
+        offset += write_size;
+        len -= write_size;
+        byte_data += write_size;
+    }
+
+    updated_notification();
+}
+
+void WearLevelEEPROMEmulation::read(unsigned int offset, void *buf, size_t len)
+{
+    HASSERT((offset + len) <= file_size());
+
+    uint8_t *byte_data = (uint8_t *)buf;
+    while (len)
+    {
+        unsigned fblock = offset / payloadSize_;
+        unsigned lsa = offset - fblock * payloadSize_;
+        size_t copylen = payloadSize_ - lsa;
+        if (copylen > len)
+        {
+            copylen = len;
+        }
+        uint8_t data[MAX_BLOCK_SIZE];
+        read_fblock(fblock, data);
+        memcpy(byte_data, data + lsa, copylen);
+        offset += copylen;
+        byte_data += copylen;
+        len -= copylen;
+    }
+}
+
+void WearLevelEEPROMEmulation::read_fblock(unsigned fblock, uint8_t data[])
+{
+    uint16_t pos = index_[fblock];
+    if (pos == NONE)
+    {
+        memset(data, 0xFF, payloadSize_);
+        return;
+    }
+    const uint32_t *slot =
+        block(pos / rawBlockCount_, pos % rawBlockCount_);
+    memcpy(data, slot + 1, payloadSize_);
+}
+
+void WearLevelEEPROMEmulation::append(unsigned fblock, const uint8_t data[])
+{
+    if (headNext_ >= rawBlockCount_)
+    {
+        open_head();
+    }
+    uint32_t slot[MAX_BLOCK_SIZE / sizeof(uint32_t)];
+    memcpy(slot + 1, data, payloadSize_);
+    slot[0] = (fblock << 16) | checksum(fblock, slot + 1);
+    flash_program(headSector_, headNext_, slot, blockSize_);
+
+    uint16_t old = index_[fblock];
+    if (old)
+    {
+        --liveCount_[old / rawBlockCount_];
+    }
+    else
+    {
+        ++liveTotal_;
+    }
+    index_[fblock] = headSector_ * rawBlockCount_ + headNext_;
+    ++liveCount_[headSector_];
+    ++headNext_;
+}
+
+void WearLevelEEPROMEmulation::open_head()
+{
+    HASSERT(freeCount_ > 0);
+    /* take the erased sectors in round-robin order */
+    unsigned s = headSector_;
+    do
+    {
+        if (++s >= sectorCount_)
+        {
+            s = 0;
+        }
+    } while (sequence_[s] != 0);
+
+    uint32_t hdr[MAX_BLOCK_SIZE / sizeof(uint32_t)];
+    memset(hdr, 0xFF, sizeof(hdr));
+    hdr[0] = nextSequence_;
+    hdr[1] = ~nextSequence_;
+    flash_program(s, 0, hdr, blockSize_);
+    sequence_[s] = nextSequence_++;
+    --freeCount_;
+    headSector_ = s;
+    headNext_ = 1;
+}
+
+void WearLevelEEPROMEmulation::make_room()
+{
+    if (freeCount_ < FORCED_FREE_SECTORS && needs_compaction_locked())
+    {
+        compact_locked(SLOTS_PER_WRITE);
+    }
+    /* The last erased sector is reserved for the compaction to copy live
+     * data into. When it had to be taken, or the user data would have to
+     * take it, we finish compacting the victim before writing. Each round
+     * frees a sector, so this stops after at most sectorCount_ rounds given
+     * the file size limit. */
+    unsigned rounds = 0;
+    while (freeCount_ == 0 ||
+        (headNext_ >= rawBlockCount_ && freeCount_ < FORCED_FREE_SECTORS))
+    {
+        ++rounds;
+        HASSERT(rounds <= sectorCount_);
+        ++fullCompactions_;
+        compact_locked(UINT_MAX);
+    }
+}
+
+bool WearLevelEEPROMEmulation::compact_step(unsigned max_slots)
+{
+    OSMutexLock h(&lock_);
+    if (!needs_compaction_locked())
+    {
+        return false;
+    }
+    compact_locked(max_slots);
+    return needs_compaction_locked();
+}
+
+bool WearLevelEEPROMEmulation::needs_compaction()
+{
+    OSMutexLock h(&lock_);
+    return needs_compaction_locked();
+}
+
+bool WearLevelEEPROMEmulation::needs_compaction_locked()
+{
+    if (victim_ != NONE)
+    {
+        return true;
+    }
+    if (freeCount_ >= FREE_SECTOR_TARGET)
+    {
+        return false;
+    }
+    /* slots in all full sectors plus the written part of the head */
+    unsigned slots = (sectorCount_ - freeCount_ - 1) * (rawBlockCount_ - 1) +
+        headNext_ - 1;
+    return slots - liveTotal_ >= rawBlockCount_ - 1u;
+}
+
+bool WearLevelEEPROMEmulation::compact_locked(unsigned max_slots)
+{
+    if (victim_ == NONE)
+    {
+        /* oldest sector that is not the head */
+        unsigned best = sectorCount_;
+        for (unsigned s = 0; s < sectorCount_; ++s)
+        {
+            if (s == headSector_ || sequence_[s] == 0)
+            {
+                continue;
+            }
+            if (best == sectorCount_ || sequence_[s] < sequence_[best])
+            {
+                best = s;
+            }
+        }
+        if (best == sectorCount_)
+        {
+            return false;
+        }
+        victim_ = best + 1;
+        victimCursor_ = 1;
+    }
+    unsigned s = victim_ - 1;
+    while (liveCount_[s] && victimCursor_ < rawBlockCount_)
+    {
+        const uint32_t *slot = block(s, victimCursor_);
+        unsigned fblock = slot[0] >> 16;
+        if (fblock < fblockCount_ &&
+            index_[fblock] == s * rawBlockCount_ + victimCursor_)
+        {
+            if (!max_slots)
+            {
+                return true;
+            }
+            --max_slots;
+            uint8_t data[MAX_BLOCK_SIZE];
+            memcpy(data, slot + 1, payloadSize_);
+            append(fblock, data);
+            ++movedSlots_;
+        }
+        ++victimCursor_;
+    }
+    /* all live data is copied; the sector can be reused. */
+    HASSERT(liveCount_[s] == 0);
+    flash_erase(s);
+    sequence_[s] = 0;
+    ++freeCount_;
+    ++eraseCount_;
+    victim_ = NONE;
+    return true;
+}
+
+bool WearLevelEEPROMEmulation::block_erased(unsigned sector, unsigned blk)
+{
+    const uint32_t *p = block(sector, blk);
+    for (unsigned i = 0; i < blockSize_ / sizeof(uint32_t); ++i)
+    {
+        if (p[i] != ERASED)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool WearLevelEEPROMEmulation::slot_valid(const uint32_t *slot)
+{
+    unsigned fblock = slot[0] >> 16;
+    return fblock < fblockCount_ &&
+        (slot[0] & 0xFFFF) == checksum(fblock, slot + 1);
+}
+
+uint16_t WearLevelEEPROMEmulation::checksum(unsigned fblock, const void *payload)
+{
+    return crc_16_ibm(payload, payloadSize_) ^ fblock;
+}
@@ -0,0 +1,389 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file WearLevelEEPROMEmulation.hxx
+ * Log-structured EEPROM emulation in FLASH that spreads the data across many
+ * sectors and compacts incrementally.
+ *
+ * @author Balazs Racz
+ * @date 17 Oct 2026
+ */
+
+#ifndef _FREERTOS_DRIVERS_COMMON_WEARLEVELEEPROMEMULATION_HXX_
+#define _FREERTOS_DRIVERS_COMMON_WEARLEVELEEPROMEMULATION_HXX_
+
+#include <memory>
+
+#include "EEPROM.hxx"
+#include "executor/StateFlow.hxx"
+
+/** Emulates EEPROM in FLASH as a log spanning all sectors of the designated
+ * flash area. Compared to @ref EEPROMEmulation this mode trades a bit of RAM
+ * for much better flash utilization and bounded write latency.
+ *
+ * Theory of operation:
+ *
+ * The file is split into file blocks of (BLOCK_SIZE - 4) bytes. Every write
+ * of a file block appends a slot to the head sector of the log. When the head
+ * sector is full, the next erased sector becomes the head. Each sector starts
+ * with a header block holding a sequence number that is incremented every
+ * time a new head is opened; at mount the sectors are replayed in sequence
+ * order, and later slots override earlier ones. A RAM index (2 bytes per file
+ * block) tells where the latest slot of each file block is; reads never scan
+ * the log.
+ *
+ * Compaction (garbage collection) always picks the oldest sector. Slots in it
+ * that are still live are re-appended at the head, then the sector is
+ * erased. This walks all sectors round-robin, which also moves cold data
+ * around and spreads the erase cycles evenly. Compaction is incremental: @ref
+ * compact_step() moves a bounded number of slots per call, and is meant to be
+ * called from the background (see @ref WearLevelEEPROMCompactionFlow). If the
+ * background cannot keep up, write() does SLOTS_PER_WRITE moves inline per
+ * file block written, so a write never copies the entire file.
+ *
+ * Live data is always written to the new location before the old sector is
+ * erased, and the slots carry a checksum, so an interrupted write or erase at
+ * any point leaves the previous or the new contents of the written block.
+ *
+ * The layout of a sector:
+ *  - block 0: sequence number, ~sequence number. All 0xFF if erased.
+ *  - block 1..: slots. The first 32-bit word has the file block number in the
+ *    upper 16 bits and a CRC16 of the payload (xor the file block number) in
+ *    the lower 16 bits. The remaining BLOCK_SIZE - 4 bytes are payload.
+ *
+ * Capacity: up to (sector_count - 3) sectors worth of slots can be filled
+ * with live data; the remaining sectors are the head and the compaction
+ * reserve. With 8 sectors and 16-byte blocks this is 47% of the flash area,
+ * with 16 sectors and 32-byte blocks 71%, compared to the 25% of @ref
+ * EEPROMEmulation. Leaving more headroom reduces write amplification.
+ *
+ * Unlike @ref EEPROMEmulation the geometry is given to the constructor
+ * instead of link-time constants, so the board driver can derive it from the
+ * linker symbols of the flash area it chooses.
+ */
+class WearLevelEEPROMEmulation : public EEPROM
+{
+public:
+    /** Performs a bounded amount of compaction work. Thread-safe; takes the
+     * device lock.
+     * @param max_slots how many live slots may be copied in this call. At
+     * most one sector gets erased in each call.
+     * @return true if there is more compaction work to do.
+     */
+    bool compact_step(unsigned max_slots);
+
+    /// @return true if calling compact_step() would make progress.
+    bool needs_compaction();
+
+    /// @return the number of erased sectors available for the log.
+    unsigned free_sectors()
+    {
+        return freeCount_;
+    }
+
+    /// @return how many sectors were erased by compaction so far.
+    unsigned erase_count()
+    {
+        return eraseCount_;
+    }
+
+    /// @return how many live slots were copied by compaction so far.
+    unsigned moved_slots()
+    {
+        return movedSlots_;
+    }
+
+    /// @return how many times write() had to finish compacting an entire
+    /// sector because the reserve ran out.
+    unsigned full_compactions()
+    {
+        return fullCompactions_;
+    }
+
+    /** Computes the largest file size that fits into a given flash geometry.
+     * @param sector_count number of sectors in the flash area
+     * @param sector_size size of an independently erasable sector in bytes
+     * @param block_size size of one program operation in bytes
+     * @return maximum file size in bytes
+     */
+    static size_t max_file_size(
+        unsigned sector_count, size_t sector_size, size_t block_size)
+    {
+        return (sector_count - RESERVE_SECTORS) *
+            (sector_size / block_size - 1) * (block_size - 4);
+    }
+
+    /** Maximum byte size of a single block. */
+    static constexpr unsigned MAX_BLOCK_SIZE = 32;
+
+    /** Background compaction tries to keep this many sectors erased. */
+    static constexpr unsigned FREE_SECTOR_TARGET = 3;
+
+    /** When fewer sectors than this are erased, write() compacts inline. */
+    static constexpr unsigned FORCED_FREE_SECTORS = 2;
+
+    /** How many live slots write() moves per file block when compacting
+     * inline. */
+    static constexpr unsigned SLOTS_PER_WRITE = 4;
+
+protected:
+    /** Constructor.
+     * @param name device name
+     * @param file_size maximum file size that we can grow to. Must be at
+     * most max_file_size().
+     * @param sector_count number of independently erasable sectors, at least
+     * 4.
+     * @param sector_size size of a sector in bytes
+     * @param block_size how many bytes shall be flashed in one operation. A
+     * multiple of 4, between 8 and MAX_BLOCK_SIZE.
+     */
+    WearLevelEEPROMEmulation(const char *name, size_t file_size,
+        unsigned sector_count, size_t sector_size, size_t block_size);
+
+    /** Destructor.
+     */
+    ~WearLevelEEPROMEmulation()
+    {
+    }
+
+    /** Mount the EEPROM file. Should be called during construction of the
+     * derived class.
+     */
+    void mount();
+
+    /** Called after every write. Intended to be overridden in the
+     * application to get callbacks for eeprom writes that can trigger a
+     * reload. */
+    virtual void updated_notification()
+    {
+    }
+
+private:
+    /** Number of sectors that max_file_size() keeps out of the live data:
+     * one for the head and two for the compaction reserve. */
+    static constexpr unsigned RESERVE_SECTORS = 3;
+
+    /** Value of an erased flash word. */
+    static constexpr uint32_t ERASED = 0xFFFFFFFF;
+
+    /** Marks an index_ entry / victim_ as not present. */
+    static constexpr uint16_t NONE = 0;
+
+    /** Write to the EEPROM.  NOTE!!! This is not necessarily atomic across
+     * byte boundaries in the case of power loss.  The user should take this
+     * into account as it relates to data integrity of a whole block.
+     * @param offset index within EEPROM address space to start write
+     * @param buf data to write
+     * @param len length in bytes of data to write
+     */
+    void write(unsigned int offset, const void *buf, size_t len) OVERRIDE;
+
+    /** Read from the EEPROM.
+     * @param offset index within EEPROM address space to start read
+     * @param buf location to post read data
+     * @param len length in bytes of data to read
+     */
+    void read(unsigned int offset, void *buf, size_t len) OVERRIDE;
+
+    /** Reads the latest data of a file block.
+     * @param fblock file block number
+     * @param data location to place the data, payloadSize_ bytes
+     */
+    void read_fblock(unsigned fblock, uint8_t data[]);
+
+    /** Appends a slot to the head of the log and updates the index.
+     * @param fblock file block number
+     * @param data payloadSize_ bytes of payload
+     */
+    void append(unsigned fblock, const uint8_t data[]);
+
+    /** Makes sure that a slot can be appended by a user write, running
+     * compaction as needed. */
+    void make_room();
+
+    /** Compaction implementation; caller holds lock_.
+     * @param max_slots how many live slots may be copied.
+     * @return false if there was nothing to compact.
+     */
+    bool compact_locked(unsigned max_slots);
+
+    /** @return true if compaction is in progress or it would reclaim at
+     * least one sector worth of slots. Caller holds lock_. */
+    bool needs_compaction_locked();
+
+    /** Erases the head of the free list and programs its header.  */
+    void open_head();
+
+    /** @return true if the entire block is erased.
+     * @param sector sector number
+     * @param blk raw block index within the sector */
+    bool block_erased(unsigned sector, unsigned blk);
+
+    /** Checks the checksum of a slot.
+     * @param slot pointer to the slot data from @ref block().
+     * @return true if the slot is intact. */
+    bool slot_valid(const uint32_t *slot);
+
+    /** Computes the checksum for a slot.
+     * @param fblock file block number
+     * @param payload pointer to the payload words
+     * @return 16-bit check value */
+    uint16_t checksum(unsigned fblock, const void *payload);
+
+    /**
+     * Computes the pointer to load the data stored in a specific block from.
+     * @param sector sector number [0..sectorCount_ - 1]
+     * @param offset block index within sector, [0..rawBlockCount_ - 1]
+     * @return pointer to the beginning of the data in the block. Must be
+     * alive until the next call to this function.
+     */
+    virtual const uint32_t *block(unsigned sector, unsigned offset) = 0;
+
+    /** Simple hardware abstraction for FLASH erase API.
+     * @param sector Number of sector [0.. sectorCount_ - 1] to erase
+     */
+    virtual void flash_erase(unsigned sector) = 0;
+
+    /** Simple hardware abstraction for FLASH program API.
+     * @param sector the sector to write to [0..sectorCount_ - 1]
+     * @param start_block the block index to start writing to
+     * [0..rawBlockCount_ - 1]
+     * @param data a pointer to the data to be programmed
+     * @param byte_count the number of bytes to be programmed. Must be a
+     * multiple of BLOCK_SIZE
+     */
+    virtual void flash_program(unsigned sector, unsigned start_block,
+        uint32_t *data, uint32_t byte_count) = 0;
+
+    /** Total number of sectors. */
+    const uint8_t sectorCount_;
+    /** Bytes flashed in one operation. */
+    const uint8_t blockSize_;
+    /** Data bytes stored in a slot. */
+    const uint8_t payloadSize_;
+    /** How many blocks are there in a sector. */
+    const uint16_t rawBlockCount_;
+    /** Number of file blocks. */
+    const uint16_t fblockCount_;
+
+    /** Index of the sector currently being appended to. */
+    uint8_t headSector_{0};
+    /** Sector being compacted, or NONE. Stored as sector + 1. */
+    uint8_t victim_{NONE};
+    /** Number of erased sectors. */
+    uint8_t freeCount_{0};
+    /** Raw block index of the next slot to write in the head sector. */
+    uint16_t headNext_{0};
+    /** Next raw block to examine in the victim sector. */
+    uint16_t victimCursor_{0};
+    /** Number of file blocks that have a slot. */
+    uint16_t liveTotal_{0};
+    /** Sequence number for the next head sector. */
+    uint32_t nextSequence_{1};
+
+    /** Per sector sequence number from the header; 0 if erased. */
+    std::unique_ptr<uint32_t[]> sequence_;
+    /** Per sector count of slots that are referenced from index_. */
+    std::unique_ptr<uint16_t[]> liveCount_;
+    /** For each file block sector * rawBlockCount_ + raw block of its latest
+     * slot, or NONE if it was never written (raw block 0 is the sector
+     * header, never a slot). */
+    std::unique_ptr<uint16_t[]> index_;
+
+    /// Statistics for compact steps.
+    unsigned eraseCount_{0};
+    /// Statistics for compact steps.
+    unsigned movedSlots_{0};
+    /// Statistics for write().
+    unsigned fullCompactions_{0};
+
+    /** Default constructor.
+     */
+    WearLevelEEPROMEmulation();
+
+    DISALLOW_COPY_AND_ASSIGN(WearLevelEEPROMEmulation);
+};
+
+/** Runs the compaction of a WearLevelEEPROMEmulation on an executor, a few
+ * slots at a time, so that write() calls do not need to. */
+class WearLevelEEPROMCompactionFlow : public StateFlowBase
+{
+public:
+    /** Constructor. Starts the flow.
+     * @param service defines which executor to run on
+     * @param eeprom the device to compact
+     * @param slots_per_step how many slots to copy before yielding the
+     * executor
+     * @param idle_nsec how often to check for work when there is nothing to
+     * do.
+     */
+    WearLevelEEPROMCompactionFlow(Service *service,
+        WearLevelEEPROMEmulation *eeprom, unsigned slots_per_step = 8,
+        long long idle_nsec = MSEC_TO_NSEC(100))
+        : StateFlowBase(service)
+        , eeprom_(eeprom)
+        , slotsPerStep_(slots_per_step)
+        , idleNsec_(idle_nsec)
+    {
+        start_flow(STATE(check));
+    }
+
+    /** Terminates the flow. Must be called on the executor. The object may
+     * be destroyed once the executor has run. */
+    void shutdown()
+    {
+        shutdown_ = true;
+        timer_.ensure_triggered();
+    }
+
+private:
+    /// Checks for work and runs one step of compaction.
+    Action check()
+    {
+        if (shutdown_)
+        {
+            return exit();
+        }
+        if (eeprom_->compact_step(slotsPerStep_))
+        {
+            return yield_and_call(STATE(check));
+        }
+        return sleep_and_call(&timer_, idleNsec_, STATE(check));
+    }
+
+    /// Device to compact.
+    WearLevelEEPROMEmulation *eeprom_;
+    /// Argument to compact_step.
+    unsigned slotsPerStep_;
+    /// Polling period when idle.
+    long long idleNsec_;
+    /// Set to true to exit the flow.
+    bool shutdown_{false};
+    /// Helper for sleeping.
+    StateFlowTimer timer_{this};
+};
+
+#endif /* _FREERTOS_DRIVERS_COMMON_WEARLEVELEEPROMEMULATION_HXX_ */
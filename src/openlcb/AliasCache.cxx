@@ -265,6 +265,15 @@ int AliasCache::check_consistency()
 
 void AliasCache::clear()
 {
+    if (updateCallback)
+    {
+        for (auto it = idMap.begin(); it != idMap.end(); ++it)
+        {
+            Metadata *m = it->deref(this);
+            (*updateCallback)(
+                updateContext, m->get_node_id(), m->alias_, m - pool, false);
+        }
+    }
     idMap.clear();
     aliasMap.clear();
     oldest.idx_ = NONE_ENTRY;
@@ -361,6 +370,12 @@ void AliasCache::add(NodeID id, NodeAlias alias)
         aliasMap.erase(aliasMap.find(insert->alias_));
         idMap.erase(idMap.find(insert->get_node_id()));
 
+        if (updateCallback)
+        {
+            (*updateCallback)(updateContext, insert->get_node_id(),
+                insert->alias_, insert - pool, false);
+        }
+
         if (removeCallback)
         {
             /* tell the interface layer that we removed this mapping */
@@ -402,6 +417,11 @@ void AliasCache::add(NodeID id, NodeAlias alias)
 
     newest = n;
 
+    if (updateCallback)
+    {
+        (*updateCallback)(updateContext, id, alias, n.idx_, true);
+    }
+
 #if defined(TEST_CONSISTENCY)
     consistency_result = check_consistency();
     HASSERT(0 == consistency_result);
@@ -422,6 +442,11 @@ void AliasCache::remove(NodeAlias alias)
         Metadata *metadata = it->deref(this);
         aliasMap.erase(it);
         idMap.erase(idMap.find(metadata->get_node_id()));
+        if (updateCallback)
+        {
+            (*updateCallback)(updateContext, metadata->get_node_id(), alias,
+                metadata - pool, false);
+        }
         // Ensures that the AME query handler does not find this metadata.
         metadata->set_node_id(0);
 
@@ -109,6 +109,28 @@ public:
         clear();
     }
 
+    /// Callback type for set_update_callback().
+    /// @param context the context pointer given at registration.
+    /// @param id node ID of the mapping.
+    /// @param alias alias of the mapping.
+    /// @param entry index of the mapping in the cache, see retrieve() and
+    /// touch_entry(). Valid while the mapping exists.
+    /// @param added true if the mapping was added, false if it was removed.
+    typedef void (*UpdateCallback)(void *context, NodeID id, NodeAlias alias,
+        unsigned entry, bool added);
+
+    /** Registers a callback that will be told about every mapping added to or
+     * removed from the cache, including by remove() and clear(). This allows
+     * the interface to keep its own index of the local aliases in sync.
+     * @param callback function to call, or nullptr to unregister.
+     * @param context context pointer to pass to callback.
+     */
+    void set_update_callback(UpdateCallback callback, void *context)
+    {
+        updateCallback = callback;
+        updateContext = context;
+    }
+
     /// Sentinel entry for empty lists.
     static constexpr uint16_t NONE_ENTRY = 0xFFFFu;
 
@@ -153,6 +175,16 @@ public:
         return entries;
     }
 
+    /** Marks an entry as the most recently used one, like a lookup would.
+     * Takes constant time.
+     * @param entry index of a mapping, as given to the UpdateCallback.
+     */
+    void touch_entry(unsigned entry)
+    {
+        HASSERT(entry < size());
+        touch(pool + entry);
+    }
+
     /** Retrieves an entry by index. Allows stable iteration in the face of
      * changes.
      * @param entry is between 0 and size() - 1.
@@ -366,6 +398,12 @@ private:
     /** context pointer to pass in with remove_callback */
     void *context;
 
+    /** callback function to be used for every change in the cache */
+    UpdateCallback updateCallback {nullptr};
+
+    /** context pointer to pass in with updateCallback */
+    void *updateContext {nullptr};
+
     /** Update the time stamp for a given entry.
      * @param  metadata metadata associated with the entry
      */
@@ -36,6 +36,9 @@
 #define _OPENLCB_APPLICATIONCHECKSUM_HXX_
 
 #include "openlcb/bootloader_hal.h"
+#ifdef BOOTLOADER_PAGE_CHECKSUM
+#include "utils/Crc.hxx"
+#endif
 
 extern "C" {
 /** @returns true if the application checksum currently in flash is correct. */
@@ -72,6 +75,43 @@ bool check_application_checksum()
     }
     return true;
 }
+
+#ifdef BOOTLOADER_PAGE_CHECKSUM
+/** Computes the checksum of the flash page that contains a given offset of
+ * the firmware space. The checksum is computed with crc3_crc16_ibm, so that a
+ * host can compare it against the image it is about to write.
+ * @param offset is relative to the beginning of the flash.
+ * @param page_offset will be set to the start of the page, relative to the
+ * beginning of the flash.
+ * @param page_length will be set to the length of the page in bytes, clipped
+ * to the end of the flash.
+ * @param checksum is the output buffer of 3 halfwords.
+ * @returns false if offset is out of the flash boundaries. */
+bool get_flash_page_checksum(uint32_t offset, uint32_t *page_offset,
+    uint32_t *page_length, uint16_t *checksum)
+{
+    const void *flash_min;
+    const void *flash_max;
+    const struct app_header *app_header_ptr;
+    get_flash_boundaries(&flash_min, &flash_max, &app_header_ptr);
+    if (offset >= (uintptr_t)flash_max - (uintptr_t)flash_min)
+    {
+        return false;
+    }
+    const void *page_start;
+    uint32_t length;
+    get_flash_page_info(
+        static_cast<const uint8_t *>(flash_min) + offset, &page_start, &length);
+    if ((uintptr_t)page_start + length > (uintptr_t)flash_max)
+    {
+        length = (uintptr_t)flash_max - (uintptr_t)page_start;
+    }
+    *page_offset = (uintptr_t)page_start - (uintptr_t)flash_min;
+    *page_length = length;
+    crc3_crc16_ibm(page_start, length, checksum);
+    return true;
+}
+#endif // BOOTLOADER_PAGE_CHECKSUM
 }
 
 #endif // _OPENLCB_APPLICATIONCHECKSUM_HXX_
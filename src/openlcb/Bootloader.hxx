@@ -29,6 +29,11 @@
  * A standalone NMRAnet stack with the sole purpose of reflashing a
  * microcontroller.
  *
+ * Define BOOTLOADER_STREAM and/or BOOTLOADER_DATAGRAM to select the transfer
+ * method. Define BOOTLOADER_PAGE_CHECKSUM to export per-page checksums in
+ * FirmwareUpgradeDefs::SPACE_FIRMWARE_PAGE_CHECKSUM, which allows the
+ * BootloaderClient to transfer only the pages that changed.
+ *
  * @author Balazs Racz
  * @date 8 Dec 2014
  */
@@ -47,6 +52,7 @@
 #include "openlcb/CanDefs.hxx"
 #include "openlcb/DatagramDefs.hxx"
 #include "openlcb/Defs.hxx"
+#include "openlcb/FirmwareUpgradeDefs.hxx"
 #include "openlcb/MemoryConfig.hxx"
 #include "openlcb/bootloader_hal.h"
 #include "can_frame.h"
@@ -99,7 +105,11 @@ struct BootloaderState
     NodeAlias datagram_dst;
     uint8_t datagram_dlc;
     uint8_t datagram_offset;
+#ifdef BOOTLOADER_PAGE_CHECKSUM
+    uint8_t datagram_payload[7 + FirmwareUpgradeDefs::PAGE_CHECKSUM_LENGTH];
+#else
     uint8_t datagram_payload[14];
+#endif
 
     // Node that is sending us the stream of data.
     NodeAlias write_src_alias;
@@ -287,6 +297,18 @@ uint32_t load_uint32_be(const uint8_t *ptr)
     return (ptr[0] << 24) | (ptr[1] << 16) | (ptr[2] << 8) | ptr[3];
 }
 
+/** Stores a 32-bit value in network-endian.
+    @param ptr is an unaligned pointer to ram.
+    @param value is the host endian value to store.
+ */
+void store_uint32_be(uint8_t *ptr, uint32_t value)
+{
+    ptr[0] = value >> 24;
+    ptr[1] = value >> 16;
+    ptr[2] = value >> 8;
+    ptr[3] = value;
+}
+
 /// turns an already prepared memory config response datagram into an error
 /// response.
 ///
@@ -512,6 +534,70 @@ void handle_memory_config_frame()
             }
             return;
         }
+#endif
+#ifdef BOOTLOADER_PAGE_CHECKSUM
+        case MemoryConfigDefs::COMMAND_READ:
+        {
+            if (state_.datagram_output_pending)
+            {
+                // No buffer for response datagram.
+                reject_datagram();
+                set_error_code(DatagramDefs::BUFFER_UNAVAILABLE);
+                return;
+            }
+            if (state_.input_frame.can_dlc < 8 ||
+                CanDefs::get_can_frame_type(GET_CAN_FRAME_ID_EFF(
+                    state_.input_frame)) != CanDefs::DATAGRAM_ONE_FRAME)
+            {
+                // Invalid request.
+                reject_datagram();
+                set_error_code(DatagramDefs::INVALID_ARGUMENTS);
+                return;
+            }
+            if (state_.input_frame.data[6] !=
+                FirmwareUpgradeDefs::SPACE_FIRMWARE_PAGE_CHECKSUM)
+            {
+                reject_datagram();
+                set_error_code(MemoryConfigDefs::ERROR_SPACE_NOT_KNOWN);
+                return;
+            }
+            // Replies OK.
+            set_can_frame_addressed(Defs::MTI_DATAGRAM_OK);
+            state_.input_frame_full = 0;
+
+            // Composes read reply datagram.
+            state_.datagram_dlc = 7;
+            memcpy(state_.datagram_payload, state_.input_frame.data, 7);
+            state_.datagram_payload[1] = MemoryConfigDefs::COMMAND_READ_REPLY;
+            state_.datagram_output_pending = 1;
+            state_.output_frame.data[state_.output_frame.can_dlc++] =
+                DatagramDefs::REPLY_PENDING;
+            state_.datagram_dst =
+                CanDefs::get_src(GET_CAN_FRAME_ID_EFF(state_.input_frame));
+            state_.datagram_offset = 0;
+
+            uint32_t page_offset;
+            uint32_t page_length;
+            uint16_t checksum[3];
+            if (!get_flash_page_checksum(
+                    load_uint32_be(state_.input_frame.data + 2), &page_offset,
+                    &page_length, checksum))
+            {
+                add_memory_config_error_response(
+                    MemoryConfigDefs::ERROR_OUT_OF_BOUNDS);
+                return;
+            }
+            store_uint32_be(state_.datagram_payload + 2, page_offset);
+            uint8_t *p = state_.datagram_payload + state_.datagram_dlc;
+            store_uint32_be(p, page_length);
+            for (unsigned i = 0; i < 3; ++i)
+            {
+                p[4 + 2 * i] = checksum[i] >> 8;
+                p[5 + 2 * i] = checksum[i] & 0xff;
+            }
+            state_.datagram_dlc += FirmwareUpgradeDefs::PAGE_CHECKSUM_LENGTH;
+            return;
+        }
 #endif
     } // switch
     reject_datagram();
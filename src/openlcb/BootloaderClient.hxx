@@ -34,6 +34,8 @@
  */
 
 #include <time.h>
+#include <memory>
+#include <vector>
 
 #include "openlcb/DatagramDefs.hxx"
 #include "openlcb/FirmwareUpgradeDefs.hxx"
@@ -42,6 +44,8 @@
 #include "openlcb/CanDefs.hxx"
 #include "openlcb/MemoryConfig.hxx"
 #include "openlcb/IfCan.hxx"
+#include "executor/CallableFlow.hxx"
+#include "utils/Crc.hxx"
 #include "utils/Ewma.hxx"
 
 namespace openlcb
@@ -55,6 +59,9 @@ struct BootloaderResponse
     uint16_t error_code{0};
     // Human-readable error string.
     string error_details;
+    /// Number of payload bytes transferred to the target. With a delta
+    /// update this is less than the size of the image.
+    uint32_t bytes_written{0};
 };
 
 /// Send a structure of this type to the BootloaderClient state flow to perform
@@ -72,6 +79,11 @@ struct BootloaderRequest
     uint8_t request_reboot_after{1};
     // Nonzero: skip the PIP request to the bootloader. Use streams.
     uint8_t skip_pip{0};
+    /// Nonzero: read the page checksums back from the target, and transfer
+    /// only the flash pages that differ from data. Needs the bootloader to
+    /// export FirmwareUpgradeDefs::SPACE_FIRMWARE_PAGE_CHECKSUM; if it does
+    /// not, the entire image is written.
+    uint8_t delta{0};
     /// Offset at which to start writing.
     uint32_t offset{0};
     /// Payload to write.
@@ -91,23 +103,35 @@ int g_bootloader_timeout_sec = 3;
 /// StateFlow performing the bootloading process.
 ///
 /// 1) allocates a datagram handler
-/// 2) sends a stream write request datagram to the target node
-/// 3) waits for the write stream response
-/// 4) sends the data using a manual implementaiton of the stream protocol
+/// 2) in delta mode, reads the checksum of every flash page covered by the
+/// image and compares them to the image, to find which ranges to write
+/// 3) sends a stream write request datagram to the target node
+/// 4) waits for the write stream response
+/// 5) sends the data using a manual implementaiton of the stream protocol
 /// (stream initiate; data send; wait for proceeds; stream close)
-/// 5) reboots the target node.
+/// 6) repeats 3-5 for every range that needs to be written
+/// 7) reboots the target node.
 ///
 /// This stateflow needs to get one message of type BootloaderRequest to
 /// perform the bootloading process on a single target.
 class BootloaderClient : public StateFlow<Buffer<BootloaderRequest>, QList<1>>
 {
 public:
-    BootloaderClient(
-        Node *node, DatagramService *if_datagram_service, IfCan *if_can)
+    /// Constructor.
+    /// @param node local node to send the requests from.
+    /// @param if_datagram_service datagram service of the node's interface.
+    /// @param if_can the CAN interface, used for sending stream data.
+    /// @param memcfg if not null, the response datagrams are received via
+    /// this memory config handler of node, instead of registering a datagram
+    /// handler directly. This is needed when more than one client is active
+    /// on the same node.
+    BootloaderClient(Node *node, DatagramService *if_datagram_service,
+        IfCan *if_can, MemoryConfigHandler *memcfg = nullptr)
         : StateFlow<Buffer<BootloaderRequest>, QList<1>>(node->iface())
         , node_(node)
         , datagramService_(if_datagram_service)
         , ifCan_(if_can)
+        , memCfg_(memcfg)
     {
     }
 
@@ -188,7 +212,8 @@ private:
     {
         if (message()->data()->skip_pip) {
             LOG(INFO, "Skipping PIP request. Using streams.");
-            return call_immediately(STATE(bootload_using_stream));
+            useStream_ = true;
+            return call_immediately(STATE(plan_transfer));
         }
         pipClient_.request(message()->data()->dst, node_, this);
         return wait_and_call(STATE(pip_response));
@@ -200,15 +225,194 @@ private:
             LOG(INFO,
                 "PIP request failed. Error code: %" PRIx32 ". Using streams.",
                 pipClient_.error_code());
-            return call_immediately(STATE(bootload_using_stream));
+            useStream_ = true;
         }
-        if (pipClient_.response() & Defs::STREAM) {
+        else if (pipClient_.response() & Defs::STREAM) {
             LOG(INFO, "Using streams for bootloading.");
-            return call_immediately(STATE(bootload_using_stream));
+            useStream_ = true;
         } else {
             LOG(INFO, "Using datagrams for bootloading.");
-            return call_immediately(STATE(bootload_using_datagrams));
+            useStream_ = false;
+        }
+        return call_immediately(STATE(plan_transfer));
+    }
+
+    /// Decides which parts of the image need to be written. dgClient_ is
+    /// held.
+    Action plan_transfer()
+    {
+        ranges_.clear();
+        nextRange_ = 0;
+        bytesWritten_ = 0;
+        if (!request()->delta || request()->data.empty())
+        {
+            return call_immediately(STATE(write_entire_image));
+        }
+        checksumOffset_ = request()->offset;
+        return call_immediately(STATE(read_page_checksum));
+    }
+
+    /// Sends a read request for the checksum of the flash page at
+    /// checksumOffset_.
+    Action read_page_checksum()
+    {
+        Buffer<GenMessage> *b;
+        mainBufferPool->alloc(&b);
+        b->data()->reset(Defs::MTI_DATAGRAM, node_->node_id(),
+            message()->data()->dst,
+            MemoryConfigDefs::read_datagram(
+                FirmwareUpgradeDefs::SPACE_FIRMWARE_PAGE_CHECKSUM,
+                checksumOffset_, FirmwareUpgradeDefs::PAGE_CHECKSUM_LENGTH));
+        b->set_done(n_.reset(this));
+        dgClient_->write_datagram(b);
+
+        responseDatagram_ = nullptr;
+        sleeping_ = false;
+        register_write_response_handler();
+        return wait_and_call(STATE(checksum_request_sent));
+    }
+
+    Action checksum_request_sent()
+    {
+        uint32_t dg_result = dgClient_->result();
+        if (responseDatagram_)
+        {
+            return call_immediately(STATE(checksum_response));
+        }
+        else if (dg_result & DatagramClient::OPERATION_SUCCESS)
+        {
+            sleeping_ = true;
+            return sleep_and_call(&timer_,
+                SEC_TO_NSEC(g_bootloader_timeout_sec),
+                STATE(checksum_response));
+        }
+        return delta_failed("Page checksum request rejected.");
+    }
+
+    Action checksum_response()
+    {
+        sleeping_ = false;
+        unregister_write_response_handler();
+        if (!responseDatagram_)
+        {
+            return delta_failed("Timed out waiting for page checksum.");
+        }
+        const auto &payload = responseDatagram_->data()->payload;
+        if (payload.size() < 7 + FirmwareUpgradeDefs::PAGE_CHECKSUM_LENGTH ||
+            (uint8_t)payload[1] != MemoryConfigDefs::COMMAND_READ_REPLY ||
+            (uint8_t)payload[6] !=
+                FirmwareUpgradeDefs::SPACE_FIRMWARE_PAGE_CHECKSUM)
+        {
+            return delta_failed("Page checksum read failed.");
+        }
+        const uint8_t *p = (const uint8_t *)payload.data();
+        uint32_t page_offset = load_be32(p + 2);
+        uint32_t page_length = load_be32(p + 7);
+        uint16_t remote_checksum[3];
+        for (unsigned i = 0; i < 3; ++i)
+        {
+            remote_checksum[i] = (p[11 + 2 * i] << 8) | p[12 + 2 * i];
+        }
+        if (page_offset != checksumOffset_ || !page_length)
+        {
+            // The image does not start at a page boundary. Writing it would
+            // erase the data before it, so we can not skip any page.
+            return delta_failed("Image is not aligned to flash pages.");
         }
+        responseDatagram_->unref();
+        responseDatagram_ = nullptr;
+
+        size_t begin = page_offset - request()->offset;
+        size_t end = std::min(request()->data.size(), begin + page_length);
+        // The rest of the last page is erased (0xFF) after writing.
+        string page = request()->data.substr(begin, end - begin);
+        page.resize(page_length, 0xff);
+        uint16_t local_checksum[3];
+        crc3_crc16_ibm(page.data(), page.size(), local_checksum);
+        if (memcmp(local_checksum, remote_checksum, sizeof(local_checksum)))
+        {
+            if (!ranges_.empty() && ranges_.back().second == begin)
+            {
+                ranges_.back().second = end;
+            }
+            else
+            {
+                ranges_.emplace_back(begin, end);
+            }
+        }
+        if (end < request()->data.size())
+        {
+            checksumOffset_ = page_offset + page_length;
+            return call_immediately(STATE(read_page_checksum));
+        }
+        size_t changed = 0;
+        for (const auto &r : ranges_)
+        {
+            changed += r.second - r.first;
+        }
+        LOG(INFO, "Delta update: %u of %u bytes need to be written.",
+            (unsigned)changed, (unsigned)request()->data.size());
+        return call_immediately(STATE(start_next_range));
+    }
+
+    /// Gives up on the delta update.
+    /// @param reason is logged.
+    Action delta_failed(const char *reason)
+    {
+        LOG(INFO, "%s Writing the entire image.", reason);
+        unregister_write_response_handler();
+        if (responseDatagram_)
+        {
+            responseDatagram_->unref();
+            responseDatagram_ = nullptr;
+        }
+        return call_immediately(STATE(write_entire_image));
+    }
+
+    Action write_entire_image()
+    {
+        ranges_.clear();
+        ranges_.emplace_back(0, request()->data.size());
+        return call_immediately(STATE(start_next_range));
+    }
+
+    /// Starts writing the next range. dgClient_ is held.
+    Action start_next_range()
+    {
+        if (nextRange_ >= ranges_.size())
+        {
+            return call_immediately(STATE(all_ranges_written));
+        }
+        bufferOffset_ = ranges_[nextRange_].first;
+        rangeEnd_ = ranges_[nextRange_].second;
+        ++nextRange_;
+        if (useStream_)
+        {
+            return call_immediately(STATE(bootload_using_stream));
+        }
+        else
+        {
+            return call_immediately(STATE(next_dg_write_datagram));
+        }
+    }
+
+    /// Called when there is nothing more to write. dgClient_ is held.
+    Action all_ranges_written()
+    {
+        if (message()->data()->request_reboot_after)
+        {
+            return call_immediately(STATE(reboot_with_dg_client));
+        }
+        datagramService_->client_allocator()->typed_insert(dgClient_);
+        return return_error(0, "Remote node left in bootloader.");
+    }
+
+    /// @return a big-endian 32-bit value.
+    /// @param p pointer to the first byte.
+    static uint32_t load_be32(const uint8_t *p)
+    {
+        return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) |
+            (uint32_t(p[2]) << 8) | p[3];
     }
 
     Action bootload_using_stream()
@@ -218,10 +422,11 @@ private:
         DatagramPayload payload;
         payload.push_back(DatagramDefs::CONFIGURATION);
         payload.push_back(MemoryConfigDefs::COMMAND_WRITE_STREAM);
-        payload.push_back(message()->data()->offset >> 24);
-        payload.push_back(message()->data()->offset >> 16);
-        payload.push_back(message()->data()->offset >> 8);
-        payload.push_back(message()->data()->offset);
+        uint32_t address = message()->data()->offset + bufferOffset_;
+        payload.push_back(address >> 24);
+        payload.push_back(address >> 16);
+        payload.push_back(address >> 8);
+        payload.push_back(address);
         payload.push_back(message()->data()->memory_space);
         localStreamId_ = allocate_local_stream_id();
         payload.push_back(localStreamId_);
@@ -237,7 +442,8 @@ private:
     }
 
     /// Datagram handler that listens to the incoming memoryconfig datagram for
-    /// the write stream response message.
+    /// the write stream response and the page checksum read response
+    /// messages.
     class WriteResponseHandler : public DefaultDatagramHandler
     {
     public:
@@ -256,8 +462,10 @@ private:
                     parent_->dst(), datagram->src) ||
                 datagram->payload.size() < 6 ||
                 datagram->payload[0] != DatagramDefs::CONFIGURATION ||
-                ((datagram->payload[1] & 0xF4) !=
-                    MemoryConfigDefs::COMMAND_WRITE_STREAM_REPLY))
+                (((datagram->payload[1] & 0xF4) !=
+                     MemoryConfigDefs::COMMAND_WRITE_STREAM_REPLY) &&
+                    ((datagram->payload[1] & 0xF0) !=
+                        MemoryConfigDefs::COMMAND_READ_REPLY)))
             {
                 // Uninteresting datagram.
                 return respond_reject(DatagramDefs::PERMANENT_ERROR);
@@ -373,6 +581,7 @@ private:
         unregister_write_response_handler();
         message()->data()->response->error_code = error_code;
         message()->data()->response->error_details = error_details;
+        message()->data()->response->bytes_written = bytesWritten_;
         if (responseDatagram_)
         {
             responseDatagram_->unref();
@@ -383,8 +592,19 @@ private:
 
     void register_write_response_handler()
     {
-        datagramService_->registry()->insert(
-            node_, DatagramDefs::CONFIGURATION, &writeResponseHandler_);
+        if (writeResponseRegistered_)
+        {
+            return;
+        }
+        if (memCfg_)
+        {
+            memCfg_->set_client(&writeResponseHandler_, dst());
+        }
+        else
+        {
+            datagramService_->registry()->insert(
+                node_, DatagramDefs::CONFIGURATION, &writeResponseHandler_);
+        }
         writeResponseRegistered_ = true;
     }
 
@@ -393,8 +613,15 @@ private:
         if (writeResponseRegistered_)
         {
             writeResponseRegistered_ = false;
-            datagramService_->registry()->erase(
-                node_, DatagramDefs::CONFIGURATION, &writeResponseHandler_);
+            if (memCfg_)
+            {
+                memCfg_->clear_client(&writeResponseHandler_);
+            }
+            else
+            {
+                datagramService_->registry()->erase(
+                    node_, DatagramDefs::CONFIGURATION, &writeResponseHandler_);
+            }
         }
     }
 
@@ -477,9 +704,8 @@ private:
                 "accepted stream request.");
         }
         availableBufferSize_ = maxBufferSize_;
-        bufferOffset_ = 0;
         speed_ = 0;
-        lastMeasurementOffset_ = 0;
+        lastMeasurementOffset_ = bufferOffset_;
         lastMeasurementTimeNsec_ = os_get_time_monotonic();
         node_->iface()->dispatcher()->register_handler(
             &streamProceedHandler_, Defs::MTI_STREAM_PROCEED, Defs::MTI_EXACT);
@@ -488,7 +714,7 @@ private:
 
     Action send_stream_data()
     {
-        if (bufferOffset_ >= message()->data()->data.size())
+        if (bufferOffset_ >= rangeEnd_)
         {
             return call_immediately(STATE(close_stream));
         }
@@ -507,8 +733,7 @@ private:
             &can_id, local_alias, remote_alias, CanDefs::STREAM_DATA);
         auto *frame = b->data()->mutable_frame();
         SET_CAN_FRAME_ID_EFF(*frame, can_id);
-        size_t len =
-            std::min(size_t(7), message()->data()->data.size() - bufferOffset_);
+        size_t len = std::min(size_t(7), rangeEnd_ - bufferOffset_);
         if (availableBufferSize_ < len)
         {
             len = availableBufferSize_;
@@ -517,6 +742,7 @@ private:
         frame->data[0] = remoteStreamId_;
         memcpy(&frame->data[1], &message()->data()->data[bufferOffset_], len);
         bufferOffset_ += len;
+        bytesWritten_ += len;
         availableBufferSize_ -= len;
         // LOG(INFO, "available buffer: %d", availableBufferSize_);
         b->set_done(n_.reset(this));
@@ -557,7 +783,7 @@ private:
         long long next_time = os_get_time_monotonic();
         float new_speed = next_time - lastMeasurementTimeNsec_;
         new_speed = float(bytes_sent) * 1e9 / new_speed;
-        if (!lastMeasurementOffset_)
+        if (!speed_)
         {
             speed_ = new_speed;
         }
@@ -569,9 +795,7 @@ private:
         clock_gettime(CLOCK_REALTIME, &ts);
         if (request()->progress_callback)
         {
-            float ofs = bufferOffset_;
-            ofs /= request()->data.size();
-            request()->progress_callback(ofs);
+            request()->progress_callback(progress());
         }
         LOG(INFO,
             "%02ld.%06ld stream offset: %" PRIdPTR "; wrote %.0lld usec slept "
@@ -627,11 +851,23 @@ private:
             message()->data()->dst,
             StreamDefs::create_close_request(localStreamId_, remoteStreamId_));
         node_->iface()->addressed_message_write_flow()->send(b);
+        if (nextRange_ < ranges_.size())
+        {
+            return allocate_and_call(STATE(next_range_dg_client),
+                datagramService_->client_allocator());
+        }
         // wait some time before sending the reset command.
         return sleep_and_call(
             &timer_, MSEC_TO_NSEC(200), STATE(send_reboot_request));
     }
 
+    Action next_range_dg_client()
+    {
+        dgClient_ =
+            full_allocation_result(datagramService_->client_allocator());
+        return call_immediately(STATE(start_next_range));
+    }
+
     Action send_reboot_request()
     {
         if (message()->data()->request_reboot_after) {
@@ -642,19 +878,12 @@ private:
         }
     }
 
-    Action bootload_using_datagrams()
-    {
-        // dgClient_ is active currently.
-        bufferOffset_ = 0;
-        return call_immediately(STATE(next_dg_write_datagram));
-    }
-
     Action next_dg_write_datagram()
     {
         Buffer<GenMessage> *b;
         mainBufferPool->alloc(&b);
         DatagramPayload payload = MemoryConfigDefs::write_datagram(message()->data()->memory_space, message()->data()->offset + bufferOffset_);
-        unsigned len = message()->data()->data.size() - bufferOffset_;
+        unsigned len = rangeEnd_ - bufferOffset_;
         if (len > 64) len = 64;
         payload.append(&message()->data()->data[bufferOffset_], len);
         b->set_done(n_.reset(this));
@@ -682,9 +911,10 @@ private:
                 "bootloader yet.");
         }
 
-        unsigned len = message()->data()->data.size() - bufferOffset_;
+        unsigned len = rangeEnd_ - bufferOffset_;
         if (len > 64) len = 64;
         bufferOffset_ += len;
+        bytesWritten_ += len;
 
         if ((bufferOffset_ & ~0xFF) != ((bufferOffset_ - len) & ~0xFF)) {
             speedAvg_.add_absolute(bufferOffset_);
@@ -692,20 +922,14 @@ private:
                 bufferOffset_, speedAvg_.avg());
             if (request()->progress_callback)
             {
-                float ofs = bufferOffset_;
-                ofs /= request()->data.size();
-                request()->progress_callback(ofs);
+                request()->progress_callback(progress());
             }
         }
 
-        if (bufferOffset_ < message()->data()->data.size()) {
+        if (bufferOffset_ < rangeEnd_) {
             return call_immediately(STATE(next_dg_write_datagram));
         }
-        if (message()->data()->request_reboot_after) {
-            return call_immediately(STATE(reboot_with_dg_client));
-        } else {
-            return return_error(0, "Remote node left in bootloader.");
-        }
+        return call_immediately(STATE(start_next_range));
     }
 
     Action reboot_dg_client()
@@ -733,6 +957,7 @@ private:
     Action finish()
     {
         auto result = dgClient_->result();
+        datagramService_->client_allocator()->typed_insert(dgClient_);
         result &= DatagramClient::RESPONSE_CODE_MASK;
         if (result == DatagramClient::DST_REBOOT ||
             result == DatagramClient::OPERATION_SUCCESS)
@@ -761,14 +986,25 @@ private:
             return return_error(result & 0xffff, "");
         }
         // Not sure what this is.
-        datagramService_->client_allocator()->typed_insert(dgClient_);
         return return_error(0, "");
     }
 
+    /// @return the fraction of the payload transferred so far.
+    float progress()
+    {
+        size_t total = 0;
+        for (const auto &r : ranges_)
+        {
+            total += r.second - r.first;
+        }
+        return total ? float(bytesWritten_) / total : 1.0f;
+    }
+
 private:
     Node *node_;
     DatagramService *datagramService_;
     IfCan *ifCan_;
+    MemoryConfigHandler *memCfg_;
     DatagramClient *dgClient_ = nullptr;
     Buffer<IncomingDatagram> *responseDatagram_ = nullptr;
     uint8_t localStreamId_;
@@ -785,6 +1021,18 @@ private:
     uint32_t availableBufferSize_;
     // The next byte we need to send from the input data.
     size_t bufferOffset_;
+    // End of the range of input data that we are currently sending.
+    size_t rangeEnd_;
+    // Ranges [begin, end) of the input data that need to be written.
+    std::vector<std::pair<size_t, size_t>> ranges_;
+    // Index into ranges_ of the next range to write.
+    unsigned nextRange_;
+    // Number of payload bytes sent so far.
+    size_t bytesWritten_{0};
+    // Memory space address of the next page checksum to read.
+    uint32_t checksumOffset_;
+    // true if the data is sent via stream, false if using datagrams.
+    bool useStream_;
 
     Ewma speedAvg_;
     // The Average speed (ewma) in bytes/second.
@@ -811,4 +1059,191 @@ private:
     PIPClient pipClient_{ifCan_};
 };
 
+/// Request structure for BootloaderFleet.
+struct BootloaderFleetRequest : public CallableFlowRequestBase
+{
+    /// Sets up a firmware update of many nodes.
+    /// @param n is the list of nodes to update.
+    /// @param tmpl is the bootload request to execute on every node. The dst
+    /// and response fields are ignored.
+    /// @param cb if specified, will be called after each node is done, with
+    /// the index of that node.
+    void reset(std::vector<NodeHandle> n, const BootloaderRequest &tmpl,
+        std::function<void(BootloaderFleetRequest *, unsigned)> cb = nullptr)
+    {
+        reset_base();
+        nodes = std::move(n);
+        request = tmpl;
+        responses.clear();
+        responses.resize(nodes.size());
+        num_failed = 0;
+        progressCb = std::move(cb);
+    }
+
+    /// Nodes to update.
+    std::vector<NodeHandle> nodes;
+    /// What to do with each node.
+    BootloaderRequest request;
+    /// Result for each node, same order as nodes.
+    std::vector<BootloaderResponse> responses;
+    /// Number of nodes where the update failed.
+    unsigned num_failed;
+    /// Callback to execute as nodes are finished.
+    std::function<void(BootloaderFleetRequest *, unsigned)> progressCb;
+};
+
+/// Updates the firmware of many nodes, with a BootloaderClient for each node
+/// that is updated in parallel. Nodes whose bootloader exports the page
+/// checksums can be updated in delta mode (BootloaderRequest::delta), which
+/// keeps the bus free for the other transfers.
+///
+/// The datagram service needs at least max_parallel datagram clients for the
+/// updates to actually run in parallel.
+class BootloaderFleet : public CallableFlow<BootloaderFleetRequest>
+{
+public:
+    /// Constructor.
+    /// @param node local node to send the requests from.
+    /// @param if_datagram_service datagram service of the node's interface.
+    /// @param if_can the CAN interface, used for sending stream data.
+    /// @param memcfg memory config handler of node; it routes the responses
+    /// to the clients by the remote node.
+    /// @param max_parallel how many nodes to update at the same time.
+    BootloaderFleet(Node *node, DatagramService *if_datagram_service,
+        IfCan *if_can, MemoryConfigHandler *memcfg, unsigned max_parallel)
+        : CallableFlow<BootloaderFleetRequest>(node->iface())
+    {
+        HASSERT(max_parallel > 0);
+        for (unsigned i = 0; i < max_parallel; ++i)
+        {
+            slots_.emplace_back(
+                new Slot(this, node, if_datagram_service, if_can, memcfg));
+        }
+    }
+
+    /// @return the maximum number of nodes that were updated at the same time
+    /// during the last request.
+    unsigned peak_parallel()
+    {
+        return peakActive_;
+    }
+
+private:
+    /// One client with the bookkeeping of which node it is working on.
+    class Slot : public Notifiable
+    {
+    public:
+        Slot(BootloaderFleet *parent, Node *node, DatagramService *dg,
+            IfCan *if_can, MemoryConfigHandler *memcfg)
+            : parent_(parent)
+            , client_(node, dg, if_can, memcfg)
+        {
+        }
+
+        /// Called when the client is done with the node.
+        void notify() override
+        {
+            parent_->node_done(this);
+        }
+
+        /// Owning flow.
+        BootloaderFleet *parent_;
+        /// Performs the bootloading of one node.
+        BootloaderClient client_;
+        /// Notified when the client released the request buffer.
+        BarrierNotifiable bn_;
+        /// Index of the node this slot is working on.
+        unsigned index_;
+    };
+
+    Action entry() override
+    {
+        nextNode_ = 0;
+        remaining_ = request()->nodes.size();
+        active_ = 0;
+        peakActive_ = 0;
+        lastError_ = 0;
+        if (!remaining_)
+        {
+            return return_ok();
+        }
+        for (auto &s : slots_)
+        {
+            if (!start_next(s.get()))
+            {
+                break;
+            }
+        }
+        return wait_and_call(STATE(all_done));
+    }
+
+    Action all_done()
+    {
+        if (request()->num_failed)
+        {
+            return return_with_error(lastError_);
+        }
+        return return_ok();
+    }
+
+    /// Starts updating the next node.
+    /// @param s an idle slot.
+    /// @return false if there are no more nodes to start.
+    bool start_next(Slot *s)
+    {
+        if (nextNode_ >= request()->nodes.size())
+        {
+            return false;
+        }
+        s->index_ = nextNode_++;
+        Buffer<BootloaderRequest> *b;
+        mainBufferPool->alloc(&b);
+        *b->data() = request()->request;
+        b->data()->dst = request()->nodes[s->index_];
+        b->data()->response = &request()->responses[s->index_];
+        b->set_done(s->bn_.reset(s));
+        if (++active_ > peakActive_)
+        {
+            peakActive_ = active_;
+        }
+        s->client_.send(b);
+        return true;
+    }
+
+    /// Called when a slot finished updating a node.
+    /// @param s the slot.
+    void node_done(Slot *s)
+    {
+        --active_;
+        --remaining_;
+        const BootloaderResponse &r = request()->responses[s->index_];
+        if (r.error_code)
+        {
+            ++request()->num_failed;
+            lastError_ = r.error_code;
+        }
+        if (request()->progressCb)
+        {
+            request()->progressCb(request(), s->index_);
+        }
+        if (!start_next(s) && !remaining_)
+        {
+            notify();
+        }
+    }
+
+    /// Parallel clients.
+    std::vector<std::unique_ptr<Slot>> slots_;
+    /// Index of the next node to start.
+    unsigned nextNode_ {0};
+    /// Number of nodes not finished yet.
+    unsigned remaining_ {0};
+    /// Number of slots working on a node.
+    unsigned active_ {0};
+    /// Maximum value of active_ in the current request.
+    unsigned peakActive_ {0};
+    /// Error code of the last failed node.
+    int lastError_ {0};
+};
+
 } // namespace openlcb
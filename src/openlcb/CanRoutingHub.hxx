@@ -80,25 +80,29 @@ public:
             b->unref();
             return;
         }
-        const string &p = *b->data();
-        for (unsigned i = 0; i < p.size(); ++i)
+        const char *data = b->data()->data();
+        size_t len = b->data()->size();
+        GcStreamParser &segmenter = it->second.segmenter_;
+        size_t consumed;
+        while (segmenter.consume_data(data, len, &consumed))
         {
-            if (it->second.segmenter_.consume_byte(p[i]))
+            data += consumed;
+            len -= consumed;
+            // We have a frame.
+            auto *cb = deliveryFlow_.alloc();
+            if (!segmenter.parse_frame_to_output(cb->data()->mutable_frame()))
             {
-                // We have a frame.
-                string ret;
-                it->second.segmenter_.frame_buffer(&ret);
-                LOG(VERBOSE, "sending frame: %s", ret.c_str());
-                auto *cb = deliveryFlow_.alloc();
-                HASSERT(it->second.segmenter_.parse_frame_to_output(
-                    cb->data()->mutable_frame()));
-                cb->data()->skipMember_ = reinterpret_cast<
-                    FlowInterface<Buffer<HubContainer<CanFrameContainer>>> *>(
-                    b->data()->skipMember_);
-                deliveryFlow_.send(
-                    cb, reprioritize_frame(cb->data()->frame(), priority));
+                // Malformed frame.
+                cb->unref();
+                continue;
             }
+            cb->data()->skipMember_ = reinterpret_cast<
+                FlowInterface<Buffer<HubContainer<CanFrameContainer>>> *>(
+                b->data()->skipMember_);
+            deliveryFlow_.send(
+                cb, reprioritize_frame(cb->data()->frame(), priority));
         }
+        b->unref();
     }
 
     CanHubPortInterface *can_hub()
@@ -165,12 +165,7 @@ public:
         uint64_t buffer_key = id & (CanDefs::DST_MASK | CanDefs::SRC_MASK);
 
         dst_.alias = buffer_key >> (CanDefs::DST_SHIFT);
-        dstNode_ = nullptr;
-        dst_.id = if_can()->local_aliases()->lookup(NodeAlias(dst_.alias));
-        if (dst_.id)
-        {
-            dstNode_ = if_can()->lookup_local_node(dst_.id);
-        }
+        dst_.id = if_can()->lookup_local_alias(NodeAlias(dst_.alias), &dstNode_);
         if (!dstNode_)
         {
             // Destination not local node.
@@ -160,4 +160,276 @@ TreeEventHandlers::TreeEventHandlers()
 {
 }
 
+constexpr uint32_t HashEventHandlers::DELETED_SLOT;
+constexpr unsigned HashEventHandlers::MIN_SLOTS;
+
+HashEventHandlers::HashEventHandlers()
+{
+    AtomicHolder h(this);
+    rehash(0);
+}
+
+void HashEventHandlers::register_handler(
+    const EventRegistryEntry &entry, unsigned mask)
+{
+    AtomicHolder h(this);
+    LOG(VERBOSE, "%p: register %p", this, entry.handler);
+    set_dirty();
+    if (mask == 0)
+    {
+        if ((numExact_ + numDeleted_ + 1) * 4 > slots_.size() * 3)
+        {
+            rehash(numExact_ + 1);
+        }
+        insert_exact(entry);
+        return;
+    }
+    RangeEntry re(entry, mask);
+    ranges_.insert(
+        std::upper_bound(ranges_.begin(), ranges_.end(), re, RangeCmp()), re);
+}
+
+void HashEventHandlers::unregister_handler(
+    EventHandler *handler, uint32_t user_arg, uint32_t user_arg_mask)
+{
+    AtomicHolder h(this);
+    set_dirty();
+    LOG(VERBOSE, "%p: unregister %p", this, handler);
+    auto matches = [handler, user_arg, user_arg_mask](
+                       const EventRegistryEntry &e) {
+        return e.handler == handler &&
+            ((e.user_arg & user_arg_mask) == (user_arg & user_arg_mask));
+    };
+    for (auto &e : slots_)
+    {
+        if (!is_free(e) && matches(e))
+        {
+            e.handler = nullptr;
+            e.user_arg = DELETED_SLOT;
+            --numExact_;
+            ++numDeleted_;
+        }
+    }
+    ranges_.erase(std::remove_if(ranges_.begin(), ranges_.end(),
+                      [&matches](const RangeEntry &r) {
+                          return matches(r.entry);
+                      }),
+        ranges_.end());
+}
+
+void HashEventHandlers::reserve(size_t count)
+{
+    AtomicHolder h(this);
+    if ((numExact_ + numDeleted_ + count) * 4 > slots_.size() * 3)
+    {
+        rehash(numExact_ + count);
+    }
+}
+
+void HashEventHandlers::insert_exact(const EventRegistryEntry &entry)
+{
+    unsigned mask = slots_.size() - 1;
+    for (unsigned i = hash_slot(entry.event);; i = (i + 1) & mask)
+    {
+        if (is_free(slots_[i]))
+        {
+            if (!is_empty(slots_[i]))
+            {
+                --numDeleted_;
+            }
+            slots_[i] = entry;
+            ++numExact_;
+            return;
+        }
+    }
+}
+
+void HashEventHandlers::rehash(size_t count)
+{
+    unsigned bits = 4;
+    while ((1u << bits) < MIN_SLOTS || (1u << bits) * 3 < count * 4 + 4)
+    {
+        ++bits;
+    }
+    std::vector<EventRegistryEntry> old(
+        1u << bits, EventRegistryEntry(nullptr, 0, 0));
+    old.swap(slots_);
+    slotBits_ = bits;
+    numExact_ = 0;
+    numDeleted_ = 0;
+    for (const auto &e : old)
+    {
+        if (!is_free(e))
+        {
+            insert_exact(e);
+        }
+    }
+}
+
+/// Class representing the iteration state on the hash table-based event
+/// handler registry.
+class HashEventHandlers::Iterator : public EventIterator
+{
+public:
+    Iterator(HashEventHandlers *parent)
+        : parent_(parent)
+    {
+        clear_iteration();
+    }
+
+    EventRegistryEntry *next_entry() OVERRIDE
+    {
+        AtomicHolder h(parent_);
+        if (phase_ == EXACT_PROBE)
+        {
+            auto &slots = parent_->slots_;
+            unsigned mask = slots.size() - 1;
+            while (slot_ < slots.size() && !is_empty(slots[slot_]))
+            {
+                EventRegistryEntry *e = &slots[slot_];
+                slot_ = (slot_ + 1) & mask;
+                if (slot_ == probeStart_)
+                {
+                    // Wrapped around the entire table.
+                    slot_ = slots.size();
+                }
+                if (!is_free(*e) && e->event == currentReport_->event)
+                {
+                    return e;
+                }
+            }
+            start_ranges();
+        }
+        if (phase_ == EXACT_SCAN)
+        {
+            auto &slots = parent_->slots_;
+            while (slot_ < slots.size())
+            {
+                EventRegistryEntry *e = &slots[slot_++];
+                if (!is_free(*e) && e->event >= currentReport_->event &&
+                    e->event <= currentReport_->event + currentReport_->mask)
+                {
+                    return e;
+                }
+            }
+            start_ranges();
+        }
+        if (phase_ == RANGES)
+        {
+            auto &ranges = parent_->ranges_;
+            while (true)
+            {
+                if (rangeIdx_ < rangeEnd_ && rangeIdx_ < ranges.size())
+                {
+                    return &ranges[rangeIdx_++].entry;
+                }
+                if (groupStart_ >= ranges.size())
+                {
+                    break;
+                }
+                setup_mask_group();
+            }
+            phase_ = DONE;
+        }
+        return nullptr;
+    }
+
+    void clear_iteration() OVERRIDE
+    {
+        phase_ = DONE;
+    }
+
+    void init_iteration(EventReport *r) OVERRIDE
+    {
+        AtomicHolder h(parent_);
+        currentReport_ = r;
+        if (r->mask == 0)
+        {
+            phase_ = EXACT_PROBE;
+            slot_ = probeStart_ = parent_->hash_slot(r->event);
+        }
+        else
+        {
+            phase_ = EXACT_SCAN;
+            slot_ = 0;
+        }
+    }
+
+private:
+    /// Switches the iteration to the range registrations.
+    void start_ranges()
+    {
+        phase_ = RANGES;
+        groupStart_ = 0;
+        rangeIdx_ = 0;
+        rangeEnd_ = 0;
+    }
+
+    /// Finds the matching entries in the group of range registrations (with
+    /// the same mask width) that starts at groupStart_. Sets rangeIdx_ and
+    /// rangeEnd_ to the matching section, and groupStart_ to the beginning of
+    /// the next group.
+    void setup_mask_group()
+    {
+        auto &ranges = parent_->ranges_;
+        uint8_t mask_log = ranges[groupStart_].mask;
+        auto begin = ranges.begin() + groupStart_;
+        auto group_end = std::upper_bound(begin, ranges.end(),
+            RangeEntry(EventRegistryEntry(nullptr, UINT64_MAX), mask_log),
+            RangeCmp());
+        groupStart_ = group_end - ranges.begin();
+        if (mask_log >= 64)
+        {
+            // 64 bits -> all events go to everyone.
+            rangeIdx_ = begin - ranges.begin();
+            rangeEnd_ = groupStart_;
+            return;
+        }
+        uint64_t current_mask = (1ULL << mask_log) - 1;
+        uint64_t lo = currentReport_->event & (~current_mask);
+        uint64_t hi = currentReport_->event + currentReport_->mask;
+        auto lo_it = std::lower_bound(begin, group_end,
+            RangeEntry(EventRegistryEntry(nullptr, lo), mask_log), RangeCmp());
+        auto hi_it = std::upper_bound(lo_it, group_end,
+            RangeEntry(EventRegistryEntry(nullptr, hi), mask_log), RangeCmp());
+        rangeIdx_ = lo_it - ranges.begin();
+        rangeEnd_ = hi_it - ranges.begin();
+    }
+
+    /// Iteration phases.
+    enum Phase : uint8_t
+    {
+        /// Probing the hash table for an exact event.
+        EXACT_PROBE,
+        /// Scanning the entire hash table for a range of events.
+        EXACT_SCAN,
+        /// Going through the range registrations.
+        RANGES,
+        /// Iteration done.
+        DONE
+    };
+
+    /// Registry we are iterating.
+    HashEventHandlers *parent_;
+    /// Event report we are looking for.
+    EventReport *currentReport_;
+    /// Next slot to look at in the hash table.
+    unsigned slot_;
+    /// First probed slot (to detect wrap-around).
+    unsigned probeStart_;
+    /// Next range registration to return.
+    unsigned rangeIdx_;
+    /// End of the matching range registrations in the current mask group.
+    unsigned rangeEnd_;
+    /// Start of the next mask group to look at.
+    unsigned groupStart_;
+    /// Where we are in the iteration.
+    Phase phase_;
+};
+
+EventIterator *HashEventHandlers::create_iterator()
+{
+    return new Iterator(this);
+}
+
 } // namespace openlcb
@@ -187,6 +187,108 @@ private:
     MaskLookupMap handlers_;
 };
 
+/// EventRegistry implementation that keeps the single-event registrations
+/// (mask 0) in an open-addressing hash table, and the range registrations in
+/// a flat vector sorted by mask width and event ID. An incoming event report
+/// (mask 0) is a hash table probe plus one binary search per distinct range
+/// width, independent of how many single events are registered.
+///
+/// Select this implementation for the EventService by defining
+/// OPENMRN_FEATURE_EVENT_REGISTRY_HASH (see openmrn_features.h).
+class HashEventHandlers : public EventRegistry, private Atomic
+{
+public:
+    HashEventHandlers();
+
+    EventIterator *create_iterator() OVERRIDE;
+    void register_handler(
+        const EventRegistryEntry &entry, unsigned mask) OVERRIDE;
+    void unregister_handler(EventHandler *handler, uint32_t user_arg = 0,
+        uint32_t user_arg_mask = 0) OVERRIDE;
+    void reserve(size_t count) OVERRIDE;
+
+private:
+    class Iterator;
+    friend class Iterator;
+
+    /// A registration for a range of events.
+    struct RangeEntry
+    {
+        RangeEntry(const EventRegistryEntry &e, unsigned m)
+            : entry(e)
+            , mask(m)
+        {
+        }
+        /// Registration.
+        EventRegistryEntry entry;
+        /// How many bits wide the registration is (0..64).
+        uint8_t mask;
+    };
+
+    /// Comparison operator for sorting the range registrations.
+    struct RangeCmp
+    {
+        bool operator()(const RangeEntry &a, const RangeEntry &b) const
+        {
+            if (a.mask != b.mask)
+            {
+                return a.mask < b.mask;
+            }
+            return a.entry.event < b.entry.event;
+        }
+    };
+
+    /// Marker in the user_arg field of an empty hash slot (handler ==
+    /// nullptr) that shows that the slot was previously used. Probe sequences
+    /// must continue past such slots.
+    static constexpr uint32_t DELETED_SLOT = 1;
+
+    /// Minimum number of slots in the hash table.
+    static constexpr unsigned MIN_SLOTS = 16;
+
+    /// @return the first slot to probe for an event ID.
+    /// @param event the event ID to look up.
+    unsigned hash_slot(EventId event)
+    {
+        return (event * 0x9E3779B97F4A7C15ULL) >> (64 - slotBits_);
+    }
+
+    /// @return true if a slot is not holding a registration.
+    /// @param e slot in the hash table.
+    static bool is_free(const EventRegistryEntry &e)
+    {
+        return e.handler == nullptr;
+    }
+
+    /// @return true if a slot was never used (terminates probe sequences).
+    /// @param e slot in the hash table.
+    static bool is_empty(const EventRegistryEntry &e)
+    {
+        return e.handler == nullptr && e.user_arg != DELETED_SLOT;
+    }
+
+    /// Adds an entry to the hash table. Does not grow the table. Must be
+    /// called with the lock held.
+    void insert_exact(const EventRegistryEntry &entry);
+
+    /// Rebuilds the hash table with enough space for a given number of
+    /// entries. Removes deleted slots. Must be called with the lock held.
+    /// @param count how many entries the table should have space for.
+    void rehash(size_t count);
+
+    /// Open-addressing hash table of the mask 0 registrations with linear
+    /// probing. Size is always a power of two.
+    std::vector<EventRegistryEntry> slots_;
+    /// Range registrations sorted by RangeCmp.
+    std::vector<RangeEntry> ranges_;
+    /// Number of live entries in slots_.
+    unsigned numExact_ {0};
+    /// Number of deleted slots in slots_.
+    unsigned numDeleted_ {0};
+    /// log2 of slots_.size().
+    uint8_t slotBits_ {0};
+};
+
 }; /* namespace openlcb */
 
 #endif  // _OPENLCB_EVENTHANDLERCONTAINER_HXX_
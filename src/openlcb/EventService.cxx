@@ -58,6 +58,8 @@ EventService::Impl::Impl(EventService *service) : callerFlow_(service)
 {
 #ifdef TARGET_LPC11Cxx
     registry.reset(new VectorEventHandlers());
+#elif defined(OPENMRN_FEATURE_EVENT_REGISTRY_HASH)
+    registry.reset(new HashEventHandlers());
 #else
     registry.reset(new TreeEventHandlers());
 #endif
@@ -69,19 +71,34 @@ EventService::Impl::~Impl()
 
 StateFlowBase::Action EventCallerFlow::entry()
 {
-    EventHandlerCall *c = message()->data();
-    if (c->epoch != EventRegistry::instance()->get_epoch())
-    {
-        // Event registry was invalidated since this call was scheduled. Ignore.
-        return call_immediately(STATE(call_done));
-    }
-    n_.reset(this);
-    (c->registry_entry->handler->*(c->fn))(*c->registry_entry, c->rep, &n_);
-    return wait_and_call(STATE(call_done));
+    nextIndex_ = 0;
+    return call_immediately(STATE(call_next));
 }
 
-StateFlowBase::Action EventCallerFlow::call_done()
+StateFlowBase::Action EventCallerFlow::call_next()
 {
+    EventHandlerCall *c = message()->data();
+    while (nextIndex_ < c->count)
+    {
+        if (c->epoch != EventRegistry::instance()->get_epoch())
+        {
+            // Event registry was invalidated since this call was
+            // scheduled. The remaining entries may be dangling; the iterator
+            // flow will restart the iteration.
+            break;
+        }
+        const EventRegistryEntry *e = c->entries[nextIndex_++];
+        n_.reset(this);
+        // It is required to hold on to a child to call abort_if_almost_done.
+        auto *ch = n_.new_child();
+        (e->handler->*(c->fn))(*e, c->rep, &n_);
+        if (!n_.abort_if_almost_done())
+        {
+            // The handler is doing something asynchronous.
+            ch->notify();
+            return wait_and_call(STATE(call_next));
+        }
+    }
     return release_and_exit();
 }
 
@@ -279,12 +296,18 @@ StateFlowBase::Action EventIteratorFlow::iterate_next()
 
 StateFlowBase::Action EventIteratorFlow::dispatch_event(const EventRegistryEntry *entry)
 {
+    unsigned count = 0;
+    batch_[count++] = entry;
+    while (count < MAX_BATCH && (entry = iterator_->next_entry()) != nullptr)
+    {
+        batch_[count++] = entry;
+    }
     Buffer<EventHandlerCall> *b;
     /* This could be made an asynchronous allocation. Then the pool could be
      * made fixed size. */
     eventService_->impl()->callerFlow_.pool()->alloc(&b, nullptr);
     HASSERT(b);
-    b->data()->reset(entry, eventRegistryEpoch_, &eventReport_, fn_);
+    b->data()->reset(batch_, count, eventRegistryEpoch_, &eventReport_, fn_);
     n_.reset(this);
     b->set_done(&n_);
     eventService_->impl()->callerFlow_.send(b, priority());
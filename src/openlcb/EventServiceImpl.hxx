@@ -51,18 +51,23 @@ class GlobalIdentifyFlow;
 class EventHandler;
 
 /// Arguments structure for the EventCallerFlow. Each such buffer sent to @ref
-/// EventCallerFlow means calling one event handler's one specific function
-/// with a given argument.
+/// EventCallerFlow means calling a batch of event handlers' one specific
+/// function with a given argument.
 struct EventHandlerCall
 {
-    const EventRegistryEntry *registry_entry;
+    /// Registry entries to call, in order. Owned by the sender flow, which
+    /// must not touch the array until the buffer is released.
+    const EventRegistryEntry *const *entries;
+    /// Number of elements in entries.
+    unsigned count;
     EventReport *rep;
     EventHandlerFunction fn;
     unsigned epoch;
-    void reset(const EventRegistryEntry *entry, unsigned epoch,
-        EventReport *rep, EventHandlerFunction fn)
+    void reset(const EventRegistryEntry *const *entries, unsigned count,
+        unsigned epoch, EventReport *rep, EventHandlerFunction fn)
     {
-        this->registry_entry = entry;
+        this->entries = entries;
+        this->count = count;
         this->rep = rep;
         this->fn = fn;
         this->epoch = epoch;
@@ -74,6 +79,10 @@ struct EventHandlerCall
 /// handler. In essence this control flow behaves as a global lock for the
 /// event handlers being called. This global lock is necessary, because the
 /// event handlers are using global buffers for holding the outgoing packets.
+///
+/// Each incoming buffer carries a batch of handlers. Handlers that complete
+/// synchronously are called back-to-back; the flow only yields to the
+/// executor when a handler keeps the done notifiable for later.
 class EventCallerFlow : public StateFlow<Buffer<EventHandlerCall>, QList<5>>
 {
 public:
@@ -82,9 +91,11 @@ public:
 
 private:
     virtual Action entry() OVERRIDE;
-    Action call_done();
+    Action call_next();
 
     BarrierNotifiable n_;
+    /// Index of the next entry to call in the current batch.
+    unsigned nextIndex_;
 };
 
 /// PImpl class for the EventService. This class creates and owns all
@@ -139,6 +150,13 @@ private:
     virtual Action dispatch_event(const EventRegistryEntry *entry);
 
 protected:
+    /// How many event handlers we send to the caller flow in one buffer.
+#ifdef TARGET_LPC11Cxx
+    static constexpr unsigned MAX_BATCH = 4;
+#else
+    static constexpr unsigned MAX_BATCH = 16;
+#endif
+
     EventService *eventService_;
 
     /// Statically allocated structure for calling the event handlers from the
@@ -158,6 +176,9 @@ protected:
     BarrierNotifiable n_;
     EventHandlerFunction fn_;
 
+    /// Handlers collected for the current call to the caller flow.
+    const EventRegistryEntry *batch_[MAX_BATCH];
+
 #ifdef DEBUG_EVENT_PERFORMANCE
     static const int REPORT_COUNT = 100;
     /// How many events' cost are accumulated so far.
@@ -51,6 +51,15 @@ struct FirmwareUpgradeDefs
     enum
     {
         SPACE_FIRMWARE = 0xEF,
+        /// OpenMRN extension: read-only space reporting a checksum of a flash
+        /// page of the firmware space. A read at a firmware offset returns
+        /// the page containing that offset; the reply address is the page
+        /// start and the data is PAGE_CHECKSUM_LENGTH bytes: the page length
+        /// (32-bit) and the crc3_crc16_ibm of the page contents (3 x 16-bit),
+        /// all big-endian.
+        SPACE_FIRMWARE_PAGE_CHECKSUM = 0xEE,
+        /// Number of data bytes in a page checksum read reply.
+        PAGE_CHECKSUM_LENGTH = 10,
     };
 };
 
@@ -0,0 +1,543 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file FlatAliasCache.cxx
+ * Alias cache implementation optimized for fast lookups in large caches.
+ *
+ * @author Balazs Racz
+ * @date 17 Oct 2026
+ */
+
+#include "openlcb/FlatAliasCache.hxx"
+
+#include "utils/logging.h"
+
+namespace openlcb
+{
+
+/// Constant for random number generation. Same as in AliasCache, so that
+/// both implementations generate the same alias sequence.
+static constexpr uint64_t ALIAS_SEED_CONSTANT = 0x1B0CA37ABA9;
+
+/// Number of entries in the direct alias table.
+static constexpr unsigned ALIAS_TABLE_SIZE = 0x1000;
+
+/// This code removes the unique bits in the stored node alias in case this is
+/// a NOT_RESPONDING entry.
+/// @param stored alias in the metadata storage
+/// @return the alias if it's valid or NOT_RESPONDING ifthis is a sentinel
+static NodeAlias resolve_notresponding(NodeAlias stored)
+{
+    if ((stored & NOT_RESPONDING) == NOT_RESPONDING)
+    {
+        return NOT_RESPONDING;
+    }
+    return stored;
+}
+
+FlatAliasCache::FlatAliasCache(NodeID seed, size_t entries,
+    void (*remove_callback)(NodeID id, NodeAlias alias, void *), void *context)
+    : idLow_(new uint32_t[entries])
+    , idHigh_(new uint16_t[entries])
+    , aliases_(new NodeAlias[entries])
+    , newer_(new uint16_t[entries])
+    , older_(new uint16_t[entries])
+    , aliasTable_(entries >= DIRECT_TABLE_MIN_ENTRIES
+              ? new uint16_t[ALIAS_TABLE_SIZE]
+              : nullptr)
+    , idIndex_(nullptr)
+    , idIndexBits_(2)
+    , seed_(seed)
+    , entries_(entries)
+    , removeCallback_(remove_callback)
+    , context_(context)
+{
+    HASSERT(entries < NONE_ENTRY);
+    while ((1u << idIndexBits_) < entries * 2)
+    {
+        ++idIndexBits_;
+    }
+    idIndex_ = new uint16_t[1u << idIndexBits_];
+    clear();
+}
+
+FlatAliasCache::~FlatAliasCache()
+{
+    delete[] idLow_;
+    delete[] idHigh_;
+    delete[] aliases_;
+    delete[] newer_;
+    delete[] older_;
+    delete[] aliasTable_;
+    delete[] idIndex_;
+}
+
+void FlatAliasCache::clear()
+{
+    oldest_ = NONE_ENTRY;
+    newest_ = NONE_ENTRY;
+    freeList_ = NONE_ENTRY;
+    for (size_t i = entries_; i > 0; --i)
+    {
+        unsigned idx = i - 1;
+        idLow_[idx] = 0;
+        idHigh_[idx] = 0;
+        aliases_[idx] = 0;
+        newer_[idx] = NONE_ENTRY;
+        older_[idx] = freeList_;
+        freeList_ = idx;
+    }
+    if (aliasTable_)
+    {
+        for (unsigned i = 0; i < ALIAS_TABLE_SIZE; ++i)
+        {
+            aliasTable_[i] = NONE_ENTRY;
+        }
+    }
+    for (unsigned i = 0; i < (1u << idIndexBits_); ++i)
+    {
+        idIndex_[i] = NONE_ENTRY;
+    }
+}
+
+unsigned FlatAliasCache::find_alias(NodeAlias alias)
+{
+    if (aliasTable_ && alias < ALIAS_TABLE_SIZE)
+    {
+        return aliasTable_[alias];
+    }
+    // The inner loop has no early exit, so that the compiler can vectorize
+    // the comparisons.
+    static constexpr unsigned BLOCK = 8;
+    unsigned i = 0;
+    for (; i + BLOCK <= entries_; i += BLOCK)
+    {
+        unsigned match = 0;
+        for (unsigned j = 0; j < BLOCK; ++j)
+        {
+            match |= (aliases_[i + j] == alias ? 1u : 0u) << j;
+        }
+        if (match)
+        {
+            return i + __builtin_ctz(match);
+        }
+    }
+    for (; i < entries_; ++i)
+    {
+        if (aliases_[i] == alias)
+        {
+            return i;
+        }
+    }
+    return NONE_ENTRY;
+}
+
+unsigned FlatAliasCache::find_id(NodeID id)
+{
+    unsigned mask = (1u << idIndexBits_) - 1;
+    uint32_t low = id & 0xFFFFFFFFu;
+    uint16_t high = (id >> 32) & 0xFFFFu;
+    for (unsigned h = id_hash(id); idIndex_[h] != NONE_ENTRY;
+         h = (h + 1) & mask)
+    {
+        unsigned idx = idIndex_[h];
+        if (idLow_[idx] == low && idHigh_[idx] == high)
+        {
+            return idx;
+        }
+    }
+    return NONE_ENTRY;
+}
+
+void FlatAliasCache::id_index_insert(unsigned idx)
+{
+    unsigned mask = (1u << idIndexBits_) - 1;
+    unsigned h = id_hash(get_node_id(idx));
+    while (idIndex_[h] != NONE_ENTRY)
+    {
+        h = (h + 1) & mask;
+    }
+    idIndex_[h] = idx;
+}
+
+void FlatAliasCache::id_index_erase(unsigned idx)
+{
+    unsigned mask = (1u << idIndexBits_) - 1;
+    unsigned hole = id_hash(get_node_id(idx));
+    while (idIndex_[hole] != idx)
+    {
+        HASSERT(idIndex_[hole] != NONE_ENTRY);
+        hole = (hole + 1) & mask;
+    }
+    // Backward shift deletion: moves every later element of the probe
+    // sequence whose home bucket is not between the hole and its current
+    // position into the hole.
+    unsigned j = hole;
+    while (true)
+    {
+        j = (j + 1) & mask;
+        if (idIndex_[j] == NONE_ENTRY)
+        {
+            break;
+        }
+        unsigned home = id_hash(get_node_id(idIndex_[j]));
+        // Distance from home to j and from hole to j, modulo the table size.
+        if (((j - home) & mask) >= ((j - hole) & mask))
+        {
+            idIndex_[hole] = idIndex_[j];
+            hole = j;
+        }
+    }
+    idIndex_[hole] = NONE_ENTRY;
+}
+
+void FlatAliasCache::unlink(unsigned idx)
+{
+    if (newer_[idx] != NONE_ENTRY)
+    {
+        older_[newer_[idx]] = older_[idx];
+    }
+    else
+    {
+        newest_ = older_[idx];
+    }
+    if (older_[idx] != NONE_ENTRY)
+    {
+        newer_[older_[idx]] = newer_[idx];
+    }
+    else
+    {
+        oldest_ = newer_[idx];
+    }
+}
+
+void FlatAliasCache::link_newest(unsigned idx)
+{
+    newer_[idx] = NONE_ENTRY;
+    older_[idx] = newest_;
+    if (newest_ != NONE_ENTRY)
+    {
+        newer_[newest_] = idx;
+    }
+    else
+    {
+        oldest_ = idx;
+    }
+    newest_ = idx;
+}
+
+void FlatAliasCache::erase(unsigned idx)
+{
+    id_index_erase(idx);
+    if (aliasTable_ && aliases_[idx] < ALIAS_TABLE_SIZE)
+    {
+        aliasTable_[aliases_[idx]] = NONE_ENTRY;
+    }
+    unlink(idx);
+    idLow_[idx] = 0;
+    idHigh_[idx] = 0;
+    aliases_[idx] = 0;
+    newer_[idx] = NONE_ENTRY;
+    older_[idx] = freeList_;
+    freeList_ = idx;
+}
+
+void FlatAliasCache::touch(unsigned idx)
+{
+    if (idx != newest_)
+    {
+        unlink(idx);
+        link_newest(idx);
+    }
+}
+
+void FlatAliasCache::add(NodeID id, NodeAlias alias)
+{
+    HASSERT(id != 0);
+    HASSERT(alias != 0);
+
+    // We can have more than one NOT_RESPONDING entry.
+    unsigned idx =
+        alias == NOT_RESPONDING ? (unsigned)NONE_ENTRY : find_alias(alias);
+    if (idx != NONE_ENTRY)
+    {
+        /* we already have a mapping for this alias, so lets remove it */
+        NodeID old_id = get_node_id(idx);
+        NodeAlias old_alias = aliases_[idx];
+        erase(idx);
+        if (removeCallback_)
+        {
+            /* tell the interface layer that we removed this mapping */
+            (*removeCallback_)(old_id, old_alias, context_);
+        }
+    }
+    idx = find_id(id);
+    if (idx != NONE_ENTRY)
+    {
+        /* we already have a mapping for this id, so lets remove it */
+        NodeAlias old_alias = aliases_[idx];
+        erase(idx);
+        if (removeCallback_)
+        {
+            /* tell the interface layer that we removed this mapping */
+            (*removeCallback_)(id, old_alias, context_);
+        }
+    }
+
+    if (freeList_ == NONE_ENTRY)
+    {
+        HASSERT(oldest_ != NONE_ENTRY);
+        /* kick out the oldest mapping */
+        idx = oldest_;
+        NodeID old_id = get_node_id(idx);
+        NodeAlias old_alias = aliases_[idx];
+        erase(idx);
+        if (removeCallback_)
+        {
+            /* tell the interface layer that we removed this mapping */
+            (*removeCallback_)(old_id, old_alias, context_);
+        }
+    }
+    idx = freeList_;
+    freeList_ = older_[idx];
+
+    if (alias == NOT_RESPONDING)
+    {
+        // This code will make all NOT_RESPONDING aliases unique in our map.
+        alias = NOT_RESPONDING | idx;
+    }
+    idLow_[idx] = id & 0xFFFFFFFFu;
+    idHigh_[idx] = (id >> 32) & 0xFFFFu;
+    aliases_[idx] = alias;
+    if (aliasTable_ && alias < ALIAS_TABLE_SIZE)
+    {
+        aliasTable_[alias] = idx;
+    }
+    id_index_insert(idx);
+    link_newest(idx);
+}
+
+void FlatAliasCache::remove(NodeAlias alias)
+{
+    if (alias == 0)
+    {
+        return;
+    }
+    unsigned idx = find_alias(alias);
+    if (idx != NONE_ENTRY)
+    {
+        erase(idx);
+    }
+}
+
+bool FlatAliasCache::retrieve(unsigned entry, NodeID *node, NodeAlias *alias)
+{
+    HASSERT(entry < size());
+    if (!aliases_[entry])
+    {
+        return false;
+    }
+    if (node)
+    {
+        *node = get_node_id(entry);
+    }
+    if (alias)
+    {
+        *alias = resolve_notresponding(aliases_[entry]);
+    }
+    return true;
+}
+
+bool FlatAliasCache::next_entry(NodeID bound, NodeID *node, NodeAlias *alias)
+{
+    unsigned found = NONE_ENTRY;
+    NodeID found_id = 0;
+    for (unsigned i = 0; i < entries_; ++i)
+    {
+        if (!aliases_[i])
+        {
+            continue;
+        }
+        NodeID id = get_node_id(i);
+        if (id > bound && (found == NONE_ENTRY || id < found_id))
+        {
+            found = i;
+            found_id = id;
+        }
+    }
+    if (found == NONE_ENTRY)
+    {
+        return false;
+    }
+    if (node)
+    {
+        *node = found_id;
+    }
+    if (alias)
+    {
+        *alias = resolve_notresponding(aliases_[found]);
+    }
+    return true;
+}
+
+NodeAlias FlatAliasCache::lookup(NodeID id)
+{
+    HASSERT(id != 0);
+    unsigned idx = find_id(id);
+    if (idx == NONE_ENTRY)
+    {
+        return 0;
+    }
+    touch(idx);
+    return resolve_notresponding(aliases_[idx]);
+}
+
+NodeID FlatAliasCache::lookup(NodeAlias alias)
+{
+    if (alias == 0)
+    {
+        return 0;
+    }
+    unsigned idx = find_alias(alias);
+    if (idx == NONE_ENTRY)
+    {
+        return 0;
+    }
+    touch(idx);
+    return get_node_id(idx);
+}
+
+void FlatAliasCache::for_each(
+    void (*callback)(void *, NodeID, NodeAlias), void *context)
+{
+    HASSERT(callback != NULL);
+
+    for (unsigned idx = newest_; idx != NONE_ENTRY; idx = older_[idx])
+    {
+        (*callback)(
+            context, get_node_id(idx), resolve_notresponding(aliases_[idx]));
+    }
+}
+
+NodeAlias FlatAliasCache::generate()
+{
+    NodeAlias alias;
+
+    do
+    {
+        /* calculate the alias given the current seed */
+        alias = (seed_ ^ (seed_ >> 12) ^ (seed_ >> 24) ^ (seed_ >> 36)) & 0xfff;
+
+        /* calculate the next seed */
+        seed_ = ((((1 << 9) + 1) * (seed_) + ALIAS_SEED_CONSTANT)) &
+            0xffffffffffff;
+    } while (alias == 0 || lookup(alias) != 0);
+
+    /* new random alias */
+    return alias;
+}
+
+int FlatAliasCache::check_consistency()
+{
+    unsigned num_free = 0;
+    for (unsigned idx = freeList_; idx != NONE_ENTRY; idx = older_[idx])
+    {
+        if (aliases_[idx] != 0)
+        {
+            LOG(INFO, "Used entry on the freelist.");
+            return 1;
+        }
+        if (++num_free > entries_)
+        {
+            LOG(INFO, "Loop in the freelist.");
+            return 2;
+        }
+    }
+    unsigned num_used = 0;
+    unsigned prev = NONE_ENTRY;
+    for (unsigned idx = oldest_; idx != NONE_ENTRY; idx = newer_[idx])
+    {
+        if (aliases_[idx] == 0)
+        {
+            LOG(INFO, "Free entry on the LRU list.");
+            return 3;
+        }
+        if (older_[idx] != prev)
+        {
+            LOG(INFO, "LRU list link broken.");
+            return 4;
+        }
+        if (++num_used > entries_)
+        {
+            LOG(INFO, "Loop in the LRU list.");
+            return 5;
+        }
+        prev = idx;
+    }
+    if (prev != newest_)
+    {
+        LOG(INFO, "LRU list does not end in newest.");
+        return 6;
+    }
+    if (num_used + num_free != entries_)
+    {
+        LOG(INFO, "Lost some entries.");
+        return 7;
+    }
+    unsigned num_indexed = 0;
+    for (unsigned h = 0; h < (1u << idIndexBits_); ++h)
+    {
+        if (idIndex_[h] != NONE_ENTRY)
+        {
+            ++num_indexed;
+        }
+    }
+    if (num_indexed != num_used)
+    {
+        LOG(INFO, "ID index size is incorrect.");
+        return 8;
+    }
+    for (unsigned i = 0; i < entries_; ++i)
+    {
+        if (!aliases_[i])
+        {
+            continue;
+        }
+        if (find_id(get_node_id(i)) != i)
+        {
+            LOG(INFO, "ID index does not point to the entry.");
+            return 9;
+        }
+        if (find_alias(aliases_[i]) != i)
+        {
+            LOG(INFO, "Alias index does not point to the entry.");
+            return 10;
+        }
+    }
+    return 0;
+}
+
+} // namespace openlcb
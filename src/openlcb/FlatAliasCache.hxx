@@ -0,0 +1,252 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file FlatAliasCache.hxx
+ * Alias cache implementation optimized for fast lookups in large caches.
+ *
+ * @author Balazs Racz
+ * @date 17 Oct 2026
+ */
+
+#ifndef _OPENLCB_FLATALIASCACHE_HXX_
+#define _OPENLCB_FLATALIASCACHE_HXX_
+
+#include "openlcb/Defs.hxx"
+#include "utils/macros.h"
+
+namespace openlcb
+{
+
+/** Cache of alias to node id mappings, with the same API and semantics as
+ * @ref AliasCache, but laid out for fast lookups in caches with hundreds or
+ * thousands of entries (such as the remote alias cache of a gateway).
+ *
+ * Theory of operation:
+ *
+ * Every entry has an index between 0 and size() - 1. The node IDs, aliases
+ * and LRU links are stored in parallel arrays (struct-of-arrays) indexed by
+ * the entry index. Free entries have alias 0, and are linked in a freelist
+ * via the older_ array.
+ *
+ * Lookup by alias uses a direct table of 4096 entries (aliases are 12 bits)
+ * which stores the entry index for each alias. This table costs 8 kbytes,
+ * therefore it is only allocated for caches of at least
+ * DIRECT_TABLE_MIN_ENTRIES entries. Smaller caches scan the alias array.
+ *
+ * Lookup by node ID uses an open addressing hash table of entry indexes with
+ * linear probing, sized to twice the number of entries.
+ *
+ * Iteration by increasing node ID (next_entry) is a linear scan.
+ *
+ * Note, there is no mutual exclusion locking mechanism built into this
+ * class. Mutual exclusion must be handled by the user as needed.
+ */
+class FlatAliasCache
+{
+public:
+    /** Constructor.
+     * @param seed starting seed for generation of aliases
+     * @param entries maximum number of entries in this cache
+     * @param remove_callback callback to call when we remove a mapping from
+     *        the cache however it will not be called in the remove() method
+     * @param context context pointer to pass to remove_callback
+     */
+    FlatAliasCache(NodeID seed, size_t entries,
+        void (*remove_callback)(NodeID id, NodeAlias alias, void *) = NULL,
+        void *context = NULL);
+
+    ~FlatAliasCache();
+
+    /// Sentinel entry for empty lists.
+    static constexpr uint16_t NONE_ENTRY = 0xFFFFu;
+
+    /// Caches with at least this many entries get a direct alias table.
+    static constexpr size_t DIRECT_TABLE_MIN_ENTRIES = 32;
+
+    /** Reinitializes the entire map. */
+    void clear();
+
+    /** Add an alias to an alias cache.
+     * @param id 48-bit NMRAnet Node ID to associate alias with
+     * @param alias 12-bit alias associated with Node ID
+     */
+    void add(NodeID id, NodeAlias alias);
+
+    /** Remove an alias from an alias cache.  This method does not call the
+     * remove_callback method passed in at construction since it is a
+     * deliberate call not requiring notification.
+     * @param alias 12-bit alias associated with Node ID
+     */
+    void remove(NodeAlias alias);
+
+    /** Lookup a node's alias based on its Node ID.
+     * @param id Node ID to look for
+     * @return alias that matches the Node ID, else 0 if not found
+     */
+    NodeAlias lookup(NodeID id);
+
+    /** Lookup a node's ID based on its alias.
+     * @param alias alias to look for
+     * @return Node ID that matches the alias, else 0 if not found
+     */
+    NodeID lookup(NodeAlias alias);
+
+    /** Call the given callback function once for each alias tracked.  The
+     * order will be in last "touched" order.
+     * @param callback method to call
+     * @param context context pointer to pass to callback
+     */
+    void for_each(void (*callback)(void *, NodeID, NodeAlias), void *context);
+
+    /** Returns the total number of aliases that can be cached. */
+    size_t size()
+    {
+        return entries_;
+    }
+
+    /** Retrieves an entry by index. Allows stable iteration in the face of
+     * changes.
+     * @param entry is between 0 and size() - 1.
+     * @param node will be filled with the node ID. May be null.
+     * @param alias will be filled with the alias. May be null.
+     * @return true if the entry is valid, and node and alias were filled,
+     * otherwise false if the entry is not allocated.
+     */
+    bool retrieve(unsigned entry, NodeID *node, NodeAlias *alias);
+
+    /** Retrieves the next entry by increasing node ID.
+     * @param bound is a Node ID. Will search for the next largest node ID
+     * (upper bound of this key).
+     * @param node will be filled with the node ID. May be null.
+     * @param alias will be filled with the alias. May be null.
+     * @return true if a larger element is found and node and alias were
+     * filled, otherwise false if bound is >= the largest node ID in the cache.
+     */
+    bool next_entry(NodeID bound, NodeID *node, NodeAlias *alias);
+
+    /** Generate a 12-bit pseudo-random alias for a given alias cache.
+     * @return pseudo-random 12-bit alias, an alias of zero is invalid
+     */
+    NodeAlias generate();
+
+    /** Visible for testing. Check internal consistency. */
+    int check_consistency();
+
+private:
+    /// @return the node ID stored in an entry.
+    /// @param idx entry index.
+    NodeID get_node_id(unsigned idx)
+    {
+        uint64_t h = idHigh_[idx];
+        h <<= 32;
+        h |= idLow_[idx];
+        return h;
+    }
+
+    /// @return the bucket in the ID hash table where the search for a given
+    /// node ID starts.
+    /// @param id node ID.
+    unsigned id_hash(NodeID id)
+    {
+        return (id * 0x9E3779B97F4A7C15ULL) >> (64 - idIndexBits_);
+    }
+
+    /// @return entry index for an alias, or NONE_ENTRY if not found.
+    /// @param alias alias to look for (non-zero).
+    unsigned find_alias(NodeAlias alias);
+
+    /// @return entry index for a node ID, or NONE_ENTRY if not found.
+    /// @param id node ID to look for.
+    unsigned find_id(NodeID id);
+
+    /// Adds an entry to the ID hash table.
+    /// @param idx entry index, with the node ID already filled in.
+    void id_index_insert(unsigned idx);
+
+    /// Removes an entry from the ID hash table.
+    /// @param idx entry index, with the node ID still filled in.
+    void id_index_erase(unsigned idx);
+
+    /// Removes an entry from the LRU list.
+    /// @param idx entry index.
+    void unlink(unsigned idx);
+
+    /// Adds an entry to the newest end of the LRU list.
+    /// @param idx entry index.
+    void link_newest(unsigned idx);
+
+    /// Removes an entry from all indexes and puts it onto the freelist.
+    /// @param idx entry index.
+    void erase(unsigned idx);
+
+    /// Moves an entry to the newest end of the LRU list.
+    /// @param idx entry index.
+    void touch(unsigned idx);
+
+    /// Low 32 bits of the node ID for each entry.
+    uint32_t *idLow_;
+    /// High 16 bits of the node ID for each entry.
+    uint16_t *idHigh_;
+    /// Alias for each entry. 0 for free entries. NOT_RESPONDING entries
+    /// store NOT_RESPONDING | index to make them unique.
+    NodeAlias *aliases_;
+    /// Index of next-newer entry according to the LRU linked list.
+    uint16_t *newer_;
+    /// Index of next-older entry according to the LRU linked list, or the
+    /// next free entry for entries on the freelist.
+    uint16_t *older_;
+    /// Entry index for each 12-bit alias, or nullptr for small caches.
+    uint16_t *aliasTable_;
+    /// Open addressing hash table of entry indexes, keyed by node ID.
+    uint16_t *idIndex_;
+    /// The ID hash table has 2^idIndexBits_ buckets.
+    unsigned idIndexBits_;
+
+    /// Head of the list of unused entries.
+    uint16_t freeList_;
+    /// Oldest untouched entry.
+    uint16_t oldest_;
+    /// Newest, most recently touched entry.
+    uint16_t newest_;
+
+    /// Seed for the generation of the next alias.
+    NodeID seed_;
+
+    /// How many entries the cache has.
+    size_t entries_;
+
+    /// Callback function to be used when we remove an entry from the cache.
+    void (*removeCallback_)(NodeID id, NodeAlias alias, void *);
+
+    /// Context pointer to pass in with remove_callback.
+    void *context_;
+
+    DISALLOW_COPY_AND_ASSIGN(FlatAliasCache);
+};
+
+} // namespace openlcb
+
+#endif // _OPENLCB_FLATALIASCACHE_HXX_
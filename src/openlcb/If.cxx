@@ -36,10 +36,15 @@
 #include "openlcb/Convert.hxx"
 
 /// Ensures that the largest bucket in the main buffer pool at least the size
-/// of a GenMessage, or a DataBuffer<64>.
+/// of a GenMessage, a DataBuffer<64>, or the external buffer of a datagram
+/// Payload.
 static constexpr unsigned BUCKET_SIZE_GENMSG = sizeof(Buffer<openlcb::GenMessage>);
 static constexpr unsigned BUCKET_SIZE_BUFBASE_64 = 64u + sizeof(BufferBase);
-static constexpr unsigned BUCKET_SIZE = BUCKET_SIZE_GENMSG > BUCKET_SIZE_BUFBASE_64 ? BUCKET_SIZE_GENMSG : BUCKET_SIZE_BUFBASE_64;
+/// External buffer of a datagram-sized Payload.
+static constexpr unsigned BUCKET_SIZE_PAYLOAD =
+    openlcb::Payload::MIN_EXTERNAL_SIZE + 1 + sizeof(BufferBase);
+static constexpr unsigned BUCKET_SIZE_1 = BUCKET_SIZE_GENMSG > BUCKET_SIZE_BUFBASE_64 ? BUCKET_SIZE_GENMSG : BUCKET_SIZE_BUFBASE_64;
+static constexpr unsigned BUCKET_SIZE = BUCKET_SIZE_1 > BUCKET_SIZE_PAYLOAD ? BUCKET_SIZE_1 : BUCKET_SIZE_PAYLOAD;
 // This also verifies that LARGEST_BUFFERPOOL_BUCKET will end up being in
 // rodata instead of being computed at static constructor time. We want to make
 // sure that init_main_buffer_pool can work at any moment.
@@ -158,7 +163,7 @@ void send_event(Node* src_node, uint64_t event_id)
 }
 
 
-string EMPTY_PAYLOAD;
+Payload EMPTY_PAYLOAD;
 
 /*Buffer *node_id_to_buffer(NodeID id)
 {
@@ -179,7 +184,6 @@ NodeID buffer_to_node_id(Buffer *buf)
     return be64toh(d);
     }*/
 
-/// @TODO(balazs.racz): make the map size parametrizable.
 If::If(ExecutorBase *executor, int local_nodes_count)
     : Service(executor)
     , globalWriteFlow_(nullptr)
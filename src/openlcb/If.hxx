@@ -43,6 +43,7 @@
 #include "executor/Service.hxx"
 #include "openlcb/Convert.hxx"
 #include "openlcb/Defs.hxx"
+#include "openlcb/LocalNodeTable.hxx"
 #include "openlcb/Node.hxx"
 #include "utils/Buffer.hxx"
 #include "utils/Map.hxx"
@@ -78,7 +79,7 @@ struct GenMessage
         reset((Defs::MTI)0, 0, EMPTY_PAYLOAD);
     }
 
-    void reset(Defs::MTI mti, NodeID src, NodeHandle dst, string payload)
+    void reset(Defs::MTI mti, NodeID src, NodeHandle dst, Payload payload)
     {
         this->mti = mti;
         this->src = {src, 0};
@@ -89,7 +90,7 @@ struct GenMessage
         this->flagsDst = 0;
     }
 
-    void reset(Defs::MTI mti, NodeID src, string payload)
+    void reset(Defs::MTI mti, NodeID src, Payload payload)
     {
         this->mti = mti;
         this->src = {src, 0};
@@ -109,8 +110,7 @@ struct GenMessage
     /// If the destination node is local, this value is non-NULL.
     Node *dstNode;
     /// Data content in the message body. Owned by the dispatcher.
-    /// @todo(balazs.racz) figure out a better container.
-    string payload;
+    Payload payload;
 
     unsigned flagsSrc : 4;
     unsigned flagsDst : 4;
@@ -239,11 +239,10 @@ public:
      *
      * @param node is the node to register.
      */
-    void add_local_node(Node *node)
+    virtual void add_local_node(Node *node)
     {
-        NodeID id = node->node_id();
-        HASSERT(localNodes_.find(id) == localNodes_.end());
-        localNodes_[id] = node;
+        HASSERT(localNodes_.find(node->node_id()) == LocalNodeTable::NONE);
+        localNodes_.insert(node);
     }
 
     /** Removes a local node from this interface. This function must be called
@@ -262,12 +261,12 @@ public:
      */
     Node *lookup_local_node(NodeID id)
     {
-        auto it = localNodes_.find(id);
-        if (it == localNodes_.end())
+        unsigned idx = localNodes_.find(id);
+        if (idx == LocalNodeTable::NONE)
         {
             return nullptr;
         }
-        return it->second;
+        return localNodes_.node(idx);
     }
 
     /** Looks up a node ID in the local nodes' registry. This function must be
@@ -281,38 +280,38 @@ public:
         return lookup_local_node(handle.id);
     }
 
+    /// @return the number of local nodes registered on this interface.
+    unsigned local_node_count()
+    {
+        return localNodes_.size();
+    }
+
     /**
-     * @returns the first node (by nodeID order) that is registered in this
-     * interface as a local node, or nullptr if this interface has no local
-     * nodes.
+     * @returns the first node (by registration order) that is registered in
+     * this interface as a local node, or nullptr if this interface has no
+     * local nodes.
      */
     Node* first_local_node() {
-        auto it = localNodes_.begin();
-        if (it == localNodes_.end()) return nullptr;
-        return it->second;
+        if (!localNodes_.size()) return nullptr;
+        return localNodes_.node(0);
     }
 
     /**
-     * Iterator helper on the local nodes map.
+     * Iterator helper on the local nodes table.
      *
      * @param previous is the node ID of a valid local node.
      *
-     * @returns the node pointer of the next local node (in node ID order) or
-     * null if this was the last node or an invalid argument (not the node ID
-     * of a local node).
+     * @returns the node pointer of the next local node (in registration
+     * order, which changes when a node is removed) or null if this was the
+     * last node or an invalid argument (not the node ID of a local node).
      */
     Node* next_local_node(NodeID previous) {
-        auto it = localNodes_.find(previous);
-        if (it == localNodes_.end())
-        {
-            return nullptr;
-        }
-        ++it;
-        if (it == localNodes_.end())
+        unsigned idx = localNodes_.find(previous);
+        if (idx == LocalNodeTable::NONE || idx + 1 >= localNodes_.size())
         {
             return nullptr;
         }
-        return it->second;
+        return localNodes_.node(idx + 1);
     }
 
     /** @returns true if the two node handles match as far as we can tell
@@ -360,9 +359,16 @@ public:
 protected:
     void remove_local_node_from_map(Node *node)
     {
-        auto it = localNodes_.find(node->node_id());
-        HASSERT(it != localNodes_.end());
-        localNodes_.erase(it);
+        if (!localNodes_.erase(node->node_id()))
+        {
+            DIE("Removing a node that is not registered.");
+        }
+    }
+
+    /// @return the table of the local nodes.
+    LocalNodeTable *local_node_table()
+    {
+        return &localNodes_;
     }
 
     /// Allocator containing the global write flows.
@@ -377,10 +383,8 @@ private:
     /// This function is pinged every time a message is transmitted.
     std::function<void()> txHook_;
 
-    typedef Map<NodeID, Node *> VNodeMap;
-
     /// Local virtual nodes registered on this interface.
-    VNodeMap localNodes_;
+    LocalNodeTable localNodes_;
 
     /// Accessor for the objects and variables for supporting stream transport.
     StreamTransport *streamTransport_ {nullptr};
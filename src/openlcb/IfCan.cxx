@@ -341,9 +341,22 @@ public:
         {
             return release_and_exit();
         }
+        if (!node_id)
+        {
+            return release_and_exit();
+        }
         NodeAlias local_alias = if_can()->local_aliases()->lookup(node_id);
-        if (!node_id || !local_alias)
+        if (!local_alias)
         {
+            if (if_can()->lookup_local_node(node_id) &&
+                if_can()->alias_allocator())
+            {
+                // A local node that released its alias while it was idle.
+                // Someone wants to talk to it, so it needs a new alias.
+                nodeId_ = node_id;
+                release();
+                return call_immediately(STATE(allocate_alias));
+            }
             return release_and_exit();
         }
         auto* b = reinterpret_cast<Buffer<CanHubData>*>(transfer_message());
@@ -352,6 +365,50 @@ public:
         if_can()->frame_write_flow()->send(b);
         return exit();
     }
+
+private:
+    /// Takes a reserved alias for nodeId_.
+    Action allocate_alias()
+    {
+        if (!if_can()->lookup_local_node(nodeId_))
+        {
+            // Node was deleted in the meantime.
+            return exit();
+        }
+        // A write flow might be allocating an alias for the same node. Both
+        // of us check for an existing alias before taking a new one, and run
+        // on the interface executor, so the node gets only one alias.
+        alias_ = if_can()->local_aliases()->lookup(nodeId_);
+        if (!alias_)
+        {
+            alias_ = if_can()->alias_allocator()->get_allocated_alias(
+                nodeId_, this);
+            if (!alias_)
+            {
+                // wait for notification and re-try this step.
+                return wait();
+            }
+        }
+        return allocate_and_call(
+            if_can()->frame_write_flow(), STATE(send_amd_frame));
+    }
+
+    /// Announces the new alias of nodeId_.
+    Action send_amd_frame()
+    {
+        auto *b = get_allocation_result(if_can()->frame_write_flow());
+        struct can_frame *f = b->data()->mutable_frame();
+        CanDefs::control_init(*f, alias_, CanDefs::AMD_FRAME, 0);
+        f->can_dlc = 6;
+        node_id_to_data(nodeId_, f->data);
+        if_can()->frame_write_flow()->send(b);
+        return exit();
+    }
+
+    /// Local node that needs a new alias.
+    NodeID nodeId_;
+    /// New alias for nodeId_.
+    NodeAlias alias_;
 };
 
 /** This class listens for Alias Mapping Enquiry frames with no destination
@@ -608,7 +665,7 @@ public:
         }
         // Gets the destination address and checks if it is our node.
         dstHandle_.alias = (((unsigned)f->data[0] & 0xf) << 8) | f->data[1];
-        dstHandle_.id = if_can()->local_aliases()->lookup(dstHandle_.alias);
+        dstHandle_.id = if_can()->lookup_local_alias(dstHandle_.alias);
         if (!dstHandle_.id) // Not destined for us.
         {
             LOG(VERBOSE, "Dropping addressed message not for local destination."
@@ -713,6 +770,7 @@ IfCan::IfCan(ExecutorBase *executor, CanHubFlow *device,
     , localAliases_(0, local_alias_cache_size)
     , remoteAliases_(0, remote_alias_cache_size)
 {
+    localAliases_.set_update_callback(&IfCan::local_alias_updated, this);
     auto *gflow = new GlobalCanMessageWriteFlow(this);
     globalWriteFlow_ = gflow;
     add_owned_flow(gflow);
@@ -790,8 +848,25 @@ void IfCan::add_addressed_message_support()
     add_owned_flow(f);
 }
 
+void IfCan::add_local_node(Node *node)
+{
+    If::add_local_node(node);
+    // The alias might have been assigned before the node was registered.
+    // Adding it again reports it to local_alias_updated().
+    NodeAlias alias = localAliases_.lookup(node->node_id());
+    if (alias)
+    {
+        localAliases_.add(node->node_id(), alias);
+    }
+}
+
 void IfCan::delete_local_node(Node *node) {
     remove_local_node_from_map(node);
+    release_local_alias(node);
+}
+
+void IfCan::release_local_alias(Node *node)
+{
     auto alias = localAliases_.lookup(node->node_id());
     if (alias) {
         // The node had a local alias.
@@ -802,6 +877,92 @@ void IfCan::delete_local_node(Node *node) {
     }
 }
 
+unsigned IfCan::release_idle_local_aliases()
+{
+    LocalNodeTable *t = local_node_table();
+    NodeID default_id = get_default_node_id();
+    unsigned count = 0;
+    for (unsigned i = 0; i < t->size(); ++i)
+    {
+        if (t->alias(i) && t->is_idle(i) && t->id(i) != default_id)
+        {
+            release_local_alias(t->node(i));
+            ++count;
+        }
+    }
+    t->next_generation();
+    return count;
+}
+
+NodeID IfCan::lookup_local_alias(NodeAlias alias, Node **node)
+{
+    // The node table is updated together with the local alias cache.
+    executor()->assert_current();
+    LocalNodeTable *t = local_node_table();
+    unsigned idx = t->find_alias(alias);
+    if (idx != LocalNodeTable::NONE)
+    {
+        touch_local_node(t, idx);
+        if (node)
+        {
+            *node = t->node(idx);
+        }
+        return t->id(idx);
+    }
+    if (node)
+    {
+        *node = nullptr;
+    }
+    return local_aliases()->lookup(alias);
+}
+
+NodeAlias IfCan::lookup_local_alias_by_id(NodeID id)
+{
+    // The node table is updated together with the local alias cache.
+    executor()->assert_current();
+    LocalNodeTable *t = local_node_table();
+    unsigned idx = t->find(id);
+    if (idx != LocalNodeTable::NONE)
+    {
+        touch_local_node(t, idx);
+        return t->alias(idx);
+    }
+    // Proxied node.
+    return local_aliases()->lookup(id);
+}
+
+void IfCan::touch_local_node(LocalNodeTable *t, unsigned idx)
+{
+    t->touch(idx);
+    // Keeps the alias of a busy node from being evicted from the local alias
+    // cache, as the cache lookup would have done.
+    unsigned entry = t->cache_entry(idx);
+    if (entry != LocalNodeTable::NO_CACHE_ENTRY)
+    {
+        localAliases_.touch_entry(entry);
+    }
+}
+
+void IfCan::local_alias_updated(
+    void *context, NodeID id, NodeAlias alias, unsigned entry, bool added)
+{
+    LocalNodeTable *t = static_cast<IfCan *>(context)->local_node_table();
+    unsigned idx = t->find(id);
+    if (idx == LocalNodeTable::NONE)
+    {
+        // Not a registered node.
+        return;
+    }
+    if (added)
+    {
+        t->set_alias(idx, alias, entry);
+    }
+    else if (t->alias(idx) == alias)
+    {
+        t->set_alias(idx, 0);
+    }
+}
+
 
 void IfCan::canonicalize_handle(NodeHandle *h)
 {
@@ -847,7 +1008,9 @@ Node *IfCan::lookup_local_node_handle(NodeHandle h)
 {
     if (!h.id)
     {
-        h.id = local_aliases()->lookup(h.alias);
+        Node *n;
+        lookup_local_alias(h.alias, &n);
+        return n;
     }
     return lookup_local_node(h.id);
 }
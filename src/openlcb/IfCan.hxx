@@ -40,6 +40,7 @@
 #include "executor/StateFlow.hxx"
 #include "openlcb/If.hxx"
 #include "openlcb/AliasCache.hxx"
+#include "openlcb/FlatAliasCache.hxx"
 #include "openlcb/Defs.hxx"
 #include "utils/CanIf.hxx"
 
@@ -99,8 +100,47 @@ public:
         return &localAliases_;
     }
 
+#ifdef OPENMRN_FEATURE_ALIAS_CACHE_FLAT
+    /// Alias cache implementation used for the remote nodes.
+    typedef FlatAliasCache RemoteAliasCache;
+#else
+    /// Alias cache implementation used for the remote nodes.
+    typedef AliasCache RemoteAliasCache;
+#endif
+
+    /// Looks up the node ID that owns a local alias. This is the fast path
+    /// for the frame parsers: aliases of registered local nodes are found in
+    /// O(1) in the local node table, everything else (reserved aliases,
+    /// proxied nodes) in the local alias cache. Marks the node as active.
+    /// @param alias the alias to look up.
+    /// @param node if not null, will be set to the registered local node that
+    /// owns the alias, or nullptr.
+    /// @return the node ID, or 0 if the alias is not local.
+    NodeID lookup_local_alias(NodeAlias alias, Node **node = nullptr);
+
+    /// Looks up the local alias of a node ID. Fast path for the write flows;
+    /// see lookup_local_alias(). Marks the node as active.
+    /// @param id node ID of a local node (virtual or proxied).
+    /// @return the alias, or 0 if the node does not have one.
+    NodeAlias lookup_local_alias_by_id(NodeID id);
+
+    /// Releases the alias of a local node by sending an Alias Map Reset
+    /// frame. The node stays registered. It will get a new alias when it next
+    /// sends a message, or when someone asks for it with an Alias Map Enquiry
+    /// frame. Must be called on the interface executor.
+    /// @param node a registered local node.
+    void release_local_alias(Node *node);
+
+    /// Releases the alias of every local node that was not active since the
+    /// previous call (except the default node). Command stations with many
+    /// virtual train nodes should call this periodically, so that the nodes
+    /// that are not in use do not hold on to aliases. Must be called on the
+    /// interface executor.
+    /// @return the number of aliases released.
+    unsigned release_idle_local_aliases();
+
     /// @returns the alias cache for remote nodes on this IF
-    AliasCache *remote_aliases()
+    RemoteAliasCache *remote_aliases()
     {
         executor()->assert_current();
         return &remoteAliases_;
@@ -128,6 +168,8 @@ public:
 
     bool matching_node(NodeHandle expected, NodeHandle actual) override;
 
+    void add_local_node(Node *node) override;
+
     void delete_local_node(Node *node) override;
 
     Node *lookup_local_node_handle(NodeHandle handle) override;
@@ -137,6 +179,17 @@ public:
 private:
     void canonicalize_handle(NodeHandle *h) override;
 
+    /// Callback from the local alias cache. Keeps the aliases in the local
+    /// node table in sync. See AliasCache::UpdateCallback.
+    static void local_alias_updated(
+        void *context, NodeID id, NodeAlias alias, unsigned entry, bool added);
+
+    /// Marks a registered local node as active, in the node table as well as
+    /// in the LRU order of the local alias cache.
+    /// @param t the local node table.
+    /// @param idx index of the node in t.
+    void touch_local_node(LocalNodeTable *t, unsigned idx);
+
     friend class CanFrameWriteFlow; // accesses the device and the hubport.
 
     /** Aliases we know are owned by local (virtual or proxied) nodes.
@@ -148,7 +201,7 @@ private:
      *
      *  This member must only be accessed from the If's executor.
      */
-    AliasCache remoteAliases_;
+    RemoteAliasCache remoteAliases_;
 
     /// Various implementation control flows that this interface owns.
     std::vector<std::unique_ptr<Executable>> ownedFlows_;
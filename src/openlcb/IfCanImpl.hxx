@@ -85,7 +85,7 @@ protected:
     Action find_local_alias()
     {
         // We are on the IF's executor, so we can access the alias caches.
-        srcAlias_ = if_can()->local_aliases()->lookup(nmsg()->src.id);
+        srcAlias_ = if_can()->lookup_local_alias_by_id(nmsg()->src.id);
         if (!srcAlias_)
         {
             return call_immediately(STATE(allocate_new_alias));
@@ -108,8 +108,10 @@ private:
             nmsg()->src.id, this);
         if (!alias)
         {
-            // wait for notification and re-try this step.
-            return wait();
+            // Waits for notification. The alias lookup has to be repeated,
+            // because while we were waiting, the node might have gotten an
+            // alias from an alias mapping enquiry or another write flow.
+            return wait_and_call(STATE(find_local_alias));
         }
         LOG(INFO, "Allocating new alias %03X for node %012" PRIx64, alias,
             nmsg()->src.id);
@@ -271,16 +273,13 @@ protected:
         else if (dst_.alias)
         {
             // Check if this is a local node being called by alias.
-            NodeID id = if_can()->local_aliases()->lookup(dst_.alias);
-            if (id)
+            Node *dst_node;
+            NodeID id = if_can()->lookup_local_alias(dst_.alias, &dst_node);
+            if (dst_node)
             {
-                Node *dst_node = if_can()->lookup_local_node(id);
-                if (dst_node)
-                {
-                    dst_.id = id;
-                    nmsg()->dstNode = dst_node;
-                    return call_immediately(STATE(send_to_local_node));
-                }
+                dst_.id = id;
+                nmsg()->dstNode = dst_node;
+                return call_immediately(STATE(send_to_local_node));
             }
         }
         if (dst_.alias && dstAlias_ && dst_.alias != dstAlias_)
@@ -165,7 +165,7 @@ public:
         {
             // Addressed message.
             srcNode_ = m->dstNode;
-            it_ = iface()->localNodes_.end();
+            nextIdx_ = LocalNodeTable::NONE;
         }
         else if (!m->payload.empty() && m->payload.size() == 6)
         {
@@ -178,7 +178,7 @@ public:
                 return release_and_exit();
             }
 #ifndef SIMPLE_NODE_ONLY
-            it_ = iface()->localNodes_.end();
+            nextIdx_ = LocalNodeTable::NONE;
 #endif
         }
         else
@@ -186,25 +186,22 @@ public:
 // Global message. Everyone should respond.
 #ifdef SIMPLE_NODE_ONLY
             // We assume there can be only one local node.
-            If::VNodeMap::Iterator it = iface()->localNodes_.begin();
-            if (it == iface()->localNodes_.end())
+            if (!iface()->localNodes_.size())
             {
                 // No local nodes.
                 return release_and_exit();
             }
-            srcNode_ = it->second;
-            ++it;
-            HASSERT(it == iface()->localNodes_.end());
+            srcNode_ = iface()->localNodes_.node(0);
+            HASSERT(iface()->localNodes_.size() == 1);
 #else
             // We need to do an iteration over all local nodes.
-            it_ = iface()->localNodes_.begin();
-            if (it_ == iface()->localNodes_.end())
+            if (!iface()->localNodes_.size())
             {
                 // No local nodes.
                 return release_and_exit();
             }
-            srcNode_ = it_->second;
-            ++it_;
+            srcNode_ = iface()->localNodes_.node(0);
+            nextIdx_ = 1;
 #endif // not simple node.
         }
         if (srcNode_)
@@ -245,10 +242,10 @@ public:
          *
          * @TODO(balazs.racz): we should probably wait for the outgoing message
          * to be sent. */
-        if (it_ != iface()->localNodes_.end())
+        if (nextIdx_ < iface()->localNodes_.size())
         {
-            srcNode_ = it_->second;
-            ++it_;
+            srcNode_ = iface()->localNodes_.node(nextIdx_);
+            ++nextIdx_;
             return allocate_and_call(iface()->global_message_write_flow(),
                                      STATE(send_response));
         }
@@ -263,7 +260,8 @@ private:
     Node *srcNode_;
 
 #ifndef SIMPLE_NODE_ONLY
-    If::VNodeMap::Iterator it_;
+    /// Index of the next node to respond in the local nodes table.
+    unsigned nextIdx_;
 #endif
 };
 
@@ -41,16 +41,6 @@
 namespace openlcb
 {
 
-/// This is not used at the moment, as TCP packet routing is not supported yet.
-struct TcpMessage
-{
-    /// Destination node, or {0,0} for broadcast. Helper function for routing.
-    NodeHandle dst;
-    /// Rendered string for the message payload. Includes the header (flags and
-    /// length as well).
-    string data;
-};
-
 class ClockBaseSequenceNumberGenerator;
 class TcpSendFlow;
 class TcpRecvFlow;
@@ -61,8 +51,10 @@ class TcpRecvFlow;
 /// the API and owns all of the implementation for sending and receiving
 /// messages to/from this network link.
 ///
-/// Today the IfTcp class supports a dumb hub on the device end. This allows
-/// creating servers although without any advanced routing logic.
+/// The device end is a hub of rendered TCP messages. With a plain HubFlow
+/// every message is forwarded to every port. Using a TcpRoutingHub as the
+/// device makes the server send addressed messages only to the port where the
+/// destination node lives, and event reports only to the interested ports.
 class IfTcp : public If
 {
 public:
@@ -0,0 +1,236 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file LocalNodeTable.cxx
+ *
+ * Index of the virtual nodes registered on an interface.
+ *
+ * @author Balazs Racz
+ * @date 17 Oct 2026
+ */
+
+#include "openlcb/LocalNodeTable.hxx"
+
+#include "openlcb/Node.hxx"
+
+namespace openlcb
+{
+
+constexpr unsigned LocalNodeTable::NONE;
+constexpr unsigned LocalNodeTable::NO_CACHE_ENTRY;
+
+LocalNodeTable::LocalNodeTable(unsigned size_hint)
+{
+    entries_.reserve(size_hint);
+    rehash(size_hint);
+}
+
+unsigned LocalNodeTable::insert(Node *node)
+{
+    unsigned idx = entries_.size();
+    entries_.push_back({node, node->node_id(), 0, NO_CACHE_ENTRY, generation_});
+    if (2 * entries_.size() > idIndex_.size())
+    {
+        // Keeps the load factor under 1/2.
+        rehash(2 * entries_.size());
+    }
+    else
+    {
+        index_add(false, idx);
+    }
+    return idx;
+}
+
+bool LocalNodeTable::erase(NodeID id)
+{
+    unsigned idx = find(id);
+    if (idx == NONE)
+    {
+        return false;
+    }
+    index_remove(false, idx);
+    if (entries_[idx].alias_)
+    {
+        index_remove(true, idx);
+    }
+    unsigned last = entries_.size() - 1;
+    if (idx != last)
+    {
+        index_move(false, last, idx);
+        if (entries_[last].alias_)
+        {
+            index_move(true, last, idx);
+        }
+        entries_[idx] = entries_[last];
+    }
+    entries_.pop_back();
+    return true;
+}
+
+unsigned LocalNodeTable::find(NodeID id) const
+{
+    unsigned mask = idIndex_.size() - 1;
+    for (unsigned b = hash_id(id);; b = (b + 1) & mask)
+    {
+        uint32_t e = idIndex_[b];
+        if (!e)
+        {
+            return NONE;
+        }
+        if (entries_[e - 1].id_ == id)
+        {
+            return e - 1;
+        }
+    }
+}
+
+unsigned LocalNodeTable::find_alias(NodeAlias alias) const
+{
+    unsigned mask = aliasIndex_.size() - 1;
+    for (unsigned b = hash_alias(alias);; b = (b + 1) & mask)
+    {
+        uint32_t e = aliasIndex_[b];
+        if (!e)
+        {
+            return NONE;
+        }
+        if (entries_[e - 1].alias_ == alias)
+        {
+            return e - 1;
+        }
+    }
+}
+
+void LocalNodeTable::set_alias(
+    unsigned idx, NodeAlias alias, unsigned cache_entry)
+{
+    entries_[idx].cacheEntry_ = alias ? cache_entry : NO_CACHE_ENTRY;
+    if (entries_[idx].alias_ == alias)
+    {
+        return;
+    }
+    if (entries_[idx].alias_)
+    {
+        index_remove(true, idx);
+    }
+    entries_[idx].alias_ = alias;
+    if (alias)
+    {
+        index_add(true, idx);
+    }
+}
+
+void LocalNodeTable::clear_aliases()
+{
+    for (auto &e : entries_)
+    {
+        e.alias_ = 0;
+        e.cacheEntry_ = NO_CACHE_ENTRY;
+    }
+    std::fill(aliasIndex_.begin(), aliasIndex_.end(), 0);
+}
+
+void LocalNodeTable::index_add(bool by_alias, unsigned idx)
+{
+    Index &index = by_alias ? aliasIndex_ : idIndex_;
+    unsigned mask = index.size() - 1;
+    unsigned b = home_bucket(by_alias, idx);
+    while (index[b])
+    {
+        b = (b + 1) & mask;
+    }
+    index[b] = idx + 1;
+}
+
+void LocalNodeTable::index_remove(bool by_alias, unsigned idx)
+{
+    Index &index = by_alias ? aliasIndex_ : idIndex_;
+    unsigned mask = index.size() - 1;
+    unsigned hole = home_bucket(by_alias, idx);
+    while (index[hole] != idx + 1)
+    {
+        hole = (hole + 1) & mask;
+    }
+    // Backward shift deletion: moves the following entries of the probe
+    // sequence into the hole, so that lookups do not need tombstones.
+    unsigned b = hole;
+    while (true)
+    {
+        index[hole] = 0;
+        while (true)
+        {
+            b = (b + 1) & mask;
+            if (!index[b])
+            {
+                return;
+            }
+            unsigned home = home_bucket(by_alias, index[b] - 1);
+            // Entries whose home is cyclically in (hole, b] stay in place.
+            bool stays =
+                hole <= b ? (hole < home && home <= b) : (hole < home || home <= b);
+            if (!stays)
+            {
+                break;
+            }
+        }
+        index[hole] = index[b];
+        hole = b;
+    }
+}
+
+void LocalNodeTable::index_move(bool by_alias, unsigned from, unsigned to)
+{
+    Index &index = by_alias ? aliasIndex_ : idIndex_;
+    unsigned mask = index.size() - 1;
+    unsigned b = home_bucket(by_alias, from);
+    while (index[b] != from + 1)
+    {
+        b = (b + 1) & mask;
+    }
+    index[b] = to + 1;
+}
+
+void LocalNodeTable::rehash(unsigned n)
+{
+    unsigned bits = 3;
+    while ((1u << bits) < 2 * n)
+    {
+        ++bits;
+    }
+    hashShift_ = 64 - bits;
+    idIndex_.assign(1u << bits, 0);
+    aliasIndex_.assign(1u << bits, 0);
+    for (unsigned i = 0; i < entries_.size(); ++i)
+    {
+        index_add(false, i);
+        if (entries_[i].alias_)
+        {
+            index_add(true, i);
+        }
+    }
+}
+
+} // namespace openlcb
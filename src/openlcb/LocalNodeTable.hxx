@@ -0,0 +1,230 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file LocalNodeTable.hxx
+ *
+ * Index of the virtual nodes registered on an interface.
+ *
+ * @author Balazs Racz
+ * @date 17 Oct 2026
+ */
+
+#ifndef _OPENLCB_LOCALNODETABLE_HXX_
+#define _OPENLCB_LOCALNODETABLE_HXX_
+
+#include <vector>
+
+#include "openlcb/Defs.hxx"
+#include "utils/macros.h"
+
+namespace openlcb
+{
+
+class Node;
+
+/// Stores the local (virtual) nodes of an interface. The nodes are kept in a
+/// dense array, which is indexed by two open-addressing hash tables: one by
+/// node ID and one by the local alias of the node. Both lookups are O(1) and
+/// do not depend on the number of nodes, which matters for command stations
+/// that create a train node for every address ever seen.
+///
+/// Nodes are addressed by their index in the array. Indexes are stable until
+/// a node is removed; removing a node moves the last node into its place.
+///
+/// The table also tracks which nodes were active lately, so that the
+/// interface can release the alias of idle nodes.
+class LocalNodeTable
+{
+public:
+    /// Index value meaning "not found".
+    static constexpr unsigned NONE = 0xFFFFFFFFu;
+    /// Value of cache_entry() when the alias cache entry is not known.
+    static constexpr unsigned NO_CACHE_ENTRY = 0xFFFFu;
+
+    /// Constructor.
+    /// @param size_hint how many nodes to reserve space for.
+    LocalNodeTable(unsigned size_hint = 0);
+
+    /// @return the number of nodes in the table.
+    unsigned size() const
+    {
+        return entries_.size();
+    }
+
+    /// Adds a node to the table. The node must not be in the table yet.
+    /// @param node the node to add.
+    /// @return the index of the new node.
+    unsigned insert(Node *node);
+
+    /// Removes a node from the table.
+    /// @param id node ID of the node to remove.
+    /// @return true if the node was found.
+    bool erase(NodeID id);
+
+    /// Looks up a node by node ID.
+    /// @param id node ID to look for.
+    /// @return index of the node, or NONE.
+    unsigned find(NodeID id) const;
+
+    /// Looks up a node by its local alias.
+    /// @param alias alias to look for (nonzero).
+    /// @return index of the node, or NONE.
+    unsigned find_alias(NodeAlias alias) const;
+
+    /// @param idx index of a node.
+    /// @return the node at idx.
+    Node *node(unsigned idx) const
+    {
+        return entries_[idx].node_;
+    }
+
+    /// @param idx index of a node.
+    /// @return the node ID of the node at idx.
+    NodeID id(unsigned idx) const
+    {
+        return entries_[idx].id_;
+    }
+
+    /// @param idx index of a node.
+    /// @return the local alias of the node at idx, or 0 if it has none.
+    NodeAlias alias(unsigned idx) const
+    {
+        return entries_[idx].alias_;
+    }
+
+    /// @param idx index of a node.
+    /// @return the index of the alias of the node in the local alias cache,
+    /// or NO_CACHE_ENTRY.
+    unsigned cache_entry(unsigned idx) const
+    {
+        return entries_[idx].cacheEntry_;
+    }
+
+    /// Sets or clears the local alias of a node.
+    /// @param idx index of the node.
+    /// @param alias new alias, or 0 to clear the alias.
+    /// @param cache_entry index of the alias in the local alias cache, or
+    /// NO_CACHE_ENTRY.
+    void set_alias(
+        unsigned idx, NodeAlias alias, unsigned cache_entry = NO_CACHE_ENTRY);
+
+    /// Clears the alias of every node.
+    void clear_aliases();
+
+    /// Marks a node as active.
+    /// @param idx index of the node.
+    void touch(unsigned idx)
+    {
+        entries_[idx].generation_ = generation_;
+    }
+
+    /// @param idx index of a node.
+    /// @return true if the node was not touched since the previous call to
+    /// next_generation().
+    bool is_idle(unsigned idx) const
+    {
+        return entries_[idx].generation_ != generation_;
+    }
+
+    /// Starts a new activity period. The nodes that were not touched in the
+    /// previous period become idle.
+    void next_generation()
+    {
+        ++generation_;
+    }
+
+private:
+    /// Data about one node.
+    struct Entry
+    {
+        /// The node.
+        Node *node_;
+        /// Cached node ID of the node.
+        NodeID id_;
+        /// Local alias of the node, 0 if none.
+        NodeAlias alias_;
+        /// Index of alias_ in the local alias cache, or NO_CACHE_ENTRY.
+        uint16_t cacheEntry_;
+        /// Activity period when this node was last touched.
+        uint8_t generation_;
+    };
+
+    /// Stores index + 1 for each occupied hash bucket, 0 for empty buckets.
+    typedef std::vector<uint32_t> Index;
+
+    /// @param id node ID. @return hash bucket for id in the ID index.
+    unsigned hash_id(NodeID id) const
+    {
+        return (id * 0x9E3779B97F4A7C15ull) >> hashShift_;
+    }
+
+    /// @param alias alias. @return hash bucket for alias in the alias index.
+    unsigned hash_alias(NodeAlias alias) const
+    {
+        return (alias * 0x9E3779B97F4A7C15ull) >> hashShift_;
+    }
+
+    /// @param by_alias which index. @param idx entry index. @return the home
+    /// bucket of the entry in the given index.
+    unsigned home_bucket(bool by_alias, unsigned idx) const
+    {
+        return by_alias ? hash_alias(entries_[idx].alias_)
+                        : hash_id(entries_[idx].id_);
+    }
+
+    /// Adds an entry to an index. @param by_alias which index. @param idx
+    /// entry index.
+    void index_add(bool by_alias, unsigned idx);
+
+    /// Removes an entry from an index. @param by_alias which index. @param
+    /// idx entry index.
+    void index_remove(bool by_alias, unsigned idx);
+
+    /// Changes the bucket of an entry whose index changed. @param by_alias
+    /// which index. @param from old entry index. @param to new entry index.
+    void index_move(bool by_alias, unsigned from, unsigned to);
+
+    /// Rebuilds both indexes with at least 2 * n buckets. @param n number of
+    /// entries to support.
+    void rehash(unsigned n);
+
+    /// The nodes.
+    std::vector<Entry> entries_;
+    /// Hash index by node ID.
+    Index idIndex_;
+    /// Hash index by alias. Contains only the entries with nonzero alias.
+    Index aliasIndex_;
+    /// 64 - log2(number of buckets).
+    uint8_t hashShift_;
+    /// Current activity period.
+    uint8_t generation_ {0};
+
+    DISALLOW_COPY_AND_ASSIGN(LocalNodeTable);
+};
+
+} // namespace openlcb
+
+#endif // _OPENLCB_LOCALNODETABLE_HXX_
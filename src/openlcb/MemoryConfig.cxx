@@ -34,6 +34,7 @@
 
 #include "openlcb/MemoryConfig.hxx"
 
+#include <algorithm>
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -81,8 +82,29 @@ MemoryConfigHandler::app_handle_factory_reset(NodeID target)
     return Defs::ERROR_UNIMPLEMENTED;
 }
 
+uint16_t MemoryConfigHandler::sync_all_spaces()
+{
+    uint16_t ret = 0;
+    for (auto it = registry_.begin(); it != registry_.end(); ++it)
+    {
+        MemorySpace *space = (*it).second;
+        if (space)
+        {
+            uint16_t err = space->sync();
+            if (err && !ret)
+            {
+                ret = err;
+            }
+        }
+    }
+    return ret;
+}
+
 uint16_t MemoryConfigHandler::handle_factory_reset(NodeID target)
 {
+    // Factory reset rewrites the config file directly; any cached data
+    // would be stale afterwards.
+    sync_all_spaces();
     if (target == dg_service()->iface()->get_default_node_id())
     {
         static_cast<ConfigUpdateFlow *>(ConfigUpdateFlow::instance())
@@ -229,4 +251,290 @@ size_t FileMemorySpace::read(address_t destination, uint8_t *dst, size_t len,
     }
 }
 
+constexpr unsigned CachedFileMemorySpace::DEFAULT_NUM_PAGES;
+constexpr unsigned CachedFileMemorySpace::DEFAULT_PAGE_SIZE;
+constexpr long long CachedFileMemorySpace::DEFAULT_IDLE_FLUSH_NSEC;
+
+CachedFileMemorySpace::CachedFileMemorySpace(Service *service, int fd,
+    address_t len, unsigned num_pages, unsigned page_size,
+    long long idle_flush_nsec)
+    : FileMemorySpace(fd, len)
+    , pages_(num_pages)
+    , data_(new uint8_t[num_pages * page_size])
+    , pageSize_(page_size)
+    , flushTimer_(new FlushTimer(service, this, idle_flush_nsec))
+{
+    HASSERT(num_pages > 0);
+    HASSERT(page_size > 0 && page_size <= 0xFFFF);
+    for (Page &p : pages_)
+    {
+        p.valid_ = false;
+        p.dirtyBegin_ = p.dirtyEnd_ = 0;
+        p.lastUse_ = 0;
+        p.base_ = 0;
+    }
+}
+
+CachedFileMemorySpace::~CachedFileMemorySpace()
+{
+    sync();
+    if (flushPending_)
+    {
+        flushTimer_.release()->orphan();
+    }
+}
+
+CachedFileMemorySpace::Page *CachedFileMemorySpace::find_page(address_t base)
+{
+    for (Page &p : pages_)
+    {
+        if (p.valid_ && p.base_ == base)
+        {
+            p.lastUse_ = ++useCounter_;
+            return &p;
+        }
+    }
+    return nullptr;
+}
+
+CachedFileMemorySpace::Page *CachedFileMemorySpace::get_page(
+    address_t base, bool fill, errorcode_t *error)
+{
+    Page *p = find_page(base);
+    if (p)
+    {
+        return p;
+    }
+    // Evicts the least recently used page.
+    p = &pages_[0];
+    for (Page &c : pages_)
+    {
+        if (!c.valid_)
+        {
+            p = &c;
+            break;
+        }
+        if (c.lastUse_ < p->lastUse_)
+        {
+            p = &c;
+        }
+    }
+    if (p->valid_)
+    {
+        errorcode_t err = flush_page(p);
+        if (err)
+        {
+            *error = err;
+            return nullptr;
+        }
+        p->valid_ = false;
+    }
+    uint8_t *data = page_data(*p);
+    size_t have = 0;
+    if (fill)
+    {
+        if (lseek(fd_, base, SEEK_SET) != (off_t)base)
+        {
+            *error = MemoryConfigDefs::ERROR_OUT_OF_BOUNDS;
+            return nullptr;
+        }
+        while (have < pageSize_)
+        {
+            ssize_t ret = ::read(fd_, data + have, pageSize_ - have);
+            if (ret < 0)
+            {
+                LOG(INFO, "Error reading from fd %d: %s", fd_,
+                    strerror(errno));
+                *error = Defs::ERROR_PERMANENT;
+                return nullptr;
+            }
+            if (ret == 0)
+            {
+                // EOF
+                break;
+            }
+            have += ret;
+        }
+    }
+    memset(data + have, 0, pageSize_ - have);
+    p->base_ = base;
+    p->dirtyBegin_ = p->dirtyEnd_ = 0;
+    p->lastUse_ = ++useCounter_;
+    p->valid_ = true;
+    return p;
+}
+
+MemorySpace::errorcode_t CachedFileMemorySpace::flush_page(Page *p)
+{
+    if (p->dirtyBegin_ == p->dirtyEnd_)
+    {
+        return 0;
+    }
+    address_t ofs = p->base_ + p->dirtyBegin_;
+    const uint8_t *data = page_data(*p) + p->dirtyBegin_;
+    size_t len = p->dirtyEnd_ - p->dirtyBegin_;
+    if (lseek(fd_, ofs, SEEK_SET) != (off_t)ofs)
+    {
+        return MemoryConfigDefs::ERROR_OUT_OF_BOUNDS;
+    }
+    ++fileWrites_;
+    while (len)
+    {
+        ssize_t ret = ::write(fd_, data, len);
+        if (ret <= 0)
+        {
+            LOG(INFO, "Error writing to fd %d: %s", fd_, strerror(errno));
+            return Defs::ERROR_PERMANENT;
+        }
+        data += ret;
+        len -= ret;
+    }
+    p->dirtyBegin_ = p->dirtyEnd_ = 0;
+    return 0;
+}
+
+size_t CachedFileMemorySpace::write(address_t destination,
+    const uint8_t *data, size_t len, errorcode_t *error, Notifiable *again)
+{
+    ensure_file_open();
+    if (fd_ < 0)
+    {
+        *error = Defs::ERROR_PERMANENT;
+        return 0;
+    }
+    ++writeRequests_;
+    size_t done = 0;
+    while (done < len)
+    {
+        address_t address = destination + done;
+        unsigned ofs = address % pageSize_;
+        size_t count = std::min(len - done, (size_t)(pageSize_ - ofs));
+        Page *p = get_page(address - ofs, count < pageSize_, error);
+        if (!p)
+        {
+            return done;
+        }
+        memcpy(page_data(*p) + ofs, data + done, count);
+        if (p->dirtyBegin_ == p->dirtyEnd_)
+        {
+            p->dirtyBegin_ = ofs;
+            p->dirtyEnd_ = ofs + count;
+        }
+        else
+        {
+            // The bytes in between come from the file, so the dirty range
+            // stays contiguous.
+            p->dirtyBegin_ = std::min(p->dirtyBegin_, (uint16_t)ofs);
+            p->dirtyEnd_ = std::max(p->dirtyEnd_, (uint16_t)(ofs + count));
+        }
+        done += count;
+    }
+    flushTimer_->restart();
+    flushPending_ = true;
+    return done;
+}
+
+size_t CachedFileMemorySpace::read(address_t source, uint8_t *dst, size_t len,
+    errorcode_t *error, Notifiable *again)
+{
+    ensure_file_open();
+    if (fd_ < 0)
+    {
+        *error = Defs::ERROR_PERMANENT;
+        return 0;
+    }
+    if (source >= fileSize_)
+    {
+        *error = MemoryConfigDefs::ERROR_OUT_OF_BOUNDS;
+        return 0;
+    }
+    if (source + len > fileSize_)
+    {
+        len = fileSize_ - source;
+    }
+    bool hit = true;
+    size_t done = 0;
+    while (done < len)
+    {
+        address_t address = source + done;
+        unsigned ofs = address % pageSize_;
+        size_t count = std::min(len - done, (size_t)(pageSize_ - ofs));
+        Page *p = find_page(address - ofs);
+        if (p)
+        {
+            memcpy(dst + done, page_data(*p) + ofs, count);
+            done += count;
+            continue;
+        }
+        hit = false;
+        size_t ret =
+            FileMemorySpace::read(address, dst + done, count, error, again);
+        done += ret;
+        if (ret < count)
+        {
+            break;
+        }
+    }
+    if (hit)
+    {
+        ++readHits_;
+    }
+    else
+    {
+        ++readMisses_;
+    }
+    if (done && *error == MemoryConfigDefs::ERROR_OUT_OF_BOUNDS)
+    {
+        // Partial read hit the end of the file.
+        *error = 0;
+    }
+    return done;
+}
+
+MemorySpace::errorcode_t CachedFileMemorySpace::sync()
+{
+    errorcode_t ret = 0;
+    // Writes the pages in increasing address order.
+    Page *prev = nullptr;
+    while (true)
+    {
+        Page *next = nullptr;
+        for (Page &p : pages_)
+        {
+            if (p.valid_ && p.dirtyBegin_ != p.dirtyEnd_ &&
+                (!prev || p.base_ > prev->base_) &&
+                (!next || p.base_ < next->base_))
+            {
+                next = &p;
+            }
+        }
+        if (!next)
+        {
+            break;
+        }
+        errorcode_t err = flush_page(next);
+        if (err)
+        {
+            // Keeps the dirty range; it is retried at the next sync.
+            LOG_ERROR("Config cache: failed to write %u bytes at offset %u, "
+                      "error 0x%04x.",
+                (unsigned)(next->dirtyEnd_ - next->dirtyBegin_),
+                (unsigned)(next->base_ + next->dirtyBegin_), err);
+            if (!ret)
+            {
+                ret = err;
+            }
+        }
+        prev = next;
+    }
+    for (Page &p : pages_)
+    {
+        if (p.dirtyBegin_ == p.dirtyEnd_)
+        {
+            p.valid_ = false;
+        }
+    }
+    return ret;
+}
+
 } // namespace openlcb
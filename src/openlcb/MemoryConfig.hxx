@@ -35,6 +35,9 @@
 #ifndef _OPENLCB_MEMORYCONFIG_HXX_
 #define _OPENLCB_MEMORYCONFIG_HXX_
 
+#include <memory>
+#include <vector>
+
 #include "openlcb/DatagramDefs.hxx"
 #include "openlcb/DatagramHandlerDefault.hxx"
 #include "openlcb/MemoryConfigDefs.hxx"
@@ -170,6 +173,14 @@ public:
     virtual errorcode_t unfreeze() {
         return Defs::ERROR_INVALID_ARGS;
     }
+
+    /** Writes out any data that was buffered by write() to the backing
+     * storage, and drops any cached contents. Called before the configuration
+     * update listeners are invoked, so that they see the new data. Returns an
+     * error code, or 0 for success. */
+    virtual errorcode_t sync() {
+        return 0;
+    }
 };
 
 /// Memory space implementation that exports a some memory-mapped data as a
@@ -329,7 +340,7 @@ public:
     size_t read(address_t source, uint8_t *dst, size_t len, errorcode_t *error,
                 Notifiable *again) OVERRIDE;
 
-private:
+protected:
     /** Makes fd a valid parameter, and ensures fileSize is filled in. */
     void ensure_file_open();
 
@@ -338,6 +349,174 @@ private:
     int fd_;
 };
 
+/// FileMemorySpace with a page-granular write-back cache. Writes are merged
+/// into cached pages (one contiguous dirty range per page), and are written
+/// to the file when a page is evicted, when no write arrived for a while, or
+/// when sync() is called (e.g. at the Update Complete command). Reads are
+/// served from the cached pages where possible.
+///
+/// The cache is dropped at every sync, so other users of the same file see
+/// and may change the data once a configuration session is over. Pages that
+/// could not be written stay in the cache, and are retried by the idle flush
+/// timer and at the next sync. The file must accept blocking writes. All
+/// calls must be made on the executor of the service given in the
+/// constructor.
+class CachedFileMemorySpace : public FileMemorySpace
+{
+public:
+    static constexpr unsigned DEFAULT_NUM_PAGES = 4;
+    static constexpr unsigned DEFAULT_PAGE_SIZE = 256;
+    static constexpr long long DEFAULT_IDLE_FLUSH_NSEC = MSEC_TO_NSEC(500);
+
+    /** Creates a cached memory space based on an fd.
+     *
+     * @param service defines the executor for the idle flush timer.
+     * @param fd is an open file descriptor with the data.
+     * @param len tells how many bytes there are in the memory space. If
+     * specified as AUTO_LEN, then uses fstat to figure out the size of the
+     * file.
+     * @param num_pages how many pages to cache.
+     * @param page_size size of a cache page in bytes. Should match the
+     * program page of the backing flash.
+     * @param idle_flush_nsec dirty pages are written out when no write
+     * arrived for this long.
+     */
+    CachedFileMemorySpace(Service *service, int fd, address_t len = AUTO_LEN,
+        unsigned num_pages = DEFAULT_NUM_PAGES,
+        unsigned page_size = DEFAULT_PAGE_SIZE,
+        long long idle_flush_nsec = DEFAULT_IDLE_FLUSH_NSEC);
+
+    ~CachedFileMemorySpace();
+
+    size_t write(address_t destination, const uint8_t *data, size_t len,
+                 errorcode_t *error, Notifiable *again) OVERRIDE;
+
+    size_t read(address_t source, uint8_t *dst, size_t len, errorcode_t *error,
+                Notifiable *again) OVERRIDE;
+
+    errorcode_t sync() OVERRIDE;
+
+    /// @return the number of read calls served entirely from the cache.
+    unsigned read_hits()
+    {
+        return readHits_;
+    }
+
+    /// @return the number of read calls that had to go to the file.
+    unsigned read_misses()
+    {
+        return readMisses_;
+    }
+
+    /// @return the number of write calls received.
+    unsigned write_requests()
+    {
+        return writeRequests_;
+    }
+
+    /// @return the number of write calls issued to the file. The ratio of
+    /// write_requests() to this is the coalescing factor.
+    unsigned file_writes()
+    {
+        return fileWrites_;
+    }
+
+private:
+    /// Metadata of one cache page.
+    struct Page
+    {
+        /// File offset of the first byte of the page.
+        address_t base_;
+        /// Sequence number of the last access, for LRU eviction.
+        unsigned lastUse_;
+        /// Offset of the first dirty byte in the page.
+        uint16_t dirtyBegin_;
+        /// Offset after the last dirty byte. Equals dirtyBegin_ if clean.
+        uint16_t dirtyEnd_;
+        /// True if the page holds data.
+        bool valid_;
+    };
+
+    /// Calls sync() when no write arrived for a while, and again every
+    /// period while sync() fails.
+    class FlushTimer : public ::Timer
+    {
+    public:
+        FlushTimer(Service *s, CachedFileMemorySpace *parent, long long period)
+            : ::Timer(s->executor()->active_timers())
+            , parent_(parent)
+        {
+            update_period(period);
+        }
+
+        long long timeout() override
+        {
+            if (!parent_)
+            {
+                // The memory space was destroyed while we were pending.
+                return DELETE;
+            }
+            if (parent_->sync())
+            {
+                return RESTART;
+            }
+            parent_->flushPending_ = false;
+            return NONE;
+        }
+
+        /// Detaches the timer from a parent that is being destroyed. The
+        /// timer may have expired already and be waiting in the executor's
+        /// queue, so it cannot be cancelled; instead it deletes itself when
+        /// it runs.
+        void orphan()
+        {
+            parent_ = nullptr;
+            ensure_triggered();
+        }
+
+    private:
+        CachedFileMemorySpace *parent_;
+    };
+
+    /// @return the data of a given page.
+    uint8_t *page_data(const Page &p)
+    {
+        return data_.get() + (&p - &pages_[0]) * pageSize_;
+    }
+
+    /// @return the cached page for a base address, or nullptr.
+    Page *find_page(address_t base);
+
+    /** Finds or allocates the cache page for a given base address. May evict
+     * (and write out) another page.
+     * @param base page-aligned file offset.
+     * @param fill if true, loads the page contents from the file.
+     * @param error set to an error code on failure.
+     * @return the page, or nullptr on failure. */
+    Page *get_page(address_t base, bool fill, errorcode_t *error);
+
+    /// Writes out the dirty range of a page. @return error code or 0.
+    errorcode_t flush_page(Page *p);
+
+    /// Cache page metadata.
+    std::vector<Page> pages_;
+    /// Cache page contents, pageSize_ bytes for each page.
+    std::unique_ptr<uint8_t[]> data_;
+    /// Size of a cache page in bytes.
+    unsigned pageSize_;
+    /// Counter for LRU bookkeeping.
+    unsigned useCounter_{0};
+    unsigned readHits_{0};
+    unsigned readMisses_{0};
+    unsigned writeRequests_{0};
+    unsigned fileWrites_{0};
+    /// True if flushTimer_ was started and its timeout did not complete yet.
+    bool flushPending_{false};
+    /// Writes out dirty pages after the writes stopped. Owned by this object
+    /// unless it is orphaned in the destructor.
+    std::unique_ptr<FlushTimer> flushTimer_;
+};
+
 /// Memory space implementation that exports the contents of a file as a memory
 /// space. The file can be specified either as a path or an fd. By default
 /// writes are also allowed.
@@ -609,7 +788,7 @@ public:
     {
         size_t len = message->data()->payload.size();
         const uint8_t *bytes = (const uint8_t *)message->data()->payload.data();
-        uint8_t cmd = ((len >= 2) && (client_ != nullptr)) ? bytes[1] : 0;
+        uint8_t cmd = ((len >= 2) && !clients_.empty()) ? bytes[1] : 0;
         bool is_client_command = false;
         // To recognize replies for read & write commands, we need to look at a
         // bit.
@@ -635,23 +814,43 @@ public:
             is_client_command);
         if (is_client_command)
         {
-            client_->send(message, priority);
+            find_client(message->data()->src)->send(message, priority);
             return;
         }
         DatagramHandlerFlow::send(message, priority);
     }
 
     /// Registers a second handler to forward all the client interactions,
-    /// i.e. everythingthat comes back with the RESPONSE bit set.
-    void set_client(DatagramHandlerFlow* client) {
-        HASSERT(client_ == nullptr || client_ == client);
-        client_ = client;
+    /// i.e. everythingthat comes back with the RESPONSE bit set. Multiple
+    /// clients can be registered when they talk to different remote nodes.
+    /// @param client the handler for the response datagrams.
+    /// @param peer the remote node that this client is talking to. The
+    /// responses from this node will be routed to this client. If empty, the
+    /// client gets the responses from every node.
+    void set_client(DatagramHandlerFlow *client, NodeHandle peer = NodeHandle())
+    {
+        for (auto &c : clients_)
+        {
+            if (c.client == client)
+            {
+                c.peer = peer;
+                return;
+            }
+        }
+        clients_.push_back({client, peer});
     }
 
     /// Unregisters the previously registered second handler.
     void clear_client(DatagramHandlerFlow* client) {
-        HASSERT(client_ == client);
-        client_ = nullptr;
+        for (auto it = clients_.begin(); it != clients_.end(); ++it)
+        {
+            if (it->client == client)
+            {
+                clients_.erase(it);
+                return;
+            }
+        }
+        DIE("Clearing a memory config client that is not registered.");
     }
 
     /// This will be called by the constructor of the stream handler plugin.
@@ -726,7 +925,12 @@ private:
             }
             case MemoryConfigDefs::COMMAND_UPDATE_COMPLETE:
             {
+                uint16_t err = sync_all_spaces();
                 Singleton<ConfigUpdateService>::instance()->trigger_update();
+                if (err)
+                {
+                    return respond_reject(err);
+                }
                 return respond_ok(0);
             }
             case MemoryConfigDefs::COMMAND_RESET:
@@ -774,9 +978,10 @@ private:
             case MemoryConfigDefs::COMMAND_LOCK_REPLY:
             case MemoryConfigDefs::COMMAND_UNIQUE_ID_REPLY:
             {
-                if (client_)
+                if (!clients_.empty())
                 {
-                    client_->send(transfer_message());
+                    find_client(message()->data()->src)
+                        ->send(transfer_message());
                     return exit();
                 }
                 LOG(VERBOSE, "memcfg handler reply: no client registered");
@@ -806,6 +1011,11 @@ private:
         }
     };
 
+    /// Calls sync() on every registered memory space, so that the backing
+    /// storage is up to date before the configuration listeners read it.
+    /// @return the first error returned by a space, or 0.
+    uint16_t sync_all_spaces();
+
     /// Invokes the openlcb config handler to do a factory reset. Starts a
     /// timer to reboot the device after a little time.
     /// @param target the node ID for which factory reset was invoked.
@@ -1124,9 +1334,35 @@ private:
     //NodeID lockNode_; //< Holds the node ID that locked us.
 
     Registry registry_;         //< holds the known memory spaces
-    /// If there is a memory config client, we will forward response traffic to
-    /// it.
-    DatagramHandlerFlow* client_{nullptr};
+    /// A memory config client registration.
+    struct ClientEntry
+    {
+        /// Handler for the response datagrams.
+        DatagramHandlerFlow *client;
+        /// Remote node the client talks to.
+        NodeHandle peer;
+    };
+
+    /// @return the client to forward a response to. Must have at least one
+    /// client registered.
+    /// @param src the node that sent the response.
+    DatagramHandlerFlow *find_client(NodeHandle src)
+    {
+        for (auto &c : clients_)
+        {
+            if ((!c.peer.id && !c.peer.alias) ||
+                dg_service()->iface()->matching_node(c.peer, src))
+            {
+                return c.client;
+            }
+        }
+        // Nobody is waiting for this node. The first client will reject it.
+        return clients_[0].client;
+    }
+
+    /// If there are memory config clients, we will forward response traffic
+    /// to them.
+    std::vector<ClientEntry> clients_;
     /// If there is a handler for stream requests, we will forward the
     /// respective traffic to it.
     DatagramHandlerFlow *streamHandler_ {nullptr};
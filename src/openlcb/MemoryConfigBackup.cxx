@@ -0,0 +1,525 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file MemoryConfigBackup.cxx
+ *
+ * Reads or writes the configuration of many nodes in parallel using the
+ * memory config protocol.
+ *
+ * @author Balazs Racz
+ * @date 17 Oct 2026
+ */
+
+#include "openlcb/MemoryConfigBackup.hxx"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace openlcb
+{
+
+constexpr unsigned MemoryConfigBackup::MAX_ATTEMPTS;
+constexpr unsigned MemoryConfigBackup::CONGESTION_FACTOR;
+
+/// Header at the beginning of every archive.
+static const char ARCHIVE_HEADER[] = "OLCBcfg\x01";
+/// Length of the header (without the terminating zero).
+static constexpr unsigned ARCHIVE_HEADER_LEN = sizeof(ARCHIVE_HEADER) - 1;
+/// Length of the fixed part of a record.
+static constexpr unsigned RECORD_HEADER_LEN = 6 + 1 + 4 + 4 + 4;
+/// When the size of the archive is not known, the record data is read in
+/// chunks of this many bytes.
+static constexpr unsigned READ_CHUNK = 4096;
+
+/// Appends a 32-bit value in big-endian to a buffer.
+/// @param value what to append
+/// @param p where to write; will be advanced by 4.
+static void append_u32(uint32_t value, uint8_t **p)
+{
+    for (int i = 3; i >= 0; --i)
+    {
+        *(*p)++ = (value >> (8 * i)) & 0xff;
+    }
+}
+
+/// Reads a 32-bit value in big-endian from a buffer.
+/// @param p where to read from; will be advanced by 4.
+/// @return the value
+static uint32_t parse_u32(const uint8_t **p)
+{
+    uint32_t ret = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        ret <<= 8;
+        ret |= *(*p)++;
+    }
+    return ret;
+}
+
+MemoryConfigArchiveWriter::MemoryConfigArchiveWriter(int fd)
+    : fd_(fd)
+{
+    write_all(ARCHIVE_HEADER, ARCHIVE_HEADER_LEN);
+}
+
+bool MemoryConfigArchiveWriter::write(const MemoryConfigArchiveRecord &rec)
+{
+    uint8_t hdr[RECORD_HEADER_LEN];
+    node_id_to_data(rec.node, hdr);
+    uint8_t *p = hdr + 6;
+    *p++ = rec.space;
+    append_u32(rec.result, &p);
+    append_u32(rec.address, &p);
+    append_u32(rec.data.size(), &p);
+    write_all(hdr, sizeof(hdr));
+    write_all(rec.data.data(), rec.data.size());
+    return ok_;
+}
+
+void MemoryConfigArchiveWriter::write_all(const void *data, size_t len)
+{
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    while (ok_ && len)
+    {
+        ssize_t ret = ::write(fd_, p, len);
+        if (ret <= 0)
+        {
+            LOG(WARNING, "Config archive: write error: %s", strerror(errno));
+            ok_ = false;
+            return;
+        }
+        p += ret;
+        len -= ret;
+    }
+}
+
+MemoryConfigArchiveReader::MemoryConfigArchiveReader(int fd)
+    : fd_(fd)
+{
+    char hdr[ARCHIVE_HEADER_LEN];
+    valid_ = read_all(hdr, sizeof(hdr)) &&
+        memcmp(hdr, ARCHIVE_HEADER, ARCHIVE_HEADER_LEN) == 0;
+}
+
+bool MemoryConfigArchiveReader::read(MemoryConfigArchiveRecord *rec)
+{
+    uint8_t hdr[RECORD_HEADER_LEN];
+    if (!valid_ || !read_all(hdr, sizeof(hdr)))
+    {
+        return false;
+    }
+    rec->node = data_to_node_id(hdr);
+    const uint8_t *p = hdr + 6;
+    rec->space = *p++;
+    rec->result = parse_u32(&p);
+    rec->address = parse_u32(&p);
+    uint32_t len = parse_u32(&p);
+    // The length comes from the file, so we do not allocate more memory than
+    // what the file can have left.
+    off_t left = remaining();
+    if (left >= 0 && len > left)
+    {
+        LOG(WARNING, "Config archive: record length %u past the end of file.",
+            (unsigned)len);
+        valid_ = false;
+        return false;
+    }
+    rec->data.clear();
+    while (rec->data.size() < len)
+    {
+        size_t ofs = rec->data.size();
+        size_t chunk = len - ofs;
+        if (left < 0)
+        {
+            // Unknown size (e.g. a pipe): grows the buffer as data arrives.
+            chunk = std::min<size_t>(chunk, READ_CHUNK);
+        }
+        rec->data.resize(ofs + chunk);
+        if (!read_all(&rec->data[ofs], chunk))
+        {
+            LOG(WARNING, "Config archive: truncated record.");
+            valid_ = false;
+            return false;
+        }
+    }
+    return true;
+}
+
+off_t MemoryConfigArchiveReader::remaining()
+{
+    struct stat st;
+    if (::fstat(fd_, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        return -1;
+    }
+    off_t pos = ::lseek(fd_, 0, SEEK_CUR);
+    if (pos < 0)
+    {
+        return -1;
+    }
+    return st.st_size - pos;
+}
+
+bool MemoryConfigArchiveReader::read_all(void *data, size_t len)
+{
+    uint8_t *p = static_cast<uint8_t *>(data);
+    while (len)
+    {
+        ssize_t ret = ::read(fd_, p, len);
+        if (ret <= 0)
+        {
+            return false;
+        }
+        p += ret;
+        len -= ret;
+    }
+    return true;
+}
+
+/// Runs memory config client requests for one node at a time, pulling the
+/// jobs from the parent.
+class MemoryConfigBackup::Session : public StateFlowBase
+{
+public:
+    /// Constructor.
+    /// @param parent the owning backup flow.
+    /// @param node local node to send the requests from.
+    /// @param memcfg memory config handler of the local node.
+    /// @param use_stream true if we need a stream capable client.
+    Session(MemoryConfigBackup *parent, Node *node,
+        MemoryConfigHandler *memcfg, bool use_stream)
+        : StateFlowBase(parent->service())
+        , parent_(parent)
+    {
+        if (use_stream)
+        {
+            client_.reset(new MemoryConfigClientWithStream(node, memcfg, 0));
+        }
+        else
+        {
+            client_.reset(new MemoryConfigClient(node, memcfg));
+        }
+    }
+
+    /// Starts executing a job.
+    /// @param job what to do.
+    void start(Job job)
+    {
+        job_ = std::move(job);
+        busy_ = true;
+        start_flow(STATE(send_request));
+    }
+
+    /// @return true if the session is executing a job.
+    bool busy()
+    {
+        return busy_;
+    }
+
+    /// @return true if the session can be started with a new job.
+    bool idle()
+    {
+        return !busy_ && is_terminated();
+    }
+
+    /// @return the node that the current job talks to.
+    const NodeHandle &dst()
+    {
+        return job_.node;
+    }
+
+private:
+    Action send_request()
+    {
+        startTime_ = os_get_time_monotonic();
+        if (parent_->request()->reader)
+        {
+            return invoke_subflow_and_wait(client_.get(),
+                STATE(request_done), MemoryConfigClientRequest::WRITE,
+                job_.node, job_.space, job_.address, job_.data);
+        }
+        if (job_.use_stream)
+        {
+            return invoke_subflow_and_wait(client_.get(),
+                STATE(request_done), MemoryConfigClientRequest::READ_STREAM,
+                job_.node, job_.space);
+        }
+        return invoke_subflow_and_wait(client_.get(), STATE(request_done),
+            MemoryConfigClientRequest::READ, job_.node, job_.space);
+    }
+
+    Action request_done()
+    {
+        auto b = get_buffer_deleter(full_allocation_result(client_.get()));
+        // A retry of this job may go to any session.
+        busy_ = false;
+        parent_->job_done(
+            &job_, b->data(), os_get_time_monotonic() - startTime_);
+        if (parent_->take_job(&job_))
+        {
+            busy_ = true;
+            return call_immediately(STATE(send_request));
+        }
+        return exit();
+    }
+
+    /// Owning flow.
+    MemoryConfigBackup *parent_;
+    /// Talks to the remote node.
+    std::unique_ptr<MemoryConfigClient> client_;
+    /// Current job.
+    Job job_;
+    /// When the current job was started.
+    long long startTime_;
+    /// true while executing a job.
+    bool busy_ {false};
+};
+
+MemoryConfigBackup::MemoryConfigBackup(Node *node,
+    MemoryConfigHandler *memcfg, unsigned max_concurrency, bool use_stream)
+    : CallableFlow<MemoryConfigBackupRequest>(memcfg->dg_service())
+    , node_(node)
+    , limit_(std::max(1u, max_concurrency / 4))
+    , maxConcurrency_(max_concurrency)
+    , useStream_(use_stream)
+    , bestNsecPerByte_ {0, 0}
+{
+    HASSERT(max_concurrency > 0);
+    for (unsigned i = 0; i < max_concurrency; ++i)
+    {
+        sessions_.emplace_back(new Session(this, node, memcfg, use_stream));
+    }
+}
+
+MemoryConfigBackup::~MemoryConfigBackup()
+{
+}
+
+StateFlowBase::Action MemoryConfigBackup::entry()
+{
+    pending_.clear();
+    lastError_ = 0;
+    if (request()->reader)
+    {
+        if (!request()->reader->valid())
+        {
+            return return_with_error(Defs::ERROR_INVALID_ARGS);
+        }
+        MemoryConfigArchiveRecord rec;
+        while (request()->reader->read(&rec))
+        {
+            if (rec.result)
+            {
+                // The backup of this space failed; nothing to restore.
+                continue;
+            }
+            pending_.push_back({NodeHandle(rec.node), rec.space, 0, false,
+                rec.address, std::move(rec.data)});
+        }
+    }
+    else
+    {
+        for (NodeHandle n : request()->nodes)
+        {
+            // The archive records are keyed by node ID.
+            node_->iface()->canonicalize_handle(&n);
+            for (uint8_t space : request()->spaces)
+            {
+                pending_.push_back({n, space, 0, useStream_, 0, string()});
+            }
+        }
+    }
+    remaining_ = pending_.size();
+    active_ = 0;
+    peakActive_ = 0;
+    if (!remaining_)
+    {
+        return return_ok();
+    }
+    fill_sessions();
+    return wait_and_call(STATE(all_done));
+}
+
+StateFlowBase::Action MemoryConfigBackup::all_done()
+{
+    if (request()->writer && !request()->writer->ok())
+    {
+        return return_with_error(Defs::ERROR_PERMANENT);
+    }
+    if (request()->num_failed)
+    {
+        return return_with_error(lastError_);
+    }
+    return return_ok();
+}
+
+void MemoryConfigBackup::fill_sessions()
+{
+    for (auto &s : sessions_)
+    {
+        if (!s->idle())
+        {
+            continue;
+        }
+        Job job;
+        if (!take_job(&job))
+        {
+            return;
+        }
+        s->start(std::move(job));
+    }
+}
+
+bool MemoryConfigBackup::take_job(Job *job)
+{
+    if (active_ >= limit_)
+    {
+        return false;
+    }
+    for (auto it = pending_.begin(); it != pending_.end(); ++it)
+    {
+        // A node has only one session at a time; the memory config handler
+        // routes the responses by the remote node.
+        if (node_busy(it->node))
+        {
+            continue;
+        }
+        *job = std::move(*it);
+        pending_.erase(it);
+        ++active_;
+        peakActive_ = std::max(peakActive_, active_);
+        return true;
+    }
+    return false;
+}
+
+bool MemoryConfigBackup::node_busy(const NodeHandle &node)
+{
+    for (auto &s : sessions_)
+    {
+        if (s->busy() && node_->iface()->matching_node(s->dst(), node))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MemoryConfigBackup::job_done(
+    Job *job, MemoryConfigClientRequest *result, long long nsec)
+{
+    --active_;
+    int error = result->resultCode;
+    if (error && job->use_stream &&
+        (error & 0xFFF0) == Defs::ERROR_UNIMPLEMENTED)
+    {
+        // The node does not support stream read. Falls back to datagrams for
+        // all spaces of this node.
+        LOG(INFO, "Config backup: node %012" PRIx64 " does not support "
+                  "streams, using datagrams.", job->node.id);
+        for (auto &j : pending_)
+        {
+            if (node_->iface()->matching_node(j.node, job->node))
+            {
+                j.use_stream = false;
+            }
+        }
+        job->use_stream = false;
+        // Goes to the back of the queue: the rejection datagram may still be
+        // in flight through the dispatcher and would hit a fresh datagram
+        // client to the same node if we retried immediately.
+        pending_.push_back(std::move(*job));
+        fill_sessions();
+        return;
+    }
+    if (error &&
+        ((error & Defs::OPENMRN_TIMEOUT) || (error & Defs::ERROR_TEMPORARY)))
+    {
+        // The bus or the node is overloaded. Backs off and retries.
+        limit_ = std::max(1u, limit_ / 2);
+        if (++job->attempts < MAX_ATTEMPTS)
+        {
+            pending_.push_back(std::move(*job));
+            fill_sessions();
+            return;
+        }
+    }
+    else if (!error)
+    {
+        size_t bytes = request()->reader ? job->data.size()
+                                         : result->payload.size();
+        long long per_byte = nsec / std::max((size_t)1, bytes);
+        long long &best = bestNsecPerByte_[job->use_stream ? 1 : 0];
+        if (!best || per_byte < best)
+        {
+            best = per_byte;
+        }
+        if (per_byte > best * CONGESTION_FACTOR)
+        {
+            // More parallel requests only make each one slower.
+            if (limit_ > 1)
+            {
+                --limit_;
+            }
+        }
+        else if (limit_ < maxConcurrency_)
+        {
+            ++limit_;
+        }
+    }
+
+    if (error)
+    {
+        lastError_ = error;
+        ++request()->num_failed;
+    }
+    else
+    {
+        ++request()->num_ok;
+    }
+    if (request()->writer)
+    {
+        MemoryConfigArchiveRecord rec;
+        rec.node = job->node.id;
+        rec.space = job->space;
+        rec.result = error;
+        rec.address = 0;
+        rec.data = std::move(result->payload);
+        request()->writer->write(rec);
+    }
+    if (request()->progressCb)
+    {
+        request()->progressCb(request());
+    }
+    if (--remaining_ == 0)
+    {
+        notify();
+        return;
+    }
+    fill_sessions();
+}
+
+} // namespace openlcb
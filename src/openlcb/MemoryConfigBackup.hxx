@@ -0,0 +1,331 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file MemoryConfigBackup.hxx
+ *
+ * Reads or writes the configuration of many nodes in parallel using the
+ * memory config protocol.
+ *
+ * @author Balazs Racz
+ * @date 17 Oct 2026
+ */
+
+#ifndef _OPENLCB_MEMORYCONFIGBACKUP_HXX_
+#define _OPENLCB_MEMORYCONFIGBACKUP_HXX_
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "openlcb/MemoryConfigClient.hxx"
+
+namespace openlcb
+{
+
+/// One memory space of one node in a configuration archive.
+struct MemoryConfigArchiveRecord
+{
+    /// Node that the data belongs to.
+    NodeID node;
+    /// Memory space number.
+    uint8_t space;
+    /// Error code from reading the memory space; 0 on success. Records with
+    /// an error are kept in the archive so that the failures are visible, but
+    /// they are skipped by the restore.
+    uint32_t result;
+    /// Address of the first byte of data.
+    uint32_t address;
+    /// Contents of the memory space.
+    string data;
+};
+
+/// Writes configuration archive records to a file descriptor.
+///
+/// The archive is a stream of records, which allows writing each node's data
+/// out as soon as it arrives. Format (all integers big-endian):
+///   header: "OLCBcfg" 0x01
+///   record: node ID (6 bytes), space (1 byte), result (4 bytes),
+///           address (4 bytes), length (4 bytes), data (length bytes).
+class MemoryConfigArchiveWriter
+{
+public:
+    /// Constructor. Writes the archive header.
+    /// @param fd file descriptor to write to. Ownership is not transferred.
+    MemoryConfigArchiveWriter(int fd);
+
+    /// Appends a record to the archive.
+    /// @param rec the record to write.
+    /// @return true on success, false if there was a write error.
+    bool write(const MemoryConfigArchiveRecord &rec);
+
+    /// @return true if all writes so far succeeded.
+    bool ok()
+    {
+        return ok_;
+    }
+
+private:
+    /// Writes a block of data to the file descriptor. Clears ok_ upon error.
+    /// @param data what to write
+    /// @param len number of bytes.
+    void write_all(const void *data, size_t len);
+
+    /// File descriptor to write to.
+    int fd_;
+    /// false after a write error.
+    bool ok_ {true};
+};
+
+/// Reads records from a configuration archive created by
+/// MemoryConfigArchiveWriter.
+class MemoryConfigArchiveReader
+{
+public:
+    /// Constructor. Reads and checks the archive header.
+    /// @param fd file descriptor to read from. Ownership is not transferred.
+    MemoryConfigArchiveReader(int fd);
+
+    /// @return true if the archive header was valid.
+    bool valid()
+    {
+        return valid_;
+    }
+
+    /// Reads the next record.
+    /// @param rec will be filled in.
+    /// @return true if a record was read, false at the end of the archive or
+    /// if the archive is invalid or truncated.
+    bool read(MemoryConfigArchiveRecord *rec);
+
+private:
+    /// Reads a block of data from the file descriptor.
+    /// @param data where to read to
+    /// @param len number of bytes
+    /// @return true if all bytes were read.
+    bool read_all(void *data, size_t len);
+
+    /// @return the number of bytes left in the file, or -1 if the file
+    /// descriptor is not a regular file.
+    off_t remaining();
+
+    /// File descriptor to read from.
+    int fd_;
+    /// true if the header was correct.
+    bool valid_;
+};
+
+struct MemoryConfigBackupRequest : public CallableFlowRequestBase
+{
+    enum BackupCmd
+    {
+        BACKUP
+    };
+
+    enum RestoreCmd
+    {
+        RESTORE
+    };
+
+    /// Sets up a command to read memory spaces from many nodes.
+    /// @param BackupCmd polymorphic matching arg; always set to BACKUP.
+    /// @param n is the list of nodes to read.
+    /// @param s is the list of memory spaces to read from each node.
+    /// @param out is the archive to append the results to. Each space is
+    /// written as soon as it is read.
+    /// @param cb if specified, will be called after each memory space is done.
+    void reset(BackupCmd, std::vector<NodeHandle> n, std::vector<uint8_t> s,
+        MemoryConfigArchiveWriter *out,
+        std::function<void(MemoryConfigBackupRequest *)> cb = nullptr)
+    {
+        reset_base();
+        nodes = std::move(n);
+        spaces = std::move(s);
+        writer = out;
+        progressCb = std::move(cb);
+    }
+
+    /// Sets up a command to write the contents of an archive back to the
+    /// nodes.
+    /// @param RestoreCmd polymorphic matching arg; always set to RESTORE.
+    /// @param in is the archive to read.
+    /// @param cb if specified, will be called after each memory space is done.
+    void reset(RestoreCmd, MemoryConfigArchiveReader *in,
+        std::function<void(MemoryConfigBackupRequest *)> cb = nullptr)
+    {
+        reset_base();
+        reader = in;
+        progressCb = std::move(cb);
+    }
+
+    /// Helper function invoked at every other reset call.
+    void reset_base()
+    {
+        CallableFlowRequestBase::reset_base();
+        nodes.clear();
+        spaces.clear();
+        writer = nullptr;
+        reader = nullptr;
+        num_ok = 0;
+        num_failed = 0;
+        progressCb = nullptr;
+    }
+
+    /// Nodes to back up.
+    std::vector<NodeHandle> nodes;
+    /// Memory spaces to back up from each node.
+    std::vector<uint8_t> spaces;
+    /// Output archive of a backup.
+    MemoryConfigArchiveWriter *writer;
+    /// Input archive of a restore.
+    MemoryConfigArchiveReader *reader;
+    /// Number of memory spaces transferred successfully.
+    unsigned num_ok;
+    /// Number of memory spaces that failed.
+    unsigned num_failed;
+    /// Callback to execute as progress is being made.
+    std::function<void(MemoryConfigBackupRequest *)> progressCb;
+};
+
+/// Backs up or restores the configuration of many nodes. Runs multiple
+/// MemoryConfigClient sessions in parallel, each talking to a different
+/// node.
+///
+/// The number of parallel sessions adapts to the bus load: it grows by one
+/// after each memory space that was transferred at a good speed, shrinks by
+/// one when the transfer time per byte gets much worse than the best seen so
+/// far (requests are queueing on the bus), and is halved upon timeouts and
+/// temporary errors. Those memory spaces are retried.
+///
+/// The datagram service of the node needs at least max_concurrency datagram
+/// clients for the sessions to actually run in parallel.
+class MemoryConfigBackup : public CallableFlow<MemoryConfigBackupRequest>
+{
+public:
+    /// Constructor.
+    /// @param node is the local node to send the requests from.
+    /// @param memcfg is the memory config handler of node.
+    /// @param max_concurrency is the maximum number of nodes to talk to in
+    /// parallel.
+    /// @param use_stream if true, the memory spaces are read using stream
+    /// transport from the nodes that support it. Requires the interface of
+    /// the node to have stream transport.
+    MemoryConfigBackup(Node *node, MemoryConfigHandler *memcfg,
+        unsigned max_concurrency, bool use_stream = false);
+
+    ~MemoryConfigBackup();
+
+    /// @return the current limit on the number of parallel sessions.
+    unsigned concurrency()
+    {
+        return limit_;
+    }
+
+    /// @return the maximum number of sessions that were running in parallel
+    /// during the last request.
+    unsigned peak_concurrency()
+    {
+        return peakActive_;
+    }
+
+    /// How many times a memory space is tried before giving up.
+    static constexpr unsigned MAX_ATTEMPTS = 3;
+    /// If the time per byte of a transfer is more than this many times the
+    /// best seen, we consider the bus congested.
+    static constexpr unsigned CONGESTION_FACTOR = 4;
+
+private:
+    class Session;
+
+    /// One memory space to transfer.
+    struct Job
+    {
+        /// Node to talk to.
+        NodeHandle node;
+        /// Memory space number.
+        uint8_t space;
+        /// Number of failed tries so far.
+        uint8_t attempts;
+        /// true if we should try stream transport.
+        bool use_stream;
+        /// Start address for restore.
+        uint32_t address;
+        /// Data to write for restore.
+        string data;
+    };
+
+    Action entry() override;
+
+    /// Called when all the jobs are done.
+    Action all_done();
+
+    /// Starts idle sessions while there are runnable jobs and the concurrency
+    /// limit allows.
+    void fill_sessions();
+
+    /// Takes the next job that can run now.
+    /// @param job will be filled in.
+    /// @return false if there is no such job, or we are over the concurrency
+    /// limit.
+    bool take_job(Job *job);
+
+    /// Called by a session when it finished a job.
+    /// @param job the job that was executed
+    /// @param result is the memory config client request with the results.
+    /// @param nsec how long the job took.
+    void job_done(Job *job, MemoryConfigClientRequest *result, long long nsec);
+
+    /// @return true if a session is talking to a given node.
+    /// @param node the node to look for.
+    bool node_busy(const NodeHandle &node);
+
+    /// Local node.
+    Node *node_;
+    /// Parallel sessions.
+    std::vector<std::unique_ptr<Session>> sessions_;
+    /// Jobs not yet started (or waiting for a retry).
+    std::deque<Job> pending_;
+    /// Number of jobs not completed yet.
+    unsigned remaining_ {0};
+    /// How many sessions are executing a job.
+    unsigned active_ {0};
+    /// Maximum value of active_ in the current request.
+    unsigned peakActive_ {0};
+    /// Current limit of parallel sessions.
+    unsigned limit_ {1};
+    /// Maximum number of parallel sessions.
+    unsigned maxConcurrency_;
+    /// true if we should try reading with stream transport.
+    bool useStream_;
+    /// Error code of the last failed job.
+    int lastError_ {0};
+    /// Best transfer time per byte seen (nsec), for datagram [0] and stream
+    /// [1] transfers.
+    long long bestNsecPerByte_[2];
+};
+
+} // namespace openlcb
+
+#endif // _OPENLCB_MEMORYCONFIGBACKUP_HXX_
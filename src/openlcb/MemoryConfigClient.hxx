@@ -353,7 +353,7 @@ private:
     {
         dgClient_ = full_allocation_result(dg_service()->client_allocator());
         offset_ = request()->address;
-        memoryConfigHandler_->set_client(&responseFlow_);
+        memoryConfigHandler_->set_client(&responseFlow_, request()->dst);
         return call_immediately(STATE(send_next_read));
     }
 
@@ -494,7 +494,7 @@ private:
         dgClient_ = full_allocation_result(dg_service()->client_allocator());
         offset_ = request()->address;
         payloadOffset_ = 0;
-        memoryConfigHandler_->set_client(&responseFlow_);
+        memoryConfigHandler_->set_client(&responseFlow_, request()->dst);
         return call_immediately(STATE(send_next_write));
     }
 
@@ -876,7 +876,7 @@ protected:
     Action do_stream_read()
     {
         dgClient_ = full_allocation_result(dg_service()->client_allocator());
-        memoryConfigHandler_->set_client(&responseFlow_);
+        memoryConfigHandler_->set_client(&responseFlow_, request()->dst);
         {
             // Opens the stream receiver.
             receiver_->pool()->alloc(&streamRecvRequest_);
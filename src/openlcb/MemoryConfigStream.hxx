@@ -222,6 +222,11 @@ private:
     Action done_stream()
     {
         senderCan_->clear();
+        if (srcStreamId_ != StreamDefs::INVALID_STREAM_ID)
+        {
+            // Otherwise we run out of stream IDs after a few reads.
+            stream_transport()->release_send_stream_id(srcStreamId_);
+        }
         stream_transport()->sender_allocator()->typed_insert(sender_);
         sender_ = nullptr;
         return delete_this();
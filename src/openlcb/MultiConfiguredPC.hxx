@@ -165,10 +165,38 @@ public:
         return this;
     }
 
+    /// Switches to change-notification mode. Instead of walking all pins at
+    /// every tick, the pins are only looked at after input_changed() is
+    /// called, and then at every tick until all debouncers have settled. Use
+    /// this instead of adding polling() to the loop.
+    ///
+    /// @param loop refresh loop to use for polling.
+    void attach_on_change(RefreshLoop *loop)
+    {
+        loop_ = loop;
+        loop->add_member(this, RefreshLoop::ON_CHANGE);
+    }
+
+    /// Call when any of the input pins may have changed, e.g. from the GPIO
+    /// driver's change notification. Requires attach_on_change().
+    void input_changed()
+    {
+        loop_->wakeup(this);
+    }
+
+#if OPENMRN_FEATURE_RTOS_FROM_ISR
+    /// Same as input_changed(), to be called from an interrupt handler.
+    void input_changed_from_isr()
+    {
+        loop_->wakeup_from_isr(this);
+    }
+#endif // OPENMRN_FEATURE_RTOS_FROM_ISR
+
     /// Call from the refresh loop.
     void poll_33hz(WriteHelper *helper, Notifiable *done) override
     {
         nextPinToPoll_ = 0;
+        unsettled_ = false;
         pollingHelper_ = helper;
         pollingDone_ = done;
         this->notify();
@@ -185,7 +213,8 @@ public:
             {
                 continue;
             }
-            if (debouncers_[i].update_state(pins_[i]->is_set()))
+            bool value = pins_[i]->is_set();
+            if (debouncers_[i].update_state(value))
             {
                 // Pin flipped.
                 ++nextPinToPoll_; // avoid infinite loop.
@@ -195,6 +224,15 @@ public:
                     WriteHelper::global(), eventid_to_buffer(event), this);
                 return;
             }
+            if (value != debouncers_[i].current_state())
+            {
+                unsettled_ = true;
+            }
+        }
+        if (loop_ && unsettled_)
+        {
+            // Some debouncer is still counting; we need to see the pins again.
+            loop_->request_tick(this);
         }
         pollingDone_->notify();
     }
@@ -387,6 +425,12 @@ private:
     WriteHelper *pollingHelper_;
     /// Notifiable to call when the polling loop is done.
     Notifiable *pollingDone_;
+    /// Refresh loop if we are in change-notification mode, nullptr if polled
+    /// periodically.
+    RefreshLoop *loop_ {nullptr};
+    /// True if some input pin seen in this polling pass is still being
+    /// debounced.
+    bool unsettled_;
 
     /// virtual node to export the consumer / producer on.
     Node *node_;
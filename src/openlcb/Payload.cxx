@@ -0,0 +1,97 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file Payload.cxx
+ * Out-of-line parts of the OpenLCB message payload class.
+ *
+ * @author Balazs Racz
+ * @date 17 Oct 2026
+ */
+
+#include "openlcb/Payload.hxx"
+
+#include "utils/DataBuffer.hxx"
+
+namespace openlcb
+{
+
+constexpr Payload::size_type Payload::npos;
+constexpr unsigned Payload::INLINE_SIZE;
+constexpr unsigned Payload::MIN_EXTERNAL_SIZE;
+constexpr unsigned Payload::MAX_SIZE;
+
+/// Sizes of the external buffers (including the terminating zero). The first
+/// one fits the largest datagram.
+static constexpr uint16_t EXTERNAL_SIZES[] = {Payload::MIN_EXTERNAL_SIZE + 1,
+    128, 256, 512, 1024, 2048, 4096, 8192, 16384, Payload::MAX_SIZE + 1};
+
+/// @return the pool for the external buffers of a given size. The memory
+/// comes from the mainBufferPool. The pools are constructed on first use, so
+/// that payloads are usable from static initializers.
+/// @param i index into EXTERNAL_SIZES.
+static DataBufferPool *payload_pool(unsigned i)
+{
+    static DataBufferPool pools[] = {EXTERNAL_SIZES[0], EXTERNAL_SIZES[1],
+        EXTERNAL_SIZES[2], EXTERNAL_SIZES[3], EXTERNAL_SIZES[4],
+        EXTERNAL_SIZES[5], EXTERNAL_SIZES[6], EXTERNAL_SIZES[7],
+        EXTERNAL_SIZES[8], EXTERNAL_SIZES[9]};
+    static_assert(ARRAYSIZE(EXTERNAL_SIZES) == ARRAYSIZE(pools),
+        "Payload pool table mismatch");
+    return &pools[i];
+}
+
+void Payload::grow(size_type n)
+{
+    // Payload is too long.
+    HASSERT(n <= MAX_SIZE);
+    // Grows geometrically to make repeated appends cheap.
+    n = std::min<size_type>(std::max<size_type>(n, 2 * capacity()), MAX_SIZE);
+    unsigned i = 0;
+    while (EXTERNAL_SIZES[i] <= n)
+    {
+        ++i;
+    }
+    init_main_buffer_pool();
+    DataBuffer *b;
+    payload_pool(i)->alloc(&b);
+    HASSERT(b);
+    char *p = (char *)b->data();
+    memcpy(p, data(), size_ + 1);
+    if (capacity_)
+    {
+        free_external();
+    }
+    ext_.ptr = p;
+    ext_.buf = b;
+    capacity_ = EXTERNAL_SIZES[i] - 1;
+}
+
+void Payload::free_external()
+{
+    ext_.buf->unref();
+}
+
+} // namespace openlcb
@@ -26,8 +26,7 @@
  *
  * \file Payload.hxx
  *
- * Forward declaration of the class storing the payload value in an NMRAnet
- * message object.
+ * Class storing the payload value in an NMRAnet message object.
  *
  * @author Balazs Racz
  * @date 18 May 2014
@@ -36,11 +35,620 @@
 #ifndef _OPENLCB_PAYLOAD_HXX_
 #define _OPENLCB_PAYLOAD_HXX_
 
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
 #include <string>
+#include <type_traits>
+
+#include "utils/macros.h"
+
+class DataBuffer;
 
 namespace openlcb {
 
-typedef string Payload;
+/// Byte string holding the body of an OpenLCB message.
+///
+/// The interface is a subset of std::string, so code written for the payload
+/// being a string keeps working. Payloads up to INLINE_SIZE bytes (event IDs,
+/// node IDs, traction commands, most addressed messages) are stored in the
+/// object itself. Longer payloads (e.g. datagrams) go into a DataBuffer
+/// allocated from the mainBufferPool, which keeps freed buffers on its
+/// freelists, so steady state traffic does not call malloc.
+///
+/// A payload holds at most MAX_SIZE bytes; growing it beyond that fails with
+/// HASSERT.
+class Payload
+{
+public:
+    typedef size_t size_type;
+    typedef char value_type;
+    typedef char &reference;
+    typedef const char &const_reference;
+    typedef char *iterator;
+    typedef const char *const_iterator;
+    /// Same as string::npos.
+    static constexpr size_type npos = std::string::npos;
+    /// This many bytes are stored without an external buffer.
+    static constexpr unsigned INLINE_SIZE = 16;
+    /// External buffers are at least this big. This is the largest datagram,
+    /// which makes the CAN datagram assembly not reallocate.
+    static constexpr unsigned MIN_EXTERNAL_SIZE = 72;
+    /// Largest number of bytes a payload can hold.
+    static constexpr unsigned MAX_SIZE = 32767;
+
+    Payload()
+        : size_(0)
+        , capacity_(0)
+    {
+        inline_[0] = 0;
+    }
+
+    Payload(const char *s)
+        : Payload()
+    {
+        append(s, strlen(s));
+    }
+
+    Payload(const char *s, size_type n)
+        : Payload()
+    {
+        append(s, n);
+    }
+
+    Payload(size_type n, char c)
+        : Payload()
+    {
+        append(n, c);
+    }
+
+    Payload(const std::string &s)
+        : Payload()
+    {
+        append(s.data(), s.size());
+    }
+
+    /// Constructs from an iterator range.
+    template <class It,
+        typename std::enable_if<!std::is_integral<It>::value, int>::type = 0>
+    Payload(It first, It last)
+        : Payload()
+    {
+        for (; first != last; ++first)
+        {
+            push_back(*first);
+        }
+    }
+
+    Payload(const Payload &o)
+        : Payload()
+    {
+        append(o.data(), o.size());
+    }
+
+    Payload(Payload &&o)
+        : Payload()
+    {
+        take(&o);
+    }
+
+    ~Payload()
+    {
+        if (capacity_)
+        {
+            free_external();
+        }
+    }
+
+    Payload &operator=(const Payload &o)
+    {
+        if (&o != this)
+        {
+            assign(o.data(), o.size());
+        }
+        return *this;
+    }
+
+    Payload &operator=(Payload &&o)
+    {
+        if (&o != this)
+        {
+            clear_and_free();
+            take(&o);
+        }
+        return *this;
+    }
+
+    Payload &operator=(const std::string &s)
+    {
+        return assign(s.data(), s.size());
+    }
+
+    Payload &operator=(const char *s)
+    {
+        return assign(s, strlen(s));
+    }
+
+    /// @return a copy of the payload as a string.
+    operator std::string() const
+    {
+        return std::string(data(), size());
+    }
+
+    size_type size() const
+    {
+        return size_;
+    }
+
+    size_type length() const
+    {
+        return size_;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    /// @return how many bytes can be stored without reallocating.
+    size_type capacity() const
+    {
+        return capacity_ ? capacity_ : INLINE_SIZE;
+    }
+
+    const char *data() const
+    {
+        return capacity_ ? ext_.ptr : inline_;
+    }
+
+    char *data()
+    {
+        return capacity_ ? ext_.ptr : inline_;
+    }
+
+    /// @return the data, followed by a terminating zero.
+    const char *c_str() const
+    {
+        return data();
+    }
+
+    char &operator[](size_type i)
+    {
+        return data()[i];
+    }
+
+    const char &operator[](size_type i) const
+    {
+        return data()[i];
+    }
+
+    char &at(size_type i)
+    {
+        HASSERT(i < size_);
+        return data()[i];
+    }
+
+    const char &at(size_type i) const
+    {
+        HASSERT(i < size_);
+        return data()[i];
+    }
+
+    char &back()
+    {
+        return data()[size_ - 1];
+    }
+
+    const char &back() const
+    {
+        return data()[size_ - 1];
+    }
+
+    iterator begin()
+    {
+        return data();
+    }
+
+    iterator end()
+    {
+        return data() + size_;
+    }
+
+    const_iterator begin() const
+    {
+        return data();
+    }
+
+    const_iterator end() const
+    {
+        return data() + size_;
+    }
+
+    void clear()
+    {
+        set_size(0);
+    }
+
+    /// Makes sure that n bytes can be stored without reallocation. n must not
+    /// be more than MAX_SIZE.
+    void reserve(size_type n)
+    {
+        if (n > capacity())
+        {
+            grow(n);
+        }
+    }
+
+    /// Changes the size, filling new bytes with c.
+    void resize(size_type n, char c = 0)
+    {
+        if (n > size_)
+        {
+            append(n - size_, c);
+        }
+        else
+        {
+            set_size(n);
+        }
+    }
+
+    /// Appends n bytes from s. s may point into this payload.
+    Payload &append(const char *s, size_type n)
+    {
+        if (size_ + n > capacity())
+        {
+            // Growing frees the old buffer, which s might be pointing into.
+            bool self = points_into(s);
+            size_type ofs = self ? s - data() : 0;
+            grow(size_ + n);
+            if (self)
+            {
+                s = data() + ofs;
+            }
+        }
+        memmove(data() + size_, s, n);
+        set_size(size_ + n);
+        return *this;
+    }
+
+    Payload &append(const char *s)
+    {
+        return append(s, strlen(s));
+    }
+
+    Payload &append(size_type n, char c)
+    {
+        reserve(size_ + n);
+        memset(data() + size_, c, n);
+        set_size(size_ + n);
+        return *this;
+    }
+
+    Payload &append(const std::string &s)
+    {
+        return append(s.data(), s.size());
+    }
+
+    Payload &append(const Payload &s)
+    {
+        return append(s.data(), s.size());
+    }
+
+    /// Appends the substring [pos, pos + n) of s.
+    Payload &append(const std::string &s, size_type pos, size_type n = npos)
+    {
+        HASSERT(pos <= s.size());
+        return append(s.data() + pos, std::min(n, s.size() - pos));
+    }
+
+    Payload &append(const Payload &s, size_type pos, size_type n = npos)
+    {
+        HASSERT(pos <= s.size());
+        return append(s.data() + pos, std::min(n, s.size() - pos));
+    }
+
+    void push_back(char c)
+    {
+        if (size_ >= capacity())
+        {
+            grow(size_ + 1);
+        }
+        data()[size_] = c;
+        set_size(size_ + 1);
+    }
+
+    void pop_back()
+    {
+        set_size(size_ - 1);
+    }
+
+    Payload &operator+=(char c)
+    {
+        push_back(c);
+        return *this;
+    }
+
+    Payload &operator+=(const char *s)
+    {
+        return append(s);
+    }
+
+    Payload &operator+=(const std::string &s)
+    {
+        return append(s);
+    }
+
+    Payload &operator+=(const Payload &s)
+    {
+        return append(s);
+    }
+
+    Payload &assign(const char *s, size_type n)
+    {
+        if (n > capacity())
+        {
+            // Avoids copying the old content when growing.
+            clear();
+        }
+        reserve(n);
+        memmove(data(), s, n);
+        set_size(n);
+        return *this;
+    }
+
+    Payload &assign(const std::string &s)
+    {
+        return assign(s.data(), s.size());
+    }
+
+    Payload &assign(size_type n, char c)
+    {
+        clear();
+        return append(n, c);
+    }
+
+    /// Assigns from an iterator range.
+    template <class It,
+        typename std::enable_if<!std::is_integral<It>::value, int>::type = 0>
+    Payload &assign(It first, It last)
+    {
+        clear();
+        for (; first != last; ++first)
+        {
+            push_back(*first);
+        }
+        return *this;
+    }
+
+    /// Removes n bytes starting at pos. pos must not be past the end.
+    Payload &erase(size_type pos = 0, size_type n = npos)
+    {
+        HASSERT(pos <= size_);
+        n = std::min(n, size_ - pos);
+        memmove(data() + pos, data() + pos + n, size_ - pos - n);
+        set_size(size_ - n);
+        return *this;
+    }
+
+    /// Inserts n bytes from s at pos. s may point into this payload.
+    Payload &insert(size_type pos, const char *s, size_type n)
+    {
+        HASSERT(pos <= size_);
+        if (points_into(s))
+        {
+            Payload copy(s, n);
+            return insert(pos, copy.data(), n);
+        }
+        Payload tail(data() + pos, size_ - pos);
+        set_size(pos);
+        append(s, n);
+        return append(tail);
+    }
+
+    /// @return the first position at or after pos that holds c, or npos.
+    size_type find(char c, size_type pos = 0) const
+    {
+        if (pos >= size_)
+        {
+            return npos;
+        }
+        const void *p = memchr(data() + pos, c, size_ - pos);
+        return p ? (const char *)p - data() : npos;
+    }
+
+    /// @return a copy of the bytes [pos, pos + n).
+    Payload substr(size_type pos = 0, size_type n = npos) const
+    {
+        HASSERT(pos <= size_);
+        return Payload(data() + pos, std::min(n, size_ - pos));
+    }
+
+    /// Compares the contents like string::compare does.
+    int compare(const char *s, size_type n) const
+    {
+        int r = memcmp(data(), s, std::min<size_type>(size_, n));
+        if (r)
+        {
+            return r;
+        }
+        return size_ < n ? -1 : (size_ > n ? 1 : 0);
+    }
+
+    int compare(const Payload &o) const
+    {
+        return compare(o.data(), o.size());
+    }
+
+    int compare(const std::string &o) const
+    {
+        return compare(o.data(), o.size());
+    }
+
+    void swap(Payload &o)
+    {
+        Payload tmp(std::move(o));
+        o = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+    /// Exchanges the contents with a string. This copies the bytes.
+    void swap(std::string &o)
+    {
+        Payload tmp(o);
+        o.assign(data(), size());
+        *this = std::move(tmp);
+    }
+
+private:
+    /// @return true if p points into the storage of this payload.
+    bool points_into(const char *p) const
+    {
+        std::less<const char *> lt;
+        return !lt(p, data()) && lt(p, data() + capacity() + 1);
+    }
+
+    /// Sets the size and the terminating zero. @param n new size.
+    void set_size(size_type n)
+    {
+        size_ = n;
+        data()[n] = 0;
+    }
+
+    /// Moves the contents of o to *this, which must be empty inline.
+    void take(Payload *o)
+    {
+        if (o->capacity_)
+        {
+            ext_ = o->ext_;
+            capacity_ = o->capacity_;
+            size_ = o->size_;
+            o->capacity_ = 0;
+            o->set_size(0);
+        }
+        else
+        {
+            memcpy(inline_, o->inline_, o->size_ + 1);
+            size_ = o->size_;
+            o->set_size(0);
+        }
+    }
+
+    /// Releases the external buffer, leaving *this empty.
+    void clear_and_free()
+    {
+        if (capacity_)
+        {
+            free_external();
+            capacity_ = 0;
+        }
+        set_size(0);
+    }
+
+    /// Reallocates to an external buffer that fits at least n bytes.
+    void grow(size_type n);
+
+    /// Releases the external buffer.
+    void free_external();
+
+    /// External storage.
+    struct External
+    {
+        /// Bytes of the payload.
+        char *ptr;
+        /// Buffer that owns ptr.
+        DataBuffer *buf;
+    };
+
+    union
+    {
+        /// Inline storage, used when capacity_ == 0.
+        char inline_[INLINE_SIZE + 1];
+        /// External storage, used when capacity_ != 0.
+        External ext_;
+    };
+    /// Number of bytes in the payload.
+    uint16_t size_;
+    /// Number of bytes usable in the external buffer (not counting the
+    /// terminating zero), or 0 if the payload is inline.
+    uint16_t capacity_;
+};
+
+inline bool operator==(const Payload &a, const Payload &b)
+{
+    return a.compare(b) == 0;
+}
+
+inline bool operator==(const Payload &a, const std::string &b)
+{
+    return a.compare(b) == 0;
+}
+
+inline bool operator==(const std::string &a, const Payload &b)
+{
+    return b.compare(a) == 0;
+}
+
+inline bool operator==(const Payload &a, const char *b)
+{
+    return a.compare(b, strlen(b)) == 0;
+}
+
+inline bool operator==(const char *a, const Payload &b)
+{
+    return b.compare(a, strlen(a)) == 0;
+}
+
+inline bool operator!=(const Payload &a, const Payload &b)
+{
+    return !(a == b);
+}
+
+inline bool operator!=(const Payload &a, const std::string &b)
+{
+    return !(a == b);
+}
+
+inline bool operator!=(const std::string &a, const Payload &b)
+{
+    return !(a == b);
+}
+
+inline bool operator!=(const Payload &a, const char *b)
+{
+    return !(a == b);
+}
+
+inline bool operator!=(const char *a, const Payload &b)
+{
+    return !(a == b);
+}
+
+inline bool operator<(const Payload &a, const Payload &b)
+{
+    return a.compare(b) < 0;
+}
+
+inline std::string operator+(const std::string &a, const Payload &b)
+{
+    std::string ret(a);
+    ret.append(b.data(), b.size());
+    return ret;
+}
+
+inline std::string operator+(const char *a, const Payload &b)
+{
+    std::string ret(a);
+    ret.append(b.data(), b.size());
+    return ret;
+}
+
+inline Payload operator+(const Payload &a, const Payload &b)
+{
+    Payload ret(a);
+    ret.append(b);
+    return ret;
+}
 
 } // namespace openlcb
 
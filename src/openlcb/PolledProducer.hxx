@@ -68,9 +68,43 @@ public:
         debouncer_.override(new_value);
     }
 
+    /// Switches this producer to change-notification mode. The producer is
+    /// added to the loop as an ON_CHANGE member; it will be polled after
+    /// input_changed() is called, and then at every tick until the debouncer
+    /// settles. Do not also add this object to the loop as a PERIODIC member.
+    ///
+    /// @param loop refresh loop to use for polling.
+    void attach_on_change(RefreshLoop *loop)
+    {
+        loop_ = loop;
+        loop->add_member(this, RefreshLoop::ON_CHANGE);
+    }
+
+    /// Call when the input may have changed, e.g. from the GPIO driver's
+    /// change notification. Requires attach_on_change() to have been called.
+    void input_changed()
+    {
+        loop_->wakeup(this);
+    }
+
+#if OPENMRN_FEATURE_RTOS_FROM_ISR
+    /// Same as input_changed(), to be called from an interrupt handler.
+    void input_changed_from_isr()
+    {
+        loop_->wakeup_from_isr(this);
+    }
+#endif // OPENMRN_FEATURE_RTOS_FROM_ISR
+
     void poll_33hz(WriteHelper *helper, Notifiable *done) OVERRIDE
     {
-        if (debouncer_.update_state(BaseBit::get_current_state() == EventState::VALID))
+        bool hw_state = BaseBit::get_current_state() == EventState::VALID;
+        bool flipped = debouncer_.update_state(hw_state);
+        if (loop_ && hw_state != debouncer_.current_state())
+        {
+            // Debouncing is in progress, we need to see the input again.
+            loop_->request_tick(this);
+        }
+        if (flipped)
         {
             producer_.SendEventReport(helper, done);
         }
@@ -81,6 +115,9 @@ public:
     }
 
 private:
+    /// Refresh loop if we are in change-notification mode, nullptr if polled
+    /// periodically.
+    RefreshLoop *loop_ {nullptr};
     Debouncer debouncer_;
     BitEventProducer producer_;
 };
@@ -59,9 +59,26 @@ public:
 /// Usage: Instantiate your objects from descendants of the Polling
 /// class. Create a RefreshLoop object and pass in the list of Polling object
 /// pointers to the constructor.
+///
+/// Members can also be added in ON_CHANGE mode. These are not polled
+/// periodically; instead they are called when someone (typically the GPIO
+/// interrupt handler of the input they watch) calls @ref wakeup(). A member
+/// that needs a few more calls to settle (e.g. a debouncer that has seen a
+/// change) can call @ref request_tick() from its poll_33hz to be called again
+/// at the next 30 msec tick. When there are no PERIODIC members and no tick
+/// requests outstanding, the loop does not wake up at all.
 class RefreshLoop : public StateFlowBase, private Atomic
 {
 public:
+    /// How a member should be called by the refresh loop.
+    enum PollMode
+    {
+        /// Member is called at every tick (approximately 33 Hz).
+        PERIODIC,
+        /// Member is called only after @ref wakeup() or @ref request_tick().
+        ON_CHANGE
+    };
+
     /// Constructor
     ///
     /// @param node openlcb Node whose interface/executor we will be using for
@@ -74,8 +91,13 @@ public:
         : StateFlowBase(node->iface())
         , timer_(this)
         , lastTimeout_(os_get_time_monotonic())
-        , members_(members.begin(), members.end())
+        , kicker_(this)
     {
+        for (Polling *p : members)
+        {
+            members_.emplace_back(p, PERIODIC);
+        }
+        numPeriodic_ = members_.size();
         start_flow(STATE(wait_for_tick));
     }
 
@@ -92,21 +114,117 @@ public:
     /// @param new_member the member to be polled. The object ownership is
     /// retained by the caller. The object must outlive this RefreshLoop
     /// object.
-    void add_member(Polling *new_member)
+    /// @param mode whether the member needs periodic polling or will only be
+    /// called after a @ref wakeup().
+    void add_member(Polling *new_member, PollMode mode = PERIODIC)
+    {
+        AtomicHolder h(this);
+        members_.emplace_back(new_member, mode);
+        if (mode == PERIODIC)
+        {
+            ++numPeriodic_;
+            kick_locked();
+        }
+    }
+
+    /// Requests a member to be called as soon as possible. May be called from
+    /// any thread.
+    ///
+    /// @param member a member previously added to this loop.
+    void wakeup(Polling *member)
+    {
+        AtomicHolder h(this);
+        find_member(member)->dirty_ = 1;
+        pending_ = true;
+        kick_locked();
+    }
+
+#if OPENMRN_FEATURE_RTOS_FROM_ISR
+    /// Requests a member to be called as soon as possible. Must be called from
+    /// a kernel-compatible interrupt handler. Since these interrupts are
+    /// masked while the Atomic is held, no locking is needed here.
+    ///
+    /// @param member a member previously added to this loop.
+    void wakeup_from_isr(Polling *member)
+    {
+        find_member(member)->dirty_ = 1;
+        pending_ = true;
+        if (!kickPending_)
+        {
+            kickPending_ = true;
+            service()->executor()->add_from_isr(&kicker_, 0);
+        }
+    }
+#endif // OPENMRN_FEATURE_RTOS_FROM_ISR
+
+    /// Requests a member to be called again at the next tick. Typically
+    /// called by an ON_CHANGE member from its poll_33hz while it is
+    /// debouncing an input. May be called from any thread.
+    ///
+    /// @param member a member previously added to this loop.
+    void request_tick(Polling *member)
     {
         AtomicHolder h(this);
-        members_.push_back(new_member);
+        find_member(member)->tickRequest_ = 1;
+        if (!tickRequested_)
+        {
+            tickRequested_ = true;
+            kick_locked();
+        }
     }
 
     /// State which gets called after the loop is complete. Initializes the
     /// next loop and sleeps until it's time to go.
     Action wait_for_tick()
     {
-        lastTimeout_ += MSEC_TO_NSEC(30);
-        nextMember_ = 0;
+        {
+            AtomicHolder h(this);
+            if (pending_)
+            {
+                loopState_ = RUNNING;
+                return call_immediately(STATE(start_pass));
+            }
+            if (!numPeriodic_ && !tickRequested_)
+            {
+                // Nothing to do until someone calls wakeup.
+                loopState_ = IDLE;
+                lastTimeout_ = -1;
+                return wait_and_call(STATE(start_pass));
+            }
+            loopState_ = SLEEPING;
+        }
+        if (lastTimeout_ < 0)
+        {
+            // Coming out of idle: restarts the tick clock.
+            lastTimeout_ = os_get_time_monotonic() + MSEC_TO_NSEC(30);
+        }
         // If we have overflowed our timer, this call will happen immediately.
         return sleep_and_call(&timer_, lastTimeout_ - os_get_time_monotonic(),
-                              STATE(call_members));
+                              STATE(start_pass));
+    }
+
+    /// Decides whether this pass is a tick (calls the periodic members) or
+    /// only serves wakeups.
+    Action start_pass()
+    {
+        loopState_ = RUNNING;
+        long long now = os_get_time_monotonic();
+        {
+            AtomicHolder h(this);
+            pending_ = false;
+            isTick_ = lastTimeout_ >= 0 && now >= lastTimeout_ &&
+                (numPeriodic_ || tickRequested_);
+            if (isTick_)
+            {
+                tickRequested_ = false;
+            }
+        }
+        if (isTick_)
+        {
+            lastTimeout_ += MSEC_TO_NSEC(30);
+        }
+        nextMember_ = 0;
+        return call_immediately(STATE(call_members));
     }
 
     Action call_members()
@@ -116,11 +234,26 @@ public:
             Polling* member = nullptr;
             {
                 AtomicHolder h(this);
+                for (; nextMember_ < members_.size(); ++nextMember_)
+                {
+                    Member &m = members_[nextMember_];
+                    if (m.dirty_ ||
+                        (isTick_ && (m.periodic_ || m.tickRequest_)))
+                    {
+                        break;
+                    }
+                }
                 if (nextMember_ >= members_.size())
                 {
                     return call_immediately(STATE(wait_for_tick));
                 }
-                member = members_[nextMember_];
+                Member &m = members_[nextMember_];
+                m.dirty_ = 0;
+                if (isTick_)
+                {
+                    m.tickRequest_ = 0;
+                }
+                member = m.member_;
                 ++nextMember_;
             }
             bn_.reset(this);
@@ -137,20 +270,151 @@ public:
     }
 
 private:
+    /// Executable that gets the loop out of its sleep when a wakeup comes in
+    /// from a different thread or an interrupt.
+    class Kicker : public Executable
+    {
+    public:
+        /// @param parent the refresh loop that owns *this.
+        Kicker(RefreshLoop *parent)
+            : parent_(parent)
+        {
+        }
+
+        /// Called on the loop's executor.
+        void run() override
+        {
+            parent_->kick();
+        }
+
+    private:
+        /// Owning refresh loop.
+        RefreshLoop *parent_;
+    };
+
+    /// What the state flow is currently doing. Only accessed on the executor.
+    enum LoopState
+    {
+        /// Calling members.
+        RUNNING,
+        /// Sleeping on timer_ for the next tick.
+        SLEEPING,
+        /// Waiting for a notify, no timer.
+        IDLE
+    };
+
+    /// Registration of one polling member.
+    struct Member
+    {
+        /// @param m the member. @param mode how to poll it.
+        Member(Polling *m, PollMode mode)
+            : member_(m)
+            , periodic_(mode == PERIODIC ? 1 : 0)
+            , dirty_(0)
+            , tickRequest_(0)
+        {
+        }
+        /// Object to call.
+        Polling *member_;
+        /// 1 if this member is called at every tick.
+        uint8_t periodic_ : 1;
+        /// 1 if a wakeup was requested for this member.
+        uint8_t dirty_ : 1;
+        /// 1 if this member is to be called at the next tick.
+        uint8_t tickRequest_ : 1;
+    };
+
+    /// Looks up the registration of a member. Must be called with the Atomic
+    /// held. @param p the member to find. @return the registration entry.
+    Member *find_member(Polling *p)
+    {
+        for (Member &m : members_)
+        {
+            if (m.member_ == p)
+            {
+                return &m;
+            }
+        }
+        DIE("Polling object is not a member of this RefreshLoop.");
+    }
+
+    /// Schedules the kicker on the executor, unless it is already pending.
+    /// Must be called with the Atomic held.
+    void kick_locked()
+    {
+        if (!kickPending_)
+        {
+            kickPending_ = true;
+            service()->executor()->add(&kicker_);
+        }
+    }
+
+    /// Called on the executor by the kicker. Gets the state flow out of
+    /// sleep.
+    void kick()
+    {
+        {
+            AtomicHolder h(this);
+            kickPending_ = false;
+        }
+        if (is_terminated())
+        {
+            return;
+        }
+        switch (loopState_)
+        {
+            case SLEEPING:
+            {
+                AtomicHolder h(this);
+                if (!pending_)
+                {
+                    // A new tick request or periodic member; the timer is
+                    // already running for that.
+                    break;
+                }
+                timer_.ensure_triggered();
+                loopState_ = RUNNING;
+                break;
+            }
+            case IDLE:
+                loopState_ = RUNNING;
+                notify();
+                break;
+            case RUNNING:
+                // wait_for_tick will look at the flags.
+                break;
+        }
+    }
+
     /// Message write buffer that is passed to each polling object.
     WriteHelper helper_;
     /// Helper object for sleeps.
     StateFlowTimer timer_;
-    /// Rolling clock of when the next wakeup should happen.
+    /// Rolling clock of when the next wakeup should happen. -1 when the loop
+    /// is idle.
     long long lastTimeout_;
     /// Controllable notifier to be passed into the polling objects.
     BarrierNotifiable bn_;
+    /// Wakes up the loop from other threads.
+    Kicker kicker_;
     /// Data structure type for storing the polling members.
-    typedef vector<Polling*> members_type;
+    typedef vector<Member> members_type;
     /// The actual members.
     members_type members_;
     /// Index for iterating through the members list.
     unsigned nextMember_;
+    /// Number of PERIODIC entries in members_.
+    unsigned numPeriodic_ {0};
+    /// What the state flow is doing.
+    LoopState loopState_ {RUNNING};
+    /// True if some member has its dirty_ bit set.
+    bool pending_ {false};
+    /// True if some member has its tickRequest_ bit set.
+    bool tickRequested_ {false};
+    /// True if the kicker is on the executor queue.
+    bool kickPending_ {false};
+    /// True if the current pass calls the periodic members.
+    bool isTick_ {false};
 };
 
 } // namespace openlcb
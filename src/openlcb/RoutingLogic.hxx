@@ -36,9 +36,11 @@
 #ifndef _OPENLCB_ROUTNGLOGIC_HXX_
 #define _OPENLCB_ROUTNGLOGIC_HXX_
 
-#include <set>
-#include <map>
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include "os/OS.hxx"
 #include "openlcb/EventHandler.hxx"
@@ -61,15 +63,29 @@ uint8_t event_range_to_bit_count(EventId *event);
  *
  * The routing table contains which direction to send addressed packets as well
  * as filters for the event IDs that have listeners in a given port.
+ *
+ * The event filters are compiled into an immutable snapshot per port: an
+ * open-addressing hash set for the individual events and a sorted table of
+ * disjoint intervals for the ranges. Lookups (check_pcer,
+ * lookup_ports_for_event, has_port) do not take any lock. Registrations take the lock, and publish a new snapshot
+ * RCU-style when the structure changes. Replaced snapshots are freed by the
+ * publisher if no lookup is in progress, otherwise by the last lookup to
+ * finish.
  */
 template <class Port, typename Address> class RoutingLogic
 {
 public:
     RoutingLogic()
+        : snapshot_(new Snapshot)
     {
     }
     ~RoutingLogic()
     {
+        delete snapshot_.load();
+        for (Snapshot *s : retired_)
+        {
+            delete s;
+        }
     }
 
     /** Clears all entries in the routing table related to a given port, as the
@@ -80,7 +96,12 @@ public:
     void remove_port(Port *port)
     {
         OSMutexLock l(&lock_);
-        eventRoutingTable_.erase(port);
+        Snapshot *s = new Snapshot(*snapshot_.load());
+        s->ports_.erase(std::remove_if(s->ports_.begin(), s->ports_.end(),
+                            [port](const PortFilter &f)
+                            { return f.port_ == port; }),
+            s->ports_.end());
+        publish(s);
         // Removing entries from a hashmap invalidates an iterator, thus it is
         // safer to null them out than actually remove. Having a null value
         // will cause address lookup to return null for a node that has not
@@ -95,6 +116,17 @@ public:
         }
     }
 
+    /** Checks whether a port has an event filter. Does not take any lock.
+     *
+     * @param port is the port to query.
+     * @return true if any event registration was called for this port since
+     * it was last removed. */
+    bool has_port(Port *port)
+    {
+        ReadSection r(this);
+        return r.snapshot()->find(port) != nullptr;
+    }
+
     /** Declares that a given node ID is reachable via a specific port. Used
      * with the source node IDs of all the incoming packets.
      *
@@ -133,7 +165,38 @@ public:
     void register_consumer(Port *port, EventId event)
     {
         OSMutexLock l(&lock_);
-        eventRoutingTable_[port].registeredConsumers_[0].insert(event);
+        const Snapshot *current = snapshot_.load();
+        const PortFilter *f = current->find(port);
+        if (f && f->matches(event))
+        {
+            return;
+        }
+        if (event == 0)
+        {
+            // The hash set cannot store zero, so that event is stored as a
+            // single-element range.
+            add_range(port, event, event);
+            return;
+        }
+        if (f && f->exact_->insert(event))
+        {
+            return;
+        }
+        // New port, or the hash set is too full: needs a new snapshot.
+        Snapshot *s = new Snapshot(*current);
+        PortFilter *nf = s->find(port);
+        if (!nf)
+        {
+            nf = add_port(s, port);
+        }
+        else
+        {
+            nf->exact_.reset(
+                new EventHashSet(*nf->exact_, nf->exact_->size() * 2));
+        }
+        bool inserted = nf->exact_->insert(event);
+        HASSERT(inserted);
+        publish(s);
     }
 
     /** Declares that there is a consumer for the given event ID range on the
@@ -146,8 +209,10 @@ public:
     {
         OSMutexLock l(&lock_);
         uint8_t bit_count = event_range_to_bit_count(&encoded_range);
-        eventRoutingTable_[port].registeredConsumers_[bit_count].insert(
-            encoded_range);
+        EventId last = bit_count >= 64
+            ? UINT64_C(0xFFFFFFFFFFFFFFFF)
+            : encoded_range + ((UINT64_C(1) << bit_count) - 1);
+        add_range(port, encoded_range, last);
     }
 
     /** Declares that there is a producer for the given event ID on the given
@@ -177,60 +242,339 @@ public:
     }
 
     /** Checks if a given PCER message should be forwarded to the given port.
+     * Does not take any lock.
      *
      * @param port is the port to query.
      * @param event is the event ID from the PCER message.
      *
      * @return true if the given event has a consumer on the given port. */
     bool check_pcer(Port *port, EventId event)
+    {
+        ReadSection r(this);
+        const PortFilter *f = r.snapshot()->find(port);
+        return f && f->matches(event);
+    }
+
+    /** Collects all ports to which a given PCER message should be forwarded.
+     * Does not take any lock. All ports are checked against the same
+     * snapshot.
+     *
+     * @param event is the event ID from the PCER message.
+     * @param ports will be cleared, then filled with every port that has a
+     * consumer for the given event. */
+    void lookup_ports_for_event(EventId event, std::vector<Port *> *ports)
+    {
+        ports->clear();
+        ReadSection r(this);
+        for (const PortFilter &f : r.snapshot()->ports_)
+        {
+            if (f.matches(event))
+            {
+                ports->push_back(f.port_);
+            }
+        }
+    }
+
+    /// @return the number of replaced snapshots that are not yet freed.
+    size_t num_retired()
     {
         OSMutexLock l(&lock_);
-        auto ip = eventRoutingTable_.find(port);
-        if (ip == eventRoutingTable_.end())
+        return retired_.size();
+    }
+
+private:
+    /// Insert-only open-addressing hash set of event IDs. Lookups may run
+    /// concurrently with a (single) inserter.
+    class EventHashSet
+    {
+    public:
+        /// Constructor. @param size number of slots, must be a power of two.
+        EventHashSet(size_t size)
+            : slots_(new Slot[size])
+            , mask_(size - 1)
         {
-            return false;
+            HASSERT((size & mask_) == 0);
         }
-        for (auto im = ip->second.registeredConsumers_.begin();
-             im != ip->second.registeredConsumers_.end(); ++im)
+
+        /// Creates a copy with a different size. @param other the set to
+        /// copy. @param size number of slots, must be a power of two.
+        EventHashSet(const EventHashSet &other, size_t size)
+            : EventHashSet(size)
         {
-            if (im->first == 0)
+            for (size_t i = 0; i <= other.mask_; ++i)
+            {
+                if (other.slots_[i].used_.load(std::memory_order_acquire))
+                {
+                    insert(other.slots_[i].event_);
+                }
+            }
+        }
+
+        /// @return number of slots.
+        size_t size() const
+        {
+            return mask_ + 1;
+        }
+
+        /// Adds an event to the set. Must not be called concurrently with
+        /// another insert. @param event the event ID, non-zero. @return false
+        /// if the set is too full to take the event.
+        bool insert(EventId event)
+        {
+            if ((count_ + 1) * 2 > size())
+            {
+                return false;
+            }
+            for (size_t i = hash(event);; i = (i + 1) & mask_)
             {
-                if (im->second.find(event) != im->second.end())
+                Slot &s = slots_[i];
+                if (!s.used_.load(std::memory_order_relaxed))
+                {
+                    s.event_ = event;
+                    s.used_.store(1, std::memory_order_release);
+                    ++count_;
                     return true;
+                }
+                if (s.event_ == event)
+                {
+                    return true;
+                }
             }
-            else if (im->first == 64)
+        }
+
+        /// @return true if the event is in the set. @param event the event
+        /// ID.
+        bool contains(EventId event) const
+        {
+            for (size_t i = hash(event);; i = (i + 1) & mask_)
             {
-                if (!im->second.empty())
+                const Slot &s = slots_[i];
+                if (!s.used_.load(std::memory_order_acquire))
+                {
+                    return false;
+                }
+                if (s.event_ == event)
+                {
                     return true;
+                }
+            }
+        }
+
+    private:
+        /// One entry of the hash table. The event is written before used_ is
+        /// set and never changes afterwards.
+        struct Slot
+        {
+            EventId event_ {0};
+            std::atomic<uint8_t> used_ {0};
+        };
+
+        /// @return the first slot to probe for an event. @param event the
+        /// event ID.
+        size_t hash(EventId event) const
+        {
+            return (size_t)((event * UINT64_C(0x9E3779B97F4A7C15)) >> 32) &
+                mask_;
+        }
+
+        /// Hash table entries.
+        std::unique_ptr<Slot[]> slots_;
+        /// Number of slots - 1.
+        size_t mask_;
+        /// Number of used slots. Only accessed by the inserter.
+        size_t count_ {0};
+    };
+
+    /// Closed interval [first, last] of event IDs.
+    struct Range
+    {
+        EventId first;
+        EventId last;
+    };
+
+    /// Compiled event filter of one port.
+    struct PortFilter
+    {
+        /// @return true if the event matches this filter. @param event the
+        /// event ID.
+        bool matches(EventId event) const
+        {
+            auto it = std::upper_bound(ranges_.begin(), ranges_.end(), event,
+                [](EventId e, const Range &r) { return e < r.first; });
+            if (it != ranges_.begin() && (it - 1)->last >= event)
+            {
+                return true;
+            }
+            return exact_->contains(event);
+        }
+
+        /// Which port this filter belongs to.
+        Port *port_;
+        /// Individual events. Shared between snapshots until rehashed.
+        std::shared_ptr<EventHashSet> exact_;
+        /// Disjoint event ranges, sorted by first.
+        std::vector<Range> ranges_;
+    };
+
+    /// Immutable (except for inserts into the hash sets) view of all event
+    /// filters.
+    struct Snapshot
+    {
+        /// @return the filter for a given port or nullptr. @param port the
+        /// port to look up.
+        const PortFilter *find(Port *port) const
+        {
+            for (const PortFilter &f : ports_)
+            {
+                if (f.port_ == port)
+                {
+                    return &f;
+                }
+            }
+            return nullptr;
+        }
+
+        /// @return the filter for a given port or nullptr. @param port the
+        /// port to look up.
+        PortFilter *find(Port *port)
+        {
+            return const_cast<PortFilter *>(
+                static_cast<const Snapshot *>(this)->find(port));
+        }
+
+        /// Per-port filters.
+        std::vector<PortFilter> ports_;
+    };
+
+    /// RAII read-side critical section. While this object exists, the
+    /// snapshot it returns will not be freed.
+    class ReadSection
+    {
+    public:
+        /// Constructor. @param parent the routing table to read.
+        ReadSection(RoutingLogic *parent)
+            : parent_(parent)
+        {
+            parent_->activeReaders_.fetch_add(1);
+            snapshot_ = parent_->snapshot_.load();
+        }
+
+        ~ReadSection()
+        {
+            if (parent_->activeReaders_.fetch_sub(1) == 1 &&
+                parent_->hasRetired_.load())
+            {
+                // Last reader out frees what the writers left behind.
+                OSMutexLock l(&parent_->lock_);
+                parent_->reclaim_locked();
+            }
+        }
+
+        /// @return the current snapshot.
+        const Snapshot *snapshot()
+        {
+            return snapshot_;
+        }
+
+    private:
+        /// Routing table we are reading.
+        RoutingLogic *parent_;
+        /// The snapshot we are using.
+        const Snapshot *snapshot_;
+    };
+
+    /// Adds an event range to a port's filter and publishes the new snapshot.
+    /// Must be called with the lock held. @param port the port. @param first
+    /// the first event of the range. @param last the last event of the range
+    /// (inclusive).
+    void add_range(Port *port, EventId first, EventId last)
+    {
+        Snapshot *s = new Snapshot(*snapshot_.load());
+        PortFilter *f = s->find(port);
+        if (!f)
+        {
+            f = add_port(s, port);
+        }
+        // Merges the new range with all the ranges it overlaps or touches.
+        std::vector<Range> ranges;
+        ranges.reserve(f->ranges_.size() + 1);
+        for (const Range &r : f->ranges_)
+        {
+            if ((r.last != UINT64_C(0xFFFFFFFFFFFFFFFF) &&
+                    r.last + 1 < first) ||
+                (last != UINT64_C(0xFFFFFFFFFFFFFFFF) && last + 1 < r.first))
+            {
+                ranges.push_back(r);
             }
             else
             {
-                EventId masked_range =
-                    event & ~((UINT64_C(1) << im->first) - 1);
-                if (im->second.find(masked_range) != im->second.end())
-                    return true;
+                first = std::min(first, r.first);
+                last = std::max(last, r.last);
             }
         }
-        return false;
+        ranges.insert(std::upper_bound(ranges.begin(), ranges.end(), first,
+                          [](EventId e, const Range &r) { return e < r.first; }),
+            {first, last});
+        f->ranges_ = std::move(ranges);
+        publish(s);
     }
 
-private:
-    /// Protects all internal data structures.
+    /// Adds an empty filter for a port. @param s the snapshot to modify.
+    /// @param port the port to add. @return the new filter.
+    PortFilter *add_port(Snapshot *s, Port *port)
+    {
+        s->ports_.push_back(
+            {port, std::shared_ptr<EventHashSet>(new EventHashSet(MIN_HASH_SIZE)),
+                {}});
+        return &s->ports_.back();
+    }
+
+    /// Replaces the current snapshot. Must be called with the lock held.
+    /// @param s the new snapshot; ownership is transferred.
+    void publish(Snapshot *s)
+    {
+        retired_.push_back(snapshot_.exchange(s));
+        hasRetired_ = true;
+        reclaim_locked();
+    }
+
+    /// Frees the retired snapshots if no reader is active. Must be called
+    /// with the lock held.
+    void reclaim_locked()
+    {
+        // Any reader that could still see a retired snapshot has entered its
+        // read section before that snapshot was exchanged out, so it is still
+        // counted. Readers entering later only see the current snapshot.
+        if (activeReaders_.load() != 0)
+        {
+            return;
+        }
+        for (Snapshot *r : retired_)
+        {
+            delete r;
+        }
+        retired_.clear();
+        hasRetired_ = false;
+    }
+
+    /// Initial number of hash slots for the individual events of a port.
+    static constexpr size_t MIN_HASH_SIZE = 16;
+
+    /// Protects the address table and serializes the writers of the event
+    /// tables.
     OSMutex lock_;
 
     /// Stores all known addresses and which port they route to.
     std::unordered_map<Address, Port *> addressRoutingTable_;
 
-    /// The per-port event information.
-    struct EventSet
-    {
-        /// key: number of bits set in the mask part. Valid values:
-        /// 0..64. Value of 0 means individual event.
-        std::map<uint8_t, std::set<EventId>> registeredConsumers_;
-    };
-
-    /// Stores per-port event information.
-    std::map<Port *, EventSet> eventRoutingTable_;
+    /// Current event filters.
+    std::atomic<Snapshot *> snapshot_;
+    /// How many lookups are running right now.
+    std::atomic<unsigned> activeReaders_ {0};
+    /// Snapshots that were replaced, but might still be used by a reader.
+    std::vector<Snapshot *> retired_;
+    /// True if retired_ is not empty. Lets the readers skip the lock.
+    std::atomic<bool> hasRetired_ {false};
 };
 
 } // namespace openlcb
@@ -55,6 +55,7 @@
 #include "openlcb/StreamTransport.hxx"
 #include "openmrn_features.h"
 #include "utils/HubDeviceSelect.hxx"
+#include "utils/HubDeviceSelectBatch.hxx"
 #include "utils/SocketCan.hxx"
 
 namespace openlcb
@@ -446,7 +447,7 @@ void SimpleCanStackBase::add_socketcan_port_select(
     int s = socketcan_open(device, loopback);
     if (s >= 0)
     {
-        auto *port = new HubDeviceSelect<CanHubFlow>(can_hub(), s);
+        auto *port = new HubDeviceSelectCanBatch(can_hub(), s);
         additionalComponents_.emplace_back(port);
     }
 }
@@ -53,6 +53,7 @@
 #include "openlcb/NodeInitializeFlow.hxx"
 #include "openlcb/ProtocolIdentification.hxx"
 #include "openlcb/SimpleNodeInfo.hxx"
+#include "openlcb/TcpRoutingHub.hxx"
 #include "openlcb/TractionTrain.hxx"
 #include "openlcb/TrainInterface.hxx"
 #include "utils/ActivityLed.hxx"
@@ -376,7 +377,8 @@ public:
     void add_gridconnect_tty(const char *device, Notifiable *on_exit = nullptr);
 #endif
 #if defined(__linux__)
-    /// Adds a CAN bus port with select-based asynchronous driver API.
+    /// Adds a CAN bus port with select-based asynchronous driver API. The
+    /// port reads and writes many frames per system call.
     /// @params device CAN device name, for example: "can0" or "can1"
     /// @params loopback 1 to enable loopback localy to other open references,
     ///                  0 to enable loopback localy to other open references,
@@ -524,8 +526,9 @@ public:
     SimpleTcpStackBase(const openlcb::NodeID node_id);
 
     /// Adds a new link to the TCP interface. It is OK to add more than one
-    /// link, data between different links will be forwarded (without any
-    /// filtering).
+    /// link, data between different links will be forwarded. Addressed
+    /// messages and event reports are routed only to the links that need
+    /// them.
     /// @param fd is the file descriptor (socket) representing the link. Must
     /// be select-capable.
     /// @param on_error will be invoked when the link is closed due to
@@ -584,7 +587,7 @@ private:
         }
         /// This flow is the connection between the stack and the device
         /// drivers.
-        HubFlow tcpHub_;
+        TcpRoutingHub tcpHub_;
         /// Implementation of OpenLCB interface.
         IfTcp ifTcp_;
         /// Datagram service (and clients) matching the interface.
@@ -115,13 +115,15 @@ public:
         dstStreamId_ = dst_stream_id;
         HASSERT(sleeping_ == false);
         HASSERT(requestClose_ == 0);
-        requestInit_ = true;
-        trigger();
         streamFlags_ = 0;
         streamAdditionalFlags_ = 0;
         streamWindowSize_ = StreamDefs::MAX_PAYLOAD;
         streamWindowRemaining_ = 0;
         errorCode_ = 0;
+        startTimeNsec_ = 0;
+        endTimeNsec_ = 0;
+        requestInit_ = true;
+        trigger();
         return *this;
     }
 
@@ -137,7 +139,8 @@ public:
     }
 
     /// Specifies what the source should propose as window size to the
-    /// destination. May be called only after start_stream.
+    /// destination. May be called only after start_stream, on the executor
+    /// of the stream sender, before returning to the executor.
     ///
     /// @param window_size in bytes, what should we propose in the stream
     /// initiate call
@@ -211,6 +214,43 @@ public:
         return dstStreamId_;
     }
 
+    /// @return the window size negotiated with the receiving node.
+    uint16_t get_window_size()
+    {
+        return streamWindowSize_;
+    }
+
+    /// @return how many payload bytes were sent in this stream so far.
+    size_t get_total_byte_count()
+    {
+        return totalByteCount_;
+    }
+
+    /// @return how many CAN frames the sender may have allocated at the same
+    /// time. This is computed from the negotiated window size.
+    unsigned get_max_frames_in_flight()
+    {
+        return maxFramesInFlight_;
+    }
+
+    /// @return the achieved payload throughput in bytes per second, from the
+    /// time the stream was accepted until now, or until the stream was
+    /// closed. 0 if the stream has not started transferring yet.
+    uint32_t get_bytes_per_sec()
+    {
+        if (!startTimeNsec_)
+        {
+            return 0;
+        }
+        long long end = endTimeNsec_ ? endTimeNsec_ : os_get_time_monotonic();
+        long long elapsed = end - startTimeNsec_;
+        if (elapsed <= 0)
+        {
+            return 0;
+        }
+        return (uint32_t)(totalByteCount_ * 1000000000ULL / elapsed);
+    }
+
     /// Start of state machine, called when a buffer of data to send arrives
     /// from the application layer.
     Action entry() override
@@ -355,9 +395,24 @@ private:
                 "accepted stream request.");
         }
         streamWindowRemaining_ = streamWindowSize_;
+        // Allows enough frames in flight to send a whole window without
+        // waiting for the frames to be freed.
+        maxFramesInFlight_ = (streamWindowSize_ +
+                                 MAX_BYTES_PAYLOAD_PER_CAN_FRAME - 1) /
+            MAX_BYTES_PAYLOAD_PER_CAN_FRAME;
+        if (maxFramesInFlight_ < MIN_FRAMES_IN_FLIGHT)
+        {
+            maxFramesInFlight_ = MIN_FRAMES_IN_FLIGHT;
+        }
+        if (maxFramesInFlight_ > MAX_FRAMES_IN_FLIGHT)
+        {
+            maxFramesInFlight_ = MAX_FRAMES_IN_FLIGHT;
+        }
+        canFramePool_.set_entry_count(maxFramesInFlight_);
         node_->iface()->dispatcher()->register_handler(
             &streamProceedHandler_, Defs::MTI_STREAM_PROCEED, Defs::MTI_EXACT);
         state_ = RUNNING;
+        startTimeNsec_ = os_get_time_monotonic();
         return entry();
     }
 
@@ -382,6 +437,9 @@ private:
 
         node_->iface()->addressed_message_write_flow()->send(b);
         state_ = CLOSING;
+        endTimeNsec_ = os_get_time_monotonic();
+        LOG(VERBOSE, "stream closed, %u bytes, %u bytes/sec",
+            (unsigned)totalByteCount_, (unsigned)get_bytes_per_sec());
         return entry();
     }
 
@@ -540,8 +598,14 @@ private:
     /// How many bytes payload we can copy into a single CAN frame.
     static constexpr size_t MAX_BYTES_PAYLOAD_PER_CAN_FRAME = 7;
 
-    /// How many CAN frames should we allocate at a given time.
-    static constexpr size_t MAX_FRAMES_IN_FLIGHT = 4;
+    /// How many CAN frames we allocate at a given time, at least. Also used
+    /// before the window size is known.
+    static constexpr unsigned MIN_FRAMES_IN_FLIGHT = 4;
+
+    /// How many CAN frames we allocate at a given time, at most, even if the
+    /// window is bigger. Keeps a single stream from filling up the output
+    /// queues of the CAN interface.
+    static constexpr unsigned MAX_FRAMES_IN_FLIGHT = 32;
 
     /// How many bytes the allocation of a single CAN frame should be.
     static constexpr size_t CAN_FRAME_ALLOC_SIZE =
@@ -589,10 +653,17 @@ private:
     uint16_t streamWindowRemaining_ {0};
     /// When the stream process fails, this variable contains an error code.
     uint32_t errorCode_ {0};
+    /// Current limit of canFramePool_.
+    unsigned maxFramesInFlight_ {MIN_FRAMES_IN_FLIGHT};
+    /// Monotonic time when the stream was accepted, 0 before that.
+    long long startTimeNsec_ {0};
+    /// Monotonic time when the stream was closed, 0 before that.
+    long long endTimeNsec_ {0};
     /// Source of buffers for outgoing CAN frames. Limtedpool is allocating and
     /// releasing to the mainBufferPool, but blocks when we exceed a certain
-    /// number of allocations until some buffers get freed.
-    LimitedPool canFramePool_ {CAN_FRAME_ALLOC_SIZE, MAX_FRAMES_IN_FLIGHT};
+    /// number of allocations until some buffers get freed. The limit is set
+    /// from the window size when the stream is accepted.
+    LimitedPool canFramePool_ {CAN_FRAME_ALLOC_SIZE, MIN_FRAMES_IN_FLIGHT};
     /// Helper object for timeouts.
     StateFlowTimer timer_ {this};
 };
@@ -0,0 +1,257 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file TcpRoutingHub.hxx
+ *
+ * Hub for OpenLCB-TCP ports that forwards addressed messages and event
+ * reports only to the ports that need them.
+ *
+ * @author Balazs Racz
+ * @date 17 Oct 2026
+ */
+
+#ifndef _OPENLCB_TCPROUTINGHUB_HXX_
+#define _OPENLCB_TCPROUTINGHUB_HXX_
+
+#include <map>
+
+#include "openlcb/Convert.hxx"
+#include "openlcb/Defs.hxx"
+#include "openlcb/IfTcpImpl.hxx"
+#include "openlcb/RoutingLogic.hxx"
+#include "os/OS.hxx"
+#include "utils/Hub.hxx"
+
+namespace openlcb
+{
+
+/**
+   A HubFlow that carries rendered OpenLCB-TCP messages (one message per
+   buffer, as produced by IfTcp and FdToTcpParser) and makes routing decisions
+   on them.
+
+   - The source node ID of every message is learned as being reachable via
+     the port the message came from.
+   - Addressed messages are sent only to the port where the destination node
+     was last seen. Unknown destinations are sent to every port.
+   - Consumer Identified messages build an event filter for the source port.
+     When a port is added, the hub sends an Identify Events message to it,
+     and sends it every event report for a while, until the nodes behind the
+     port had the time to identify their consumers. After that, event reports
+     are sent to the port only if its filter matches the event. Without a
+     node ID to send the Identify Events from, event reports are not
+     filtered.
+   - Everything else is sent to every port.
+
+   The decisions are made when the dispatcher iterates the ports, so ports
+   are registered the same way as with a plain HubFlow.
+ */
+class TcpRoutingHub : public HubFlow
+{
+public:
+    /// Constructor.
+    /// @param s defines which executor to run this on.
+    /// @param node_id is the node ID from which the Identify Events messages
+    /// are sent to new ports. If zero, event reports are not filtered.
+    /// @param learn_nsec is how long after adding a port all event reports
+    /// are sent to it.
+    TcpRoutingHub(
+        Service *s, NodeID node_id = 0, long long learn_nsec = SEC_TO_NSEC(3))
+        : HubFlow(s)
+        , nodeId_(node_id)
+        , learnNsec_(learn_nsec)
+    {
+        filterHandlers_ = true;
+    }
+
+    /// @return the routing table. Exposed for tests.
+    RoutingLogic<HubPortInterface, NodeID> *routing_table()
+    {
+        return &routingTable_;
+    }
+
+private:
+    Action entry() override
+    {
+        classify_message();
+        return HubFlow::entry();
+    }
+
+    void port_added(port_type *port) override
+    {
+        if (!nodeId_)
+        {
+            return;
+        }
+        {
+            OSMutexLock l(&learnLock_);
+            learnUntil_[port] = os_get_time_monotonic() + learnNsec_;
+        }
+        // Asks every node behind the new port to identify its events.
+        GenMessage msg;
+        msg.reset(Defs::MTI_EVENTS_IDENTIFY_GLOBAL, nodeId_, EMPTY_PAYLOAD);
+        auto *b = alloc();
+        TcpDefs::render_tcp_message(msg, nodeId_, 0, b->data());
+        b->data()->skipMember_ = nullptr;
+        port->send(b);
+    }
+
+    void port_removed(port_type *port) override
+    {
+        routingTable_.remove_port(port);
+        OSMutexLock l(&learnLock_);
+        learnUntil_.erase(port);
+    }
+
+    /// @return true if the nodes behind a port might not have identified
+    /// their consumers yet.
+    /// @param port is the port to check.
+    bool is_learning(HubPortInterface *port)
+    {
+        OSMutexLock l(&learnLock_);
+        auto it = learnUntil_.find(port);
+        if (it == learnUntil_.end())
+        {
+            return false;
+        }
+        if (os_get_time_monotonic() < it->second)
+        {
+            return true;
+        }
+        learnUntil_.erase(it);
+        return false;
+    }
+
+    bool filter_handler(UntypedHandler *handler) override
+    {
+        switch (forwardType_)
+        {
+            case ADDRESSED:
+                return handler == dstPort_;
+            case EVENT:
+            {
+                auto *port = static_cast<HubPortInterface *>(handler);
+                return !nodeId_ || is_learning(port) ||
+                    routingTable_.check_pcer(port, event_);
+            }
+            default:
+                return true;
+        }
+    }
+
+    /// Parses the header of the current message, learns the source address
+    /// and the event registrations, and sets forwardType_.
+    void classify_message()
+    {
+        forwardType_ = FORWARD_ALL;
+        const string &p = *message()->data();
+        HubPortInterface *src_port = message()->data()->skipMember_;
+        if (p.size() < TcpDefs::MIN_MESSAGE_SIZE ||
+            (data_to_error(&p[TcpDefs::HDR_FLAG_OFS]) &
+                TcpDefs::FLAGS_OPENLCB_MSG) == 0)
+        {
+            return;
+        }
+        const char *msg = &p[TcpDefs::HDR_LEN];
+        Defs::MTI mti = (Defs::MTI)data_to_error(msg + TcpDefs::MSG_MTI_OFS);
+        NodeID src = data_to_node_id(msg + TcpDefs::MSG_SRC_OFS);
+        if (src_port && src)
+        {
+            routingTable_.add_node_id_to_route(src_port, src);
+        }
+        if (Defs::get_mti_address(mti))
+        {
+            if (p.size() < TcpDefs::MIN_ADR_MESSAGE_SIZE)
+            {
+                return;
+            }
+            dstPort_ = routingTable_.lookup_port_for_address(
+                data_to_node_id(msg + TcpDefs::MSG_DST_OFS));
+            if (dstPort_)
+            {
+                forwardType_ = ADDRESSED;
+            }
+            return;
+        }
+        if (!Defs::get_mti_event(mti) ||
+            p.size() != TcpDefs::MIN_MESSAGE_SIZE + 8)
+        {
+            return;
+        }
+        event_ = data_to_eventid(msg + TcpDefs::MSG_GLOBAL_PAYLOAD_OFS);
+        if (mti == Defs::MTI_EVENT_REPORT)
+        {
+            forwardType_ = EVENT;
+            return;
+        }
+        if (!src_port)
+        {
+            return;
+        }
+        // Producers do not need the event reports, so only the consumers
+        // are registered.
+        if ((mti & ~Defs::MTI_MODIFIER_MASK) ==
+            (Defs::MTI_CONSUMER_IDENTIFIED_VALID & ~Defs::MTI_MODIFIER_MASK))
+        {
+            routingTable_.register_consumer(src_port, event_);
+        }
+        else if (mti == Defs::MTI_CONSUMER_IDENTIFIED_RANGE)
+        {
+            routingTable_.register_consumer_range(src_port, event_);
+        }
+    }
+
+    enum ForwardType
+    {
+        /// Broadcast message that needs to go out to all ports, unfiltered.
+        FORWARD_ALL,
+        /// Addressed message with a known destination port (dstPort_).
+        ADDRESSED,
+        /// Event report that needs to check the event filters.
+        EVENT,
+    };
+
+    /// Routing decision for the message currently being dispatched.
+    ForwardType forwardType_{FORWARD_ALL};
+    /// Destination port for an ADDRESSED message.
+    HubPortInterface *dstPort_{nullptr};
+    /// Event ID of the current message, if it has one.
+    EventId event_{0};
+    /// Address and event tables.
+    RoutingLogic<HubPortInterface, NodeID> routingTable_;
+    /// Node ID to send the Identify Events messages from.
+    NodeID nodeId_;
+    /// How long a new port receives all event reports.
+    long long learnNsec_;
+    /// Protects learnUntil_.
+    OSMutex learnLock_;
+    /// Ports that receive all event reports, with the time until when.
+    std::map<HubPortInterface *, long long> learnUntil_;
+};
+
+} // namespace openlcb
+
+#endif // _OPENLCB_TCPROUTINGHUB_HXX_
@@ -56,10 +56,6 @@ TrainNode::~TrainNode()
 
 TrainNodeWithConsist::~TrainNodeWithConsist()
 {
-    while (!consistSlaves_.empty())
-    {
-        delete consistSlaves_.pop_front();
-    }
 }
 
 DefaultTrainNode::~DefaultTrainNode()
@@ -201,7 +197,6 @@ struct TrainService::Impl
                 {
                     SpeedType sp = fp16_to_speed(payload() + 1);
                     train_node()->train()->set_speed(sp);
-                    nextConsistIndex_ = 0;
                     return call_immediately(STATE(maybe_forward_consist));
                 }
                 case TractionDefs::REQ_SET_FN:
@@ -232,13 +227,11 @@ struct TrainService::Impl
                     {
                         train_node()->train()->set_fn(address, value);
                     }
-                    nextConsistIndex_ = 0;
                     return call_immediately(STATE(maybe_forward_consist));
                 }
                 case TractionDefs::REQ_EMERGENCY_STOP:
                 {
                     train_node()->train()->set_emergencystop();
-                    nextConsistIndex_ = 0;
                     return call_immediately(STATE(maybe_forward_consist));
                 }
                 case TractionDefs::REQ_QUERY_SPEED: // fall through
@@ -460,92 +453,90 @@ struct TrainService::Impl
             }
         }
 
+        /// Forwards the incoming command to every consist member it applies
+        /// to. The forwarded message is built once and cloned per member; the
+        /// incoming buffer is reused for the last member.
         Action maybe_forward_consist()
         {
             auto* train_node = this->train_node();
             unsigned count = train_node->query_consist_length();
-            if (count <= nextConsistIndex_)
-                return release_and_exit();
-            uint8_t flags = 0;
-            NodeID dst = train_node->query_consist(nextConsistIndex_, &flags);
-            if (iface()->matching_node(nmsg()->src, NodeHandle(dst)))
-            {
-                ++nextConsistIndex_;
-                return again();
-            }
             uint8_t cmd = payload()[0] & TractionDefs::REQ_MASK;
-            bool flip_speed = false;
-            if (cmd == TractionDefs::REQ_SET_SPEED) {
-                if (flags & TractionDefs::CNSTFLAGS_REVERSE) {
-                    flip_speed = true;
-                }
-            } else if (cmd == TractionDefs::REQ_SET_FN) {
+            // Which link flag a member needs to receive this command.
+            uint8_t link_flag = 0;
+            if (cmd == TractionDefs::REQ_SET_FN) {
                 uint32_t address = payload()[1];
                 address <<= 8;
                 address |= payload()[2];
                 address <<= 8;
                 address |= payload()[3];
-                if (address == 0) {
-                    if ((flags & TractionDefs::CNSTFLAGS_LINKF0) == 0) {
-                        // skip
-                        ++nextConsistIndex_;
-                        return again();
-                    }
-                } else {
-                    if ((flags & TractionDefs::CNSTFLAGS_LINKFN) == 0) {
-                        // skip
-                        ++nextConsistIndex_;
-                        return again();
-                    }
-                }
+                link_flag = address == 0 ? TractionDefs::CNSTFLAGS_LINKF0
+                                         : TractionDefs::CNSTFLAGS_LINKFN;
             }
-            if (count == nextConsistIndex_ + 1u)
+            bool is_speed = (cmd == TractionDefs::REQ_SET_SPEED);
+            // Finds the last member so that it can get the incoming buffer.
+            unsigned last = count;
+            for (unsigned i = count; i-- > 0;)
             {
-                // last node: we can transfer the message.
-                auto *b = transfer_message();
-                b->data()->src = NodeHandle(train_node->node_id());
-                b->data()->dst = NodeHandle(dst);
-                b->data()->dstNode = nullptr;
-                if (flip_speed) {
-                    b->data()->payload[1] ^= 0x80;
+                uint8_t flags = 0;
+                NodeID dst = train_node->query_consist(i, &flags);
+                if (should_forward(dst, flags, link_flag))
+                {
+                    last = i;
+                    break;
                 }
-                b->data()->payload[0] |= TractionDefs::REQ_LISTENER;
-                iface()->addressed_message_write_flow()->send(b);
-                return exit();
             }
-            else
+            if (last == count)
             {
-                return allocate_and_call(
-                    iface()->addressed_message_write_flow(),
-                    STATE(forward_consist));
+                return release_and_exit();
             }
+            NodeID src = train_node->node_id();
+            auto *write_flow = iface()->addressed_message_write_flow();
+            Payload fwd = message()->data()->payload;
+            fwd[0] |= TractionDefs::REQ_LISTENER;
+            for (unsigned i = 0; i <= last; ++i)
+            {
+                uint8_t flags = 0;
+                NodeID dst = train_node->query_consist(i, &flags);
+                Buffer<GenMessage> *b;
+                if (i == last)
+                {
+                    b = transfer_message();
+                    b->data()->src = NodeHandle(src);
+                    b->data()->dst = NodeHandle(dst);
+                    b->data()->dstNode = nullptr;
+                    b->data()->payload[0] |= TractionDefs::REQ_LISTENER;
+                }
+                else if (should_forward(dst, flags, link_flag))
+                {
+                    b = write_flow->alloc();
+                    b->data()->reset(message()->data()->mti, src,
+                        NodeHandle(dst), fwd);
+                }
+                else
+                {
+                    continue;
+                }
+                if (is_speed && (flags & TractionDefs::CNSTFLAGS_REVERSE))
+                {
+                    b->data()->payload[1] ^= 0x80;
+                }
+                write_flow->send(b);
+            }
+            return exit();
         }
 
-        Action forward_consist()
+        /// @return true if a consist member shall get a forwarded command.
+        /// @param dst the consist member
+        /// @param flags the consist link's flags
+        /// @param link_flag the flag the link needs to have, or 0.
+        bool should_forward(NodeID dst, uint8_t flags, uint8_t link_flag)
         {
-            auto *b =
-                get_allocation_result(iface()->addressed_message_write_flow());
-            uint8_t flags;
-            NodeID dst = train_node()->query_consist(nextConsistIndex_, &flags);
-            if (!dst)
-            {
-                // Strange. The consist destination should exist and never be
-                // zero once we got here.
-                b->unref();
-                return release_and_exit();
-            }
-            b->data()->reset(message()->data()->mti, train_node()->node_id(),
-                             NodeHandle(dst), message()->data()->payload);
-            b->data()->payload[0] |= TractionDefs::REQ_LISTENER;
-            if (((payload()[0] & TractionDefs::REQ_MASK) ==
-                    TractionDefs::REQ_SET_SPEED) &&
-                (flags & TractionDefs::CNSTFLAGS_REVERSE))
+            if (link_flag && (flags & link_flag) == 0)
             {
-                b->data()->payload[1] ^= 0x80;
+                return false;
             }
-            iface()->addressed_message_write_flow()->send(b);
-            ++nextConsistIndex_;
-            return call_immediately(STATE(maybe_forward_consist));
+            // Do not send back to where the command came from.
+            return !iface()->matching_node(nmsg()->src, NodeHandle(dst));
         }
 
         Action handle_traction_mgmt()
@@ -650,7 +641,6 @@ struct TrainService::Impl
     private:
         /// error code for reject_permanent().
         unsigned errorCode_ : 16;
-        unsigned nextConsistIndex_ : 8;
         /// 1 if the voluntary lock protocol has set this train to be reserved.
         unsigned reserved_ : 1;
         TrainService *trainService_;
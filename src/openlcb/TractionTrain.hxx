@@ -36,6 +36,7 @@
 #define _OPENLCB_TRACTIONTRAIN_HXX_
 
 #include <set>
+#include <vector>
 
 #include "executor/Service.hxx"
 #include "openlcb/DefaultNodeRegistry.hxx"
@@ -128,9 +129,8 @@ public:
     virtual int query_consist_length() = 0;
 };
 
-/// Linked list entry for all registered consist clients for a given train
-/// node.
-struct ConsistEntry : public QMember
+/// Table entry for all registered consist clients for a given train node.
+struct ConsistEntry
 {
     /// Creates a new consist entry storage.
     /// @param s the stored node ID
@@ -193,16 +193,15 @@ public:
         {
             return false;
         }
-        auto it = consistSlaves_.begin();
-        for (; it != consistSlaves_.end(); ++it)
+        for (auto &e : consistSlaves_)
         {
-            if (it->get_slave() == tgt)
+            if (e.get_slave() == tgt)
             {
-                it->set_flags(flags);
+                e.set_flags(flags);
                 return false;
             }
         }
-        consistSlaves_.insert(it, new ConsistEntry(tgt, flags));
+        consistSlaves_.emplace_back(tgt, flags);
         return true;
     }
 
@@ -214,9 +213,7 @@ public:
         {
             if (it->get_slave() == tgt)
             {
-                auto* p = it.operator->();
                 consistSlaves_.erase(it);
-                delete p;
                 return true;
             }
         }
@@ -227,31 +224,24 @@ public:
      * fewer than id consist targets. id is zero-based. */
     NodeID query_consist(int id, uint8_t* flags) override
     {
-        int k = 0;
-        for (auto it = consistSlaves_.begin();
-             it != consistSlaves_.end(); ++it, ++k)
+        if (id < 0 || (unsigned)id >= consistSlaves_.size())
         {
-            if (k == id)
-            {
-                if (flags) *flags = it->get_flags();
-                return it->get_slave();
-            }
+            return 0;
         }
-        return 0;
+        const ConsistEntry &e = consistSlaves_[id];
+        if (flags) *flags = e.get_flags();
+        return e.get_slave();
     }
 
     /** Returns the number of slaves in this consist. */
     int query_consist_length() override
     {
-        int ret = 0;
-        for (auto it = consistSlaves_.begin(); it != consistSlaves_.end();
-             ++it, ++ret)
-        {
-        }
-        return ret;
+        return consistSlaves_.size();
     }
 
-    TypedQueue<ConsistEntry> consistSlaves_;
+    /// Consist targets in the order they were added. Indexed by the consist
+    /// link id of query_consist().
+    std::vector<ConsistEntry> consistSlaves_;
 };
 
 /// Default implementation of a train node.
@@ -112,6 +112,54 @@ int OSSelectWakeup::select(int nfds, fd_set *readfds,
     return ret;
 }
 
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+int OSSelectWakeup::epoll_wait(int epfd, struct epoll_event *events,
+    int maxevents, long long deadline_nsec)
+{
+    {
+        AtomicHolder l(this);
+        inSelect_ = true;
+        if (pendingWakeup_)
+        {
+            deadline_nsec = 0;
+        }
+    }
+    int ret;
+#if defined(__GLIBC__)
+#if __GLIBC_PREREQ(2, 35)
+    if (deadline_nsec > 0 && deadline_nsec < 1000)
+    {
+        // A timeout this short is over before the kernel gets to sleeping,
+        // making epoll return immediately. select() always sleeps at least
+        // for the timer slack instead. We keep the latter behavior, otherwise
+        // the executor spins on a timer that is about to expire.
+        deadline_nsec = 1000;
+    }
+    struct timespec timeout;
+    timeout.tv_sec = deadline_nsec / 1000000000;
+    timeout.tv_nsec = deadline_nsec % 1000000000;
+    ret = ::epoll_pwait2(epfd, events, maxevents,
+        deadline_nsec < 0 ? nullptr : &timeout, &origMask_);
+    if (ret < 0 && errno == ENOSYS)
+#endif // __GLIBC_PREREQ(2, 35)
+#endif // __GLIBC__
+    {
+        // Millisecond resolution only. Rounds up to not wake up before the
+        // deadline.
+        int timeout_msec = deadline_nsec < 0
+            ? -1
+            : (int)((deadline_nsec + 999999) / 1000000);
+        ret = ::epoll_pwait(epfd, events, maxevents, timeout_msec, &origMask_);
+    }
+    {
+        AtomicHolder l(this);
+        pendingWakeup_ = false;
+        inSelect_ = false;
+    }
+    return ret;
+}
+#endif // OPENMRN_FEATURE_EXECUTOR_EPOLL
+
 #ifdef ESP_PLATFORM
 #include "freertos_includes.h"
 
@@ -48,6 +48,10 @@
 #include <signal.h>
 #endif
 
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #ifdef __WINNT__
 #include <winsock2.h>
 #elif OPENMRN_HAVE_SELECT
@@ -201,6 +205,23 @@ public:
     int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
                long long deadline_nsec);
 
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+    /** Call to ::epoll_pwait that can be woken up asynchronously from a
+     * different thread.
+     *
+     * @param epfd is the epoll instance to wait on.
+     * @param events will be filled with the ready events.
+     * @param maxevents is the length of the events array.
+     * @param deadline_nsec is the maximum time to sleep if no fd activity and
+     * no wakeup happens. -1 to sleep indefinitely, 0 to return immediately.
+     *
+     * @return the number of filled entries in events (0 in case of timeout),
+     * or -1 and errno==EINTR if the wait was woken up asynchronously
+     */
+    int epoll_wait(int epfd, struct epoll_event *events, int maxevents,
+        long long deadline_nsec);
+#endif
+
 private:
 #ifdef ESP_PLATFORM
     void esp_allocate_vfs_fd();
@@ -33,6 +33,7 @@
 
 #include "utils/Buffer.hxx"
 #include "utils/ByteBuffer.hxx"
+#include "nmranet_config.h"
 
 DynamicPool *mainBufferPool = nullptr;
 Pool *rawBufferPool = nullptr;
@@ -47,10 +48,261 @@ Pool* init_main_buffer_pool()
     {
         mainBufferPool =
             new DynamicPool(Bucket::init(32, 48, LARGEST_BUFFERPOOL_BUCKET, 0));
+#if OPENMRN_FEATURE_BUFFER_THREAD_CACHE
+        mainBufferPool->set_thread_cache_size(
+            config_buffer_pool_thread_cache_size());
+#endif
     }
     return mainBufferPool;
 }
 
+#if OPENMRN_FEATURE_BUFFER_THREAD_CACHE
+/// Free buffers of one DynamicPool that are cached by one thread.
+class DynamicPool::ThreadCache
+{
+public:
+    /// Free buffers of one bucket.
+    struct Magazine
+    {
+        /// Singly linked list of the free buffers.
+        QMember *head {nullptr};
+        /// Number of buffers in the list. Written only by the owning thread,
+        /// read by free_items() from any thread.
+        std::atomic<unsigned> count {0};
+        /// Smallest count since the last scavenge.
+        unsigned lowWater {0};
+    };
+
+    /// Constructor. @param pool owns this cache. @param num_buckets is the
+    /// number of buckets in the pool.
+    ThreadCache(DynamicPool *pool, unsigned num_buckets)
+        : pool_(pool)
+        , numBuckets_(num_buckets)
+        , magazines_(new Magazine[num_buckets])
+    {
+    }
+
+    ~ThreadCache()
+    {
+        delete[] magazines_;
+    }
+
+    /// How many alloc and free calls between two scavenges.
+    static constexpr unsigned SCAVENGE_PERIOD = 1024;
+
+    /// Pool that this cache belongs to. Null if the pool was destroyed.
+    DynamicPool *pool_;
+    /// Next cache of the same pool.
+    ThreadCache *nextInPool_ {nullptr};
+    /// Next cache of the same thread.
+    ThreadCache *nextInThread_ {nullptr};
+    /// Number of entries in magazines_.
+    unsigned numBuckets_;
+    /// Counts the alloc and free calls up to SCAVENGE_PERIOD.
+    unsigned ops_ {0};
+    /// Free buffers, one entry per bucket.
+    Magazine *magazines_;
+};
+
+/// Owns the caches of one thread. Returns the cached buffers to their pools
+/// when the thread exits.
+class DynamicPool::ThreadCacheList
+{
+public:
+    ~ThreadCacheList()
+    {
+        while (head_)
+        {
+            ThreadCache *c = head_;
+            head_ = c->nextInThread_;
+            if (c->pool_)
+            {
+                c->pool_->detach_thread_cache(c);
+            }
+            delete c;
+        }
+    }
+
+    /// First cache of this thread.
+    ThreadCache *head_ {nullptr};
+};
+
+DynamicPool::ThreadCache *DynamicPool::thread_cache()
+{
+    static thread_local ThreadCacheList caches;
+    for (ThreadCache *c = caches.head_; c; c = c->nextInThread_)
+    {
+        if (c->pool_ == this)
+        {
+            return c;
+        }
+    }
+    unsigned num_buckets = 0;
+    while (buckets[num_buckets].size() != 0)
+    {
+        ++num_buckets;
+    }
+    ThreadCache *c = new ThreadCache(this, num_buckets);
+    c->nextInThread_ = caches.head_;
+    caches.head_ = c;
+    AtomicHolder h(this);
+    c->nextInPool_ = threadCaches_;
+    threadCaches_ = c;
+    return c;
+}
+
+BufferBase *DynamicPool::cache_alloc(unsigned index)
+{
+    ThreadCache *cache = thread_cache();
+    ThreadCache::Magazine &m = cache->magazines_[index];
+    unsigned count = m.count.load(std::memory_order_relaxed);
+    if (!count)
+    {
+        // Refills half of the magazine with one lock.
+        Bucket *bucket = buckets + index;
+        AtomicHolder h(bucket->lock());
+        while (count < (magazineSize_ + 1) / 2)
+        {
+            QMember *item = bucket->next_locked().item;
+            if (!item)
+            {
+                break;
+            }
+            item->next = m.head;
+            m.head = item;
+            ++count;
+        }
+        if (!count)
+        {
+            return nullptr;
+        }
+    }
+    QMember *item = m.head;
+    m.head = item->next;
+    item->next = nullptr;
+    --count;
+    m.count.store(count, std::memory_order_relaxed);
+    if (count < m.lowWater)
+    {
+        m.lowWater = count;
+    }
+    if (++cache->ops_ >= ThreadCache::SCAVENGE_PERIOD)
+    {
+        cache_scavenge(cache);
+    }
+    return static_cast<BufferBase *>(item);
+}
+
+void DynamicPool::cache_free(unsigned index, BufferBase *item)
+{
+    ThreadCache *cache = thread_cache();
+    ThreadCache::Magazine &m = cache->magazines_[index];
+    item->next = m.head;
+    m.head = item;
+    unsigned count = m.count.load(std::memory_order_relaxed) + 1;
+    m.count.store(count, std::memory_order_relaxed);
+    if (count > magazineSize_)
+    {
+        // Keeps half of the magazine for the next allocations.
+        cache_release(cache, index, count - magazineSize_ / 2);
+    }
+    if (++cache->ops_ >= ThreadCache::SCAVENGE_PERIOD)
+    {
+        cache_scavenge(cache);
+    }
+}
+
+void DynamicPool::cache_release(
+    ThreadCache *cache, unsigned index, unsigned count)
+{
+    ThreadCache::Magazine &m = cache->magazines_[index];
+    if (!count)
+    {
+        return;
+    }
+    unsigned remaining = m.count.load(std::memory_order_relaxed) - count;
+    {
+        Bucket *bucket = buckets + index;
+        AtomicHolder h(bucket->lock());
+        for (unsigned i = 0; i < count; ++i)
+        {
+            QMember *item = m.head;
+            m.head = item->next;
+            item->next = nullptr;
+            bucket->insert_locked(item);
+        }
+    }
+    m.count.store(remaining, std::memory_order_relaxed);
+    if (remaining < m.lowWater)
+    {
+        m.lowWater = remaining;
+    }
+}
+
+void DynamicPool::cache_scavenge(ThreadCache *cache)
+{
+    cache->ops_ = 0;
+    for (unsigned i = 0; i < cache->numBuckets_; ++i)
+    {
+        ThreadCache::Magazine &m = cache->magazines_[i];
+        // These buffers were sitting in the cache during the whole period.
+        cache_release(cache, i, m.lowWater);
+        m.lowWater = m.count.load(std::memory_order_relaxed);
+    }
+}
+
+void DynamicPool::flush_thread_cache()
+{
+    if (!magazineSize_)
+    {
+        return;
+    }
+    ThreadCache *cache = thread_cache();
+    for (unsigned i = 0; i < cache->numBuckets_; ++i)
+    {
+        cache_release(
+            cache, i, cache->magazines_[i].count.load(std::memory_order_relaxed));
+    }
+}
+
+void DynamicPool::detach_thread_cache(ThreadCache *cache)
+{
+    for (unsigned i = 0; i < cache->numBuckets_; ++i)
+    {
+        cache_release(
+            cache, i, cache->magazines_[i].count.load(std::memory_order_relaxed));
+    }
+    AtomicHolder h(this);
+    for (ThreadCache **p = &threadCaches_; *p; p = &(*p)->nextInPool_)
+    {
+        if (*p == cache)
+        {
+            *p = cache->nextInPool_;
+            break;
+        }
+    }
+    cache->pool_ = nullptr;
+}
+
+void DynamicPool::release_thread_caches()
+{
+    // The caches of other threads are only touched here because the pool is
+    // being destroyed, so no other thread may be using it anymore.
+    AtomicHolder h(this);
+    while (threadCaches_)
+    {
+        ThreadCache *c = threadCaches_;
+        threadCaches_ = c->nextInPool_;
+        for (unsigned i = 0; i < c->numBuckets_; ++i)
+        {
+            cache_release(
+                c, i, c->magazines_[i].count.load(std::memory_order_relaxed));
+        }
+        c->pool_ = nullptr;
+    }
+}
+#endif // OPENMRN_FEATURE_BUFFER_THREAD_CACHE
+
 /** Number of free items in the pool.
  * @return number of free items in the pool
  */
@@ -61,6 +313,16 @@ size_t DynamicPool::free_items()
     {
         total += current->pending();
     }
+#if OPENMRN_FEATURE_BUFFER_THREAD_CACHE
+    AtomicHolder h(this);
+    for (ThreadCache *c = threadCaches_; c; c = c->nextInPool_)
+    {
+        for (unsigned i = 0; i < c->numBuckets_; ++i)
+        {
+            total += c->magazines_[i].count.load(std::memory_order_relaxed);
+        }
+    }
+#endif
     return total;
 }
 
@@ -74,7 +336,16 @@ size_t DynamicPool::free_items(size_t size)
     {
         if (current->size() >= size)
         {
-            return current->pending();
+            size_t total = current->pending();
+#if OPENMRN_FEATURE_BUFFER_THREAD_CACHE
+            AtomicHolder h(this);
+            for (ThreadCache *c = threadCaches_; c; c = c->nextInPool_)
+            {
+                total += c->magazines_[current - buckets].count.load(
+                    std::memory_order_relaxed);
+            }
+#endif
+            return total;
         }
     }
     return 0;
@@ -110,7 +381,16 @@ BufferBase *DynamicPool::alloc_untyped(size_t size, Executable *flow)
     {
         if (size <= current->size())
         {
-            result = static_cast<BufferBase*>(current->next().item);
+#if OPENMRN_FEATURE_BUFFER_THREAD_CACHE
+            if (magazineSize_)
+            {
+                result = cache_alloc(current - buckets);
+            }
+            else
+#endif
+            {
+                result = static_cast<BufferBase *>(current->next().item);
+            }
             if (result == NULL)
             {
                 result = (BufferBase*)buffer_malloc(current->size());
@@ -174,6 +454,13 @@ void DynamicPool::free(BufferBase *item)
     {
         if (item->size() <= current->size())
         {
+#if OPENMRN_FEATURE_BUFFER_THREAD_CACHE
+            if (magazineSize_)
+            {
+                cache_free(current - buckets, item);
+                return;
+            }
+#endif
             current->insert(item);
             return;
         }
@@ -261,3 +548,36 @@ void FixedPool::free(BufferBase *item)
     }
 
 }
+
+std::atomic<FixedPool *> MulticastEntry::pool_ {nullptr};
+
+FixedPool *MulticastEntry::pool()
+{
+    static FixedPool *pool = []() {
+        FixedPool *p = new FixedPool(
+            sizeof(Buffer<Ref>), config_multicast_entry_pool_size());
+        pool_.store(p, std::memory_order_release);
+        return p;
+    }();
+    return pool;
+}
+
+BufferBase *MulticastEntry::create(BufferBase *target)
+{
+    Buffer<Ref> *entry;
+    pool()->alloc(&entry);
+    if (!entry)
+    {
+        return nullptr;
+    }
+    entry->data()->target = target;
+    return entry;
+}
+
+BufferBase *MulticastEntry::resolve_entry(BufferBase *item)
+{
+    auto *entry = static_cast<Buffer<Ref> *>(item);
+    BufferBase *target = entry->data()->target;
+    entry->unref();
+    return target;
+}
@@ -502,6 +502,9 @@ public:
     /** default destructor */
     ~DynamicPool()
     {
+#if OPENMRN_FEATURE_BUFFER_THREAD_CACHE
+        release_thread_caches();
+#endif
 #ifdef GTEST
         for (unsigned i = 0; buckets[i].size() != 0; ++i)
         {
@@ -531,11 +534,80 @@ public:
      */
     size_t free_items(size_t size) override;
 
+#if OPENMRN_FEATURE_BUFFER_THREAD_CACHE
+    /** Enables per-thread caches of free buffers. Each thread that allocates
+     * or frees buffers keeps up to magazine_size free buffers per bucket
+     * without taking any lock. Buffers move between the thread cache and the
+     * shared bucket in batches. Cached buffers that remain unused for a while
+     * and all cached buffers of an exiting thread are returned to the
+     * buckets. Cached buffers are counted by free_items().
+     *
+     * Must be called before the pool is used.
+     *
+     * @param magazine_size maximum number of free buffers a thread caches for
+     * each bucket; 0 disables the caches (default). */
+    void set_thread_cache_size(unsigned magazine_size)
+    {
+        magazineSize_ = magazine_size;
+    }
+
+    /** Returns all free buffers cached by the calling thread to the shared
+     * buckets. */
+    void flush_thread_cache();
+#endif
+
 protected:
     /** Free buffer queue */
     Bucket *buckets;
 
 private:
+#if OPENMRN_FEATURE_BUFFER_THREAD_CACHE
+    class ThreadCache;
+    class ThreadCacheList;
+
+    /// @return the cache of the calling thread for this pool. Creates it upon
+    /// the first call in each thread.
+    ThreadCache *thread_cache();
+
+    /** Takes a free buffer from the thread cache, refilling the cache from
+     * the bucket if needed.
+     * @param index is the bucket index.
+     * @return the free buffer, or nullptr if the bucket is empty too. */
+    BufferBase *cache_alloc(unsigned index);
+
+    /** Puts a free buffer into the thread cache, returning some buffers to
+     * the bucket if the cache is full.
+     * @param index is the bucket index.
+     * @param item buffer to release. */
+    void cache_free(unsigned index, BufferBase *item);
+
+    /** Moves free buffers from a thread cache to the bucket.
+     * @param cache thread cache to take from.
+     * @param index is the bucket index.
+     * @param count how many buffers to move. */
+    void cache_release(ThreadCache *cache, unsigned index, unsigned count);
+
+    /** Returns cached buffers that were not needed since the previous call.
+     * @param cache thread cache to trim. */
+    void cache_scavenge(ThreadCache *cache);
+
+    /** Returns everything from a thread cache to the buckets and removes it
+     * from the list of caches. Called when the thread exits.
+     * @param cache thread cache to detach. */
+    void detach_thread_cache(ThreadCache *cache);
+
+    /// Returns everything from all thread caches to the buckets. Called from
+    /// the destructor.
+    void release_thread_caches();
+
+    /// Maximum number of free buffers per bucket in each thread cache. Zero if
+    /// the thread caches are disabled.
+    unsigned magazineSize_ {0};
+    /// Linked list of all thread caches of this pool. Protected by the pool
+    /// lock.
+    ThreadCache *threadCaches_ {nullptr};
+#endif
+
     /** Get a free item out of the pool.
      * @param result pointer to a pointer to the result
      * @param flow if !NULL, then the alloc call is considered async and will
@@ -670,6 +742,63 @@ private:
     DISALLOW_COPY_AND_ASSIGN(FixedPool);
 };
 
+/** Queue entry standing in for a shared Buffer.
+ *
+ * A Buffer can be in only one queue at a time, because it has only one
+ * QMember link. To deliver the same Buffer to multiple StateFlows without
+ * copying the payload, the sender puts a multicast entry into each queue
+ * instead. The entry holds one reference to the shared Buffer. When a
+ * StateFlowWithQueue takes an entry off its queue, it frees the entry and
+ * processes the referenced Buffer as if that had been sent directly.
+ *
+ * The entries are small and come from a fixed pool, which is created upon the
+ * first use. The size of the pool is set by
+ * config_multicast_entry_pool_size(). */
+class MulticastEntry
+{
+public:
+    /** Allocates an entry.
+     * @param target the shared buffer. The entry takes over one reference.
+     * @return the entry to put into the queue, or nullptr if the pool is
+     * exhausted. In this case the reference to target remains with the
+     * caller. */
+    static BufferBase *create(BufferBase *target);
+
+    /** Replaces a multicast entry with the buffer it refers to.
+     * @param item a buffer taken off a queue. Ownership is transferred.
+     * @return item if it is a regular buffer; the referenced buffer (with the
+     * reference held by the entry) if item was a multicast entry. */
+    static BufferBase *resolve(BufferBase *item)
+    {
+        FixedPool *pool = pool_.load(std::memory_order_acquire);
+        if (pool && pool->valid(item))
+        {
+            return resolve_entry(item);
+        }
+        return item;
+    }
+
+private:
+    /// Payload of the entries.
+    struct Ref
+    {
+        /// Shared buffer this entry stands in for.
+        BufferBase *target;
+    };
+
+    /// Frees an entry. @param item is a multicast entry. @return the buffer
+    /// it referred to.
+    static BufferBase *resolve_entry(BufferBase *item);
+
+    /// @return the pool holding the entries. Creates the pool and publishes it
+    /// in pool_ upon the first call.
+    static FixedPool *pool();
+
+    /// Pool holding the entries, for resolve(). nullptr until the first entry
+    /// is created. Written only once.
+    static std::atomic<FixedPool *> pool_;
+};
+
 /** Decrement count.
  */
 template <class T> void Buffer<T>::unref()
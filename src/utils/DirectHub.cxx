@@ -43,6 +43,7 @@
 #include "utils/DirectHub.hxx"
 
 #include <algorithm>
+#include <map>
 #include <vector>
 
 #include <fcntl.h>
@@ -76,9 +77,15 @@ class DirectHubService : public Service
 public:
     typedef Q QueueType;
 
-    DirectHubService(ExecutorBase *e)
+    /// Constructor.
+    /// @param e executor on which the hub's own flows run.
+    /// @param notify_callers if true, callers that had to wait for the hub
+    /// are resumed by calling their notify(), which schedules a StateFlow on
+    /// its own executor. If false, they are run on e.
+    DirectHubService(ExecutorBase *e, bool notify_callers = false)
         : Service(e)
         , busy_(0)
+        , notifyCallers_(notify_callers ? 1 : 0)
     {
     }
 
@@ -136,12 +143,22 @@ public:
             }
             deq = pendingSend_.next();
         }
+        auto *caller = static_cast<Executable *>(deq.item);
+        if (notifyCallers_)
+        {
+            // Resumes the caller on its own executor.
+            caller->notify();
+            return;
+        }
         // Schedules it on the executor.
-        executor()->add(static_cast<Executable *>(deq.item), deq.index);
+        executor()->add(caller, deq.index);
     }
 
     /// 1 if there is any message being processed right now.
     unsigned busy_ : 1;
+    /// 1 if waiting callers are resumed via notify() instead of running them
+    /// on our executor.
+    unsigned notifyCallers_ : 1;
     /// List of callers that are waiting for the busy_ lock.
     QueueType pendingSend_;
 };
@@ -263,6 +280,288 @@ DirectHubInterface<uint8_t[]> *create_hub(ExecutorBase *e)
     return dh;
 }
 
+/// Copies the payload reference of a message. Takes a new reference of the
+/// payload buffers; does not copy the data.
+/// @param dst message to fill in.
+/// @param src message to take the payload from.
+static void copy_payload(
+    MessageAccessor<uint8_t[]> *dst, const MessageAccessor<uint8_t[]> &src)
+{
+    dst->buf_.reset(src.buf_);
+}
+
+/// Copies the payload reference of a message. Takes a new reference of the
+/// payload buffer; does not copy the data.
+/// @param dst message to fill in.
+/// @param src message to take the payload from.
+template <class T>
+static void copy_payload(MessageAccessor<T> *dst, const MessageAccessor<T> &src)
+{
+    if (src.payload_)
+    {
+        dst->payload_.reset(src.payload_->ref());
+    }
+}
+
+/// Entry in the queue of a hub shard. Represents either a message to be sent
+/// to the shard's ports, or a control operation (port removal).
+template <class T> struct DirectHubShardEntry
+{
+    /// Message to send. Holds its own references to the payload and a child
+    /// of the original done notifiable.
+    MessageAccessor<T> msg_;
+    /// If non-null, this entry is a port removal and not a message.
+    DirectHubPort<T> *removePort_ = nullptr;
+    /// Notified after the port was removed.
+    Notifiable *removeDone_ = nullptr;
+};
+
+/// One shard of a sharded DirectHub. Owns a subset of the output ports, and
+/// calls them from the shard's executor. Messages are processed in the order
+/// the hub has sent them.
+template <class T>
+class DirectHubShard : public StateFlow<Buffer<DirectHubShardEntry<T>>, QList<1>>
+{
+public:
+    typedef Buffer<DirectHubShardEntry<T>> BufferType;
+
+    DirectHubShard(ExecutorBase *e)
+        : StateFlow<BufferType, QList<1>>(new Service(e))
+    {
+    }
+
+    ~DirectHubShard()
+    {
+        delete this->service();
+    }
+
+    /// Adds a port to this shard. Thread-safe.
+    /// @param port the downstream port.
+    void add_port(DirectHubPort<T> *port)
+    {
+        AtomicHolder h(this);
+        ports_.push_back(port);
+    }
+
+    /// @return the number of ports registered to this shard. Thread-safe.
+    size_t num_ports()
+    {
+        AtomicHolder h(this);
+        return ports_.size();
+    }
+
+    /// Handler for the incoming queue entries.
+    StateFlowBase::Action entry() override
+    {
+        auto *e = this->message()->data();
+        if (e->removePort_)
+        {
+            {
+                AtomicHolder h(this);
+                ports_.erase(
+                    std::remove(ports_.begin(), ports_.end(), e->removePort_),
+                    ports_.end());
+            }
+            e->removeDone_->notify();
+            return this->release_and_exit();
+        }
+        unsigned next_port = 0;
+        while (true)
+        {
+            DirectHubPort<T> *p;
+            {
+                AtomicHolder h(this);
+                if (next_port >= ports_.size())
+                {
+                    break;
+                }
+                p = ports_[next_port];
+                ++next_port;
+            }
+            if (static_cast<HubSource *>(p) != e->msg_.source_)
+            {
+                p->send(&e->msg_);
+            }
+        }
+        e->msg_.clear();
+        return this->release_and_exit();
+    }
+
+private:
+    /// Output ports assigned to this shard. Only the shard's flow removes
+    /// entries. Protected by Atomic *this.
+    std::vector<DirectHubPort<T> *> ports_;
+}; // class DirectHubShard
+
+/// DirectHub implementation that distributes the output ports across multiple
+/// shards, each running on a separate executor. The entry to the hub is
+/// serialized the same way as in DirectHubImpl. When a message is sent, the
+/// hub takes one reference of the payload for each shard that has ports, and
+/// enqueues it to the shard; the shard then calls the output ports from its
+/// own executor.
+template <class T>
+class ShardedDirectHubImpl : public DirectHubInterface<T>,
+                             protected StateFlowBase,
+                             private Atomic
+{
+public:
+    ShardedDirectHubImpl(DirectHubService *service,
+        ExecutorBase *const *shard_executors, unsigned num_shards)
+        : StateFlowBase(service)
+    {
+        HASSERT(num_shards > 0);
+        for (unsigned i = 0; i < num_shards; ++i)
+        {
+            shards_.emplace_back(new DirectHubShard<T>(shard_executors[i]));
+        }
+    }
+
+    ~ShardedDirectHubImpl()
+    {
+        delete service();
+    }
+
+    Service *get_service() override
+    {
+        return service();
+    }
+
+    Service *get_port_service(DirectHubPort<T> *port) override
+    {
+        AtomicHolder h(this);
+        return shards_[assign_shard(port)]->service();
+    }
+
+    void register_port(DirectHubPort<T> *port) override
+    {
+        unsigned shard;
+        {
+            AtomicHolder h(this);
+            shard = assign_shard(port);
+        }
+        shards_[shard]->add_port(port);
+    }
+
+    /// Synchronously unregisters a port.
+    void unregister_port(DirectHubPort<T> *port) override
+    {
+        SyncNotifiable n;
+        unregister_port(port, &n);
+        n.wait_for_notification();
+    }
+
+    /// Removes a port from this hub. The removal is performed by the port's
+    /// shard in order with the messages, so when done is notified, the port
+    /// will not be called anymore.
+    /// @param port the downstream port.
+    /// @param done will be notified when the removal is complete.
+    void unregister_port(DirectHubPort<T> *port, Notifiable *done) override
+    {
+        unsigned shard;
+        {
+            AtomicHolder h(this);
+            auto it = portShard_.find(port);
+            HASSERT(it != portShard_.end());
+            shard = it->second;
+            portShard_.erase(it);
+            --shardLoad_[shard];
+        }
+        typename DirectHubShard<T>::BufferType *b;
+        mainBufferPool->alloc(&b);
+        b->data()->removePort_ = port;
+        b->data()->removeDone_ = done;
+        shards_[shard]->send(b);
+    }
+
+    void enqueue_send(Executable *caller) override
+    {
+        service()->enqueue_caller(caller);
+    }
+
+    MessageAccessor<T> *mutable_message() override
+    {
+        return &msg_;
+    }
+
+    void do_send() override
+    {
+        for (auto &s : shards_)
+        {
+            if (!s->num_ports())
+            {
+                continue;
+            }
+            typename DirectHubShard<T>::BufferType *b;
+            mainBufferPool->alloc(&b);
+            auto *m = &b->data()->msg_;
+            copy_payload(m, msg_);
+            if (msg_.done_)
+            {
+                m->set_done(msg_.done_->new_child());
+            }
+            m->source_ = msg_.source_;
+            m->dst_ = msg_.dst_;
+            m->isFlush_ = msg_.isFlush_;
+            s->send(b);
+        }
+        msg_.clear();
+        service()->on_done();
+    }
+
+private:
+    DirectHubService *service()
+    {
+        return static_cast<DirectHubService *>(StateFlowBase::service());
+    }
+
+    /// Looks up which shard a port belongs to, or assigns the least loaded
+    /// shard if the port is new. Must be called with the lock held.
+    /// @param port the downstream port.
+    /// @return shard index.
+    unsigned assign_shard(DirectHubPort<T> *port)
+    {
+        auto it = portShard_.find(port);
+        if (it != portShard_.end())
+        {
+            return it->second;
+        }
+        if (shardLoad_.size() < shards_.size())
+        {
+            shardLoad_.resize(shards_.size(), 0);
+        }
+        unsigned best = 0;
+        for (unsigned i = 1; i < shardLoad_.size(); ++i)
+        {
+            if (shardLoad_[i] < shardLoad_[best])
+            {
+                best = i;
+            }
+        }
+        ++shardLoad_[best];
+        portShard_[port] = best;
+        return best;
+    }
+
+    /// The shards, each with its own executor and set of ports.
+    std::vector<std::unique_ptr<DirectHubShard<T>>> shards_;
+    /// Which shard each port is assigned to. Protected by Atomic *this.
+    std::map<DirectHubPort<T> *, unsigned> portShard_;
+    /// Number of ports assigned to each shard. Protected by Atomic *this.
+    std::vector<unsigned> shardLoad_;
+
+    /// The message we are trying to send.
+    MessageAccessor<T> msg_;
+}; // class ShardedDirectHubImpl
+
+DirectHubInterface<uint8_t[]> *create_sharded_hub(ExecutorBase *e,
+    ExecutorBase *const *shard_executors, unsigned num_shards)
+{
+    // The callers are typically the read flows of ports running on the shard
+    // executors; when they have to wait, they get resumed there.
+    auto *s = new DirectHubService(e, true);
+    return new ShardedDirectHubImpl<uint8_t[]>(s, shard_executors, num_shards);
+}
+
 /// Connects a (bytes typed) hub to an FD. This state flow is the write flow;
 /// i.e., it waits for messages coming from the hub and writes them into the fd.
 /// The object is self-owning, i.e. will delete itself when the input goes dead
@@ -538,7 +837,7 @@ public:
     DirectHubPortSelect(DirectHubInterface<uint8_t[]> *hub, int fd,
         std::unique_ptr<MessageSegmenter> segmenter,
         Notifiable *on_error = nullptr)
-        : StateFlowBase(hub->get_service())
+        : StateFlowBase(hub->get_port_service(this))
         , readFlow_(this, std::move(segmenter))
         , readFlowPending_(1)
         , writeFlowPending_(1)
@@ -168,6 +168,18 @@ public:
     /// @return an executor service.
     virtual Service *get_service() = 0;
 
+    /// Selects the service on which a new port shall run its own flows (the
+    /// read and write flows of a socket port). Hubs that distribute their
+    /// output ports across multiple executors will return a different service
+    /// for different ports; the default is the hub's own service. Must be
+    /// called before register_port() for the same port.
+    /// @param port the downstream port that is being created.
+    /// @return an executor service.
+    virtual Service *get_port_service(DirectHubPort<T> *port)
+    {
+        return get_service();
+    }
+
     /// Adds a port to this hub. This port will be receiving all further
     /// messages.
     /// @param port the downstream port.
@@ -205,6 +217,22 @@ typedef DirectHubInterface<uint8_t[]> ByteDirectHubInterface;
 /// Creates a new byte stream typed hub.
 ByteDirectHubInterface *create_hub(ExecutorBase *e);
 
+/// Creates a new byte stream typed hub that shards its output ports across
+/// multiple executors. Entry to the hub is serialized the same way as for
+/// create_hub(), but the fan-out to the output ports, and the read/write flows
+/// of ports created by create_port_for_fd(), run on the shard executors. The
+/// payload buffers are shared between the shards (no copy is made), and
+/// messages from the same source arrive in order at every port. A caller of
+/// enqueue_send() that has to wait for the hub is resumed by calling its
+/// notify(), so that a StateFlow runs on its own executor; other Executables
+/// must override notify() to schedule themselves.
+/// @param e executor on which the hub's own service runs.
+/// @param shard_executors array of num_shards executors, one for each shard.
+/// Ownership is retained by the caller. The executors must outlive the hub.
+/// @param num_shards number of entries in shard_executors, must be > 0.
+ByteDirectHubInterface *create_sharded_hub(ExecutorBase *e,
+    ExecutorBase *const *shard_executors, unsigned num_shards);
+
 /// Creates a hub port of byte stream type reading/writing a given fd. This
 /// port will be automaticelly deleted upon any error reading/writing the fd
 /// (unregistered and memory released).
@@ -1,52 +1,6 @@
 #include "utils/test_main.hxx"
 
-// We have to avoid pulling in freertos stuff. We redefine the base class to
-// avoid dependency on hand-written fileio stuff.
-#define _FREERTOS_DRIVERS_COMMON_EEPROM_HXX_
-
-class EEPROM
-{
-public:
-    /// Constructor.
-    ///
-    /// @param name The name of the device node in the filesystem, e.g.
-    /// /dev/eeprom
-    /// @param file_size how many bytes are in the eeprom (real or emulated).
-    ///
-    EEPROM(const char *name, size_t file_size)
-        : fileSize(file_size)
-    {
-    }
-
-    /// Override this function to write data to the eeprom. Has to function
-    /// synchronously.
-    ///
-    /// @param index offset where to write data to inside the file.
-    /// [0..file_size).
-    /// @param buf data to write
-    /// @param len how many bytes to write
-    ///
-    virtual void write(unsigned int index, const void *buf, size_t len) = 0;
-
-    /// Override this function to read data from the eeprom. Has to function
-    /// synchronously.
-    ///
-    /// @param index offset where to read data from inside the file.
-    /// [0..file_size).
-    /// @param buf where to read data to
-    /// @param len how many bytes to read
-    ///
-    virtual void read(unsigned int index, void *buf, size_t len) = 0;
-
-    /// @return the eeprom size.
-    size_t file_size()
-    {
-        return fileSize;
-    }
-
-private:
-    size_t fileSize; ///< size of the eeprom.
-};
+#include "utils/EEPROMTestStub.hxx"
 
 // Terrible hack to test internals of the eeprom emulation.
 #define private public
@@ -32,6 +32,7 @@
  * @date 26 May 2016
  */
 
+#include <string.h>
 #include <string>
 
 #include "utils/GcStreamParser.hxx"
@@ -54,6 +55,7 @@ bool GcStreamParser::consume_byte(char c)
         // Frame ends here.
         cbuf_[offset_] = 0;
         offset_ = -1;
+        frame_ = cbuf_;
         return true;
     }
     if (offset_ >= static_cast<int>(sizeof(cbuf_) - 1))
@@ -75,15 +77,77 @@ bool GcStreamParser::consume_byte(char c)
     return false;
 }
 
+bool GcStreamParser::consume_data(
+    const char *data, size_t len, size_t *consumed)
+{
+    const char *p = data;
+    const char *end = data + len;
+    while (p < end)
+    {
+        if (offset_ < 0)
+        {
+            // Drop bytes to the floor until a frame starts.
+            p = static_cast<const char *>(memchr(p, ':', end - p));
+            if (!p)
+            {
+                break;
+            }
+            ++p;
+            offset_ = 0;
+            continue;
+        }
+        const char *semi = static_cast<const char *>(memchr(p, ';', end - p));
+        const char *stop = semi ? semi : end;
+        // Another ':' before the end restarts the frame.
+        while (const char *colon =
+                   static_cast<const char *>(memchr(p, ':', stop - p)))
+        {
+            p = colon + 1;
+            offset_ = 0;
+        }
+        size_t n = stop - p;
+        if (offset_ + n > sizeof(cbuf_) - 1)
+        {
+            // We overran the buffer, so this can't be a valid frame.
+            // Reset and look for sync byte again.
+            offset_ = -1;
+            p = stop;
+            continue;
+        }
+        if (!semi)
+        {
+            memcpy(cbuf_ + offset_, p, n);
+            offset_ += n;
+            break;
+        }
+        if (offset_ == 0)
+        {
+            // Entire frame is in the caller's buffer.
+            frame_ = p;
+        }
+        else
+        {
+            memcpy(cbuf_ + offset_, p, n);
+            cbuf_[offset_ + n] = 0;
+            frame_ = cbuf_;
+        }
+        offset_ = -1;
+        *consumed = semi + 1 - data;
+        return true;
+    }
+    *consumed = len;
+    return false;
+}
+
 void GcStreamParser::frame_buffer(std::string* payload) {
     if (offset_ >= 0) {
         payload->assign(cbuf_, offset_);
     } else {
-        payload->assign(cbuf_);
+        payload->assign(frame_, strcspn(frame_, ";"));
     }
 }
 
 bool GcStreamParser::parse_frame_to_output(struct can_frame* output_frame) {
-    int ret = gc_format_parse(cbuf_, output_frame);
+    int ret = gc_format_parse(frame_, output_frame);
     return (ret == 0);
 }
@@ -49,6 +49,7 @@ class GcStreamParser
 public:
     GcStreamParser()
         : offset_(-1)
+        , frame_(cbuf_)
     {
     }
 
@@ -56,6 +57,19 @@ public:
      * internal buffer contains a complete frame. @param c next character. */
     bool consume_byte(char c);
 
+    /** Adds a chunk of characters from the source stream. Scans for the frame
+     * delimiters with memchr instead of going byte by byte, and stops after
+     * the first complete frame. A frame that is entirely inside the chunk is
+     * not copied; in this case data has to stay alive until
+     * parse_frame_to_output() or frame_buffer() is called.
+     *
+     * @param data next characters from the stream.
+     * @param len number of characters in data.
+     * @param consumed will be set to the number of characters used up. If a
+     * frame was found, this is the offset after the terminating ';'.
+     * @return true if a complete frame was found. */
+    bool consume_data(const char *data, size_t len, size_t *consumed);
+
     /** Parses the current contents of the frame buffer to a can_frame
      * struct. Should be called if and inly if the previous consume_char call
      * returned true.
@@ -74,6 +88,10 @@ private:
     char cbuf_[32];
     /// offset of next byte in cbuf to write.
     int offset_;
+    /// Beginning of the last complete frame (after the ':'), terminated by
+    /// ';' or 0. Points either to cbuf_ or into the data of the last
+    /// consume_data call.
+    const char *frame_;
 };
 
 #endif // _UTILS_GCSTREAMPARSER_HXX_
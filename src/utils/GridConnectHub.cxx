@@ -291,15 +291,17 @@ public:
         /// frames. @return next state.
         Action parse_more_data()
         {
-            while (inBufSize_--)
+            size_t consumed;
+            bool complete =
+                streamSegmenter_.consume_data(inBuf_, inBufSize_, &consumed);
+            inBuf_ += consumed;
+            inBufSize_ -= consumed;
+            if (complete)
             {
-                char c = *inBuf_++;
-                if (streamSegmenter_.consume_byte(c))
-                {
-                    // End of frame. Allocate an output buffer and parse the
-                    // frame.
-                    return allocate_and_call(destination_, STATE(parse_to_output_frame), frameAllocator_.get());
-                }
+                // End of frame. Allocate an output buffer and parse the
+                // frame. The frame may point into the incoming buffer, which
+                // we hold until all of it is processed.
+                return allocate_and_call(destination_, STATE(parse_to_output_frame), frameAllocator_.get());
             }
             // Will notify the caller.
             return release_and_exit();
@@ -42,6 +42,7 @@
 
 class PipeBuffer;
 class PipeMember;
+class HubDeviceSelectBatchReadFlow;
 
 /// Container for an arbitrary structure to pass through a Hub.
 template<class S> class StructContainer : public S {
@@ -168,6 +169,18 @@ public:
     {
         this->register_handler(port, reinterpret_cast<uintptr_t>(port),
                                POINTER_MASK);
+        port_added(port);
+    }
+
+    /// Adds a new port that receives the messages without copying them. All
+    /// shared ports get a reference to the same buffer. @param port is the
+    /// object to add. It must be a StateFlow, and must not modify the
+    /// messages it receives. See DispatchFlow::register_shared_handler.
+    void register_shared_port(port_type *port)
+    {
+        this->register_shared_handler(port, reinterpret_cast<uintptr_t>(port),
+                                      POINTER_MASK);
+        port_added(port);
     }
 
     /// Removes a previously added port. @param port is the port to remove.
@@ -175,6 +188,19 @@ public:
     {
         this->unregister_handler(port, reinterpret_cast<uintptr_t>(port),
                                  POINTER_MASK);
+        port_removed(port);
+    }
+
+protected:
+    /// Called after a port was registered. @param port is the new port.
+    virtual void port_added(port_type *port)
+    {
+    }
+
+    /// Called after a port was unregistered. Hubs that keep per-port state
+    /// can override this to clean it up. @param port is the removed port.
+    virtual void port_removed(port_type *port)
+    {
     }
 };
 
@@ -251,6 +277,7 @@ public:
 protected:
     // For barrier_.
     template <class HFlow> friend class HubDeviceSelectReadFlow;
+    friend class HubDeviceSelectBatchReadFlow;
     friend class openlcb::FdToTcpParser;
 
     /// Constructor
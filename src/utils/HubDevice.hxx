@@ -299,7 +299,7 @@ public:
         , writeFlow_(this)
         , readThread_(this)
     {
-        hub_->register_port(&writeFlow_);
+        hub_->register_shared_port(&writeFlow_);
     }
 
     ~FdHubPort() OVERRIDE
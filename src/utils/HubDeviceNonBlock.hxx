@@ -64,7 +64,7 @@ public:
         , writeFlow_(this)
     {
         HASSERT(fd_ >= 0);
-        hub_->register_port(write_port());
+        hub_->register_shared_port(write_port());
     }
 
     virtual ~HubDeviceNonBlock()
@@ -283,6 +283,75 @@ private:
     typename HFlow::port_type *skipMember_;
 };
 
+/// State flow implementing select-aware fd writes. Writes each buffer with
+/// a separate write call.
+template <class HFlow>
+class HubDeviceSelectWriteFlow
+    : public StateFlow<typename HFlow::buffer_type, QList<1>>
+{
+public:
+    /// Base stateflow for the WriteFlow.
+    typedef StateFlow<typename HFlow::buffer_type, QList<1>> WriteFlowBase;
+
+    /// Constructor. @param dev is the parent object.
+    HubDeviceSelectWriteFlow(FdHubPortService *dev)
+        : WriteFlowBase(dev)
+    {
+    }
+
+    /// Destructor.
+    ~HubDeviceSelectWriteFlow()
+    {
+        HASSERT(this->is_waiting());
+    }
+
+    /// Unregisters this object from the flows.
+    void shutdown()
+    {
+        // The fd must be set to negative already to ensure the shutdown
+        // completes successfully.
+        HASSERT(device()->fd() < 0);
+        auto* e = this->service()->executor();
+        if (!selectHelper_.is_empty() && e->is_selected(&selectHelper_)) {
+            e->unselect(&selectHelper_);
+            // will make the internal_try_write exit immediately
+            selectHelper_.remaining_ = 0;
+            // actually wake up the flow
+            this->notify();
+        }
+    }
+
+    /// @return parent object.
+    FdHubPortService *device()
+    {
+        return static_cast<FdHubPortService *>(this->service());
+    }
+
+    StateFlowBase::Action entry() OVERRIDE
+    {
+        if (device()->fd() < 0) {
+            return this->release_and_exit();
+        }
+        return this->write_repeated(&selectHelper_, device()->fd(),
+            this->message()->data()->data(),
+            this->message()->data()->size(), STATE(write_done),
+            this->priority());
+    }
+
+    /// State flow call. @return next state.
+    StateFlowBase::Action write_done()
+    {
+        if (selectHelper_.hasError_) {
+            device()->report_write_error();
+        }
+        return this->release_and_exit();
+    }
+
+private:
+    /// Helper class for asynchronous writes.
+    StateFlowBase::StateFlowSelectHelper selectHelper_{this};
+};
+
 /// HubPort that connects a select-aware device to a strongly typed Hub.
 ///
 /// The device is given by either the path to the device or the fd to an opened
@@ -294,10 +363,17 @@ private:
 /// hub: for string-typed hubs in 64 bytes units; for hubs of specific
 /// structures (such as CAN frame, dcc Packets or dcc Feedback structures) in
 /// the units ofthe size of the structure.
-template <class HFlow, class ReadFlow = HubDeviceSelectReadFlow<HFlow>>
+///
+/// The ReadFlow and WriteFlow arguments allow replacing how the data is moved
+/// between the fd and the hub (e.g. a protocol parser, or batched syscalls).
+template <class HFlow, class ReadFlow = HubDeviceSelectReadFlow<HFlow>,
+    class WriteFlowT = HubDeviceSelectWriteFlow<HFlow>>
 class HubDeviceSelect : public FdHubPortService, private Atomic
 {
 public:
+    /// State flow writing the data to the fd.
+    typedef WriteFlowT WriteFlow;
+
 #ifndef __WINNT__
     /// Creates a select-aware hub port for the device specified by `path'.
     HubDeviceSelect(
@@ -312,7 +388,7 @@ public:
         barrier_.reset(
             on_error ? on_error : EmptyNotifiable::DefaultInstance());
         barrier_.new_child();
-        hub_->register_port(write_port());
+        hub_->register_shared_port(write_port());
         isRegistered_ = true;
     }
 #endif
@@ -325,7 +401,7 @@ public:
     /// @param on_error notifiable that will be called when a write or read
     /// error is encountered.
     HubDeviceSelect(HFlow *hub, int fd, Notifiable *on_error = nullptr)
-        : FdHubPortService(hub->service()->executor(), fd)
+        : FdHubPortService(hub->service()->executor(), set_nonblocking(fd))
         , hub_(hub)
         , readFlow_(this, hub, &writeFlow_)
         , writeFlow_(this)
@@ -334,14 +410,24 @@ public:
         barrier_.reset(
             on_error ? on_error : EmptyNotifiable::DefaultInstance());
         barrier_.new_child();
+        hub_->register_shared_port(write_port());
+        isRegistered_ = true;
+    }
+
+    /// Switches an fd to non-blocking mode. This has to happen before the
+    /// read flow is started, otherwise its first read might block the
+    /// executor.
+    /// @param fd file descriptor
+    /// @return fd
+    static int set_nonblocking(int fd)
+    {
 #ifdef __WINNT__
         unsigned long par = 1;
-        ioctlsocket(fd_, FIONBIO, &par);
+        ioctlsocket(fd, FIONBIO, &par);
 #else
         ::fcntl(fd, F_SETFL, O_RDWR | O_NONBLOCK);
 #endif
-        hub_->register_port(write_port());
-        isRegistered_ = true;
+        return fd;
     }
 
     /// If the barrier has not been called yet, will notify it inline.
@@ -408,72 +494,6 @@ public:
         return writeFlow_.is_waiting();
     }
 
-protected:
-    /// Base stateflow for the WriteFlow.
-    typedef StateFlow<typename HFlow::buffer_type, QList<1>> WriteFlowBase;
-    /// State flow implementing select-aware fd writes.
-    class WriteFlow : public WriteFlowBase
-    {
-    public:
-        /// Constructor. @param dev is the parent object.
-        WriteFlow(HubDeviceSelect *dev)
-            : WriteFlowBase(dev)
-        {
-        }
-
-        /// Destructor.
-        ~WriteFlow()
-        {
-            HASSERT(this->is_waiting());
-        }
-
-        /// Unregisters this object from the flows.
-        void shutdown()
-        {
-            // The fd must be set to negative already to ensure the shutdown
-            // completes successfully.
-            HASSERT(device()->fd() < 0);
-            auto* e = this->service()->executor();
-            if (!selectHelper_.is_empty() && e->is_selected(&selectHelper_)) {
-                e->unselect(&selectHelper_);
-                // will make the internal_try_write exit immediately
-                selectHelper_.remaining_ = 0;
-                // actually wake up the flow
-                this->notify();
-            }
-        }
-
-        /// @return parent object.
-        HubDeviceSelect *device()
-        {
-            return static_cast<HubDeviceSelect *>(this->service());
-        }
-
-        StateFlowBase::Action entry() OVERRIDE
-        {
-            if (device()->fd() < 0) {
-                return this->release_and_exit();
-            }
-            return this->write_repeated(&selectHelper_, device()->fd(),
-                this->message()->data()->data(),
-                this->message()->data()->size(), STATE(write_done),
-                this->priority());
-        }
-
-        /// State flow call. @return next state.
-        StateFlowBase::Action write_done()
-        {
-            if (selectHelper_.hasError_) {
-                device()->report_write_error();
-            }
-            return this->release_and_exit();
-        }
-
-    private:
-        /// Helper class for asynchronous writes.
-        StateFlowBase::StateFlowSelectHelper selectHelper_{this};
-    };
-
 protected:
 
     /** The assumption here is that the write flow still has entries in its
@@ -0,0 +1,419 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file HubDeviceSelectBatch.hxx
+ * Read and write flows for HubDeviceSelect that move many CAN frames per
+ * system call using recvmmsg and sendmmsg.
+ *
+ * @author Balazs Racz
+ * @date 17 Oct 2026
+ */
+
+#ifndef _UTILS_HUBDEVICESELECTBATCH_HXX_
+#define _UTILS_HUBDEVICESELECTBATCH_HXX_
+
+#include "utils/HubDeviceSelect.hxx"
+
+#if defined(OPENMRN_FEATURE_EXECUTOR_SELECT) && defined(__linux__)
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+
+/// Read flow for CAN frame-typed HubDeviceSelect ports that drains up to
+/// BATCH_SIZE frames from the fd with one recvmmsg call. Needs an fd that
+/// preserves message boundaries, such as a SocketCan socket (one frame per
+/// datagram).
+class HubDeviceSelectBatchReadFlow : public StateFlowBase
+{
+public:
+    /// Buffer type.
+    typedef CanHubFlow::buffer_type buffer_type;
+
+    /// Maximum number of frames read in one system call.
+    static constexpr unsigned BATCH_SIZE = 16;
+
+    /// Constructor.
+    ///
+    /// @param device parent object.
+    /// @param dst where to send the frames read.
+    /// @param skip_member source port designation for the frames read.
+    HubDeviceSelectBatchReadFlow(FdHubPortService *device,
+        CanHubFlow::port_type *dst, CanHubFlow::port_type *skip_member)
+        : StateFlowBase(device)
+        , dst_(dst)
+        , skipMember_(skip_member)
+    {
+        for (unsigned i = 0; i < BATCH_SIZE; ++i)
+        {
+            iov_[i].iov_base = &frames_[i];
+            iov_[i].iov_len = sizeof(frames_[i]);
+            memset(&msgs_[i], 0, sizeof(msgs_[i]));
+            msgs_[i].msg_hdr.msg_iov = &iov_[i];
+            msgs_[i].msg_hdr.msg_iovlen = 1;
+        }
+        this->start_flow(STATE(try_read));
+    }
+
+    /// Turns on or off throttling the incoming frames via a limited pool. A
+    /// CAN port does not throttle by default.
+    /// @param should_throttle true to use a limited pool.
+    void set_limit_input(bool should_throttle)
+    {
+        int limit = hubdevice_incoming_packet_limit();
+        if (should_throttle && limit < 1000000 && !inputPool_)
+        {
+            inputPool_.reset(new LimitedPool(sizeof(buffer_type), limit));
+        }
+    }
+
+    /// Unregisters the current flow from the hub. Must be called on the main
+    /// executor.
+    void shutdown()
+    {
+        auto *e = this->service()->executor();
+        if (e->is_selected(&selectHelper_))
+        {
+            e->unselect(&selectHelper_);
+        }
+        set_terminated();
+        notify_barrier();
+    }
+
+    /// @return the parent object.
+    FdHubPortService *device()
+    {
+        return static_cast<FdHubPortService *>(this->service());
+    }
+
+    /// @return how many recvmmsg calls were made.
+    unsigned syscall_count()
+    {
+        return numSyscalls_;
+    }
+
+    /// @return how many frames were read.
+    unsigned frame_count()
+    {
+        return numFrames_;
+    }
+
+private:
+    /// Reads as many frames as are available, up to BATCH_SIZE. @return next
+    /// state.
+    Action try_read()
+    {
+        ++numSyscalls_;
+        int count = ::recvmmsg(
+            device()->fd(), msgs_, BATCH_SIZE, MSG_DONTWAIT, nullptr);
+        if (count > 0)
+        {
+            numRead_ = count;
+            nextFrame_ = 0;
+            for (int i = 0; i < count; ++i)
+            {
+                if (msgs_[i].msg_len == 0)
+                {
+                    // End of file; the kernel reports it as empty messages.
+                    numRead_ = i;
+                    eof_ = true;
+                    break;
+                }
+            }
+            return call_immediately(STATE(forward_frames));
+        }
+        if (count < 0 &&
+            (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        {
+            selectHelper_.reset(
+                Selectable::READ, device()->fd(), Selectable::MAX_PRIO);
+            selectHelper_.set_wakeup(this);
+            service()->executor()->select(&selectHelper_);
+            return wait_and_call(STATE(try_read));
+        }
+        return call_immediately(STATE(read_error));
+    }
+
+    /// Shuts down the port after the read has failed. @return next state.
+    Action read_error()
+    {
+        set_terminated();
+        device()->report_read_error();
+        notify_barrier();
+        return exit();
+    }
+
+    /// Sends the frames we have read to the hub. @return next state.
+    Action forward_frames()
+    {
+        while (nextFrame_ < numRead_)
+        {
+            if (msgs_[nextFrame_].msg_len != sizeof(struct can_frame))
+            {
+                // Not a classic CAN frame, e.g. a CAN-FD frame arriving
+                // truncated.
+                ++nextFrame_;
+                continue;
+            }
+            if (inputPool_)
+            {
+                return allocate_and_call(
+                    dst_, STATE(frame_allocated), inputPool_.get());
+            }
+            send_frame(dst_->alloc());
+        }
+        if (eof_)
+        {
+            return call_immediately(STATE(read_error));
+        }
+        // Lets other flows run before we read the next batch.
+        return yield_and_call(STATE(try_read));
+    }
+
+    /// Called when the limited pool gave us a buffer. @return next state.
+    Action frame_allocated()
+    {
+        send_frame(get_allocation_result(dst_));
+        return call_immediately(STATE(forward_frames));
+    }
+
+    /// Fills in a buffer with the next frame read and sends it to the hub.
+    /// @param b empty buffer.
+    void send_frame(buffer_type *b)
+    {
+        b->data()->skipMember_ = skipMember_;
+        *b->data()->mutable_frame() = frames_[nextFrame_++];
+        ++numFrames_;
+        dst_->send(b, 0);
+    }
+
+    /** Calls into the parent flow's barrier notify, but makes sure to
+     * only do this once in the lifetime of *this. */
+    void notify_barrier()
+    {
+        if (barrierOwned_)
+        {
+            barrierOwned_ = false;
+            device()->barrier_.notify();
+        }
+    }
+
+    /// true iff pending parent->barrier_.notify()
+    bool barrierOwned_ {true};
+    /// true if the last recvmmsg has seen the end of the stream.
+    bool eof_ {false};
+    /// Number of frames in frames_ from the last recvmmsg.
+    uint8_t numRead_ {0};
+    /// Next frame in frames_ to forward to the hub.
+    uint8_t nextFrame_ {0};
+    /// Statistics: number of read calls.
+    unsigned numSyscalls_ {0};
+    /// Statistics: number of frames read.
+    unsigned numFrames_ {0};
+    /// Helper object for waiting for the fd to become readable.
+    StateFlowSelectHelper selectHelper_ {this};
+    /// Throttling input helper.
+    std::unique_ptr<LimitedPool> inputPool_;
+    /// Where do we forward the messages we created.
+    CanHubFlow::port_type *dst_;
+    /// What should be the source port designation.
+    CanHubFlow::port_type *skipMember_;
+    /// Frames being read.
+    struct can_frame frames_[BATCH_SIZE];
+    /// Scatter-gather entries pointing to frames_.
+    struct iovec iov_[BATCH_SIZE];
+    /// Message headers for recvmmsg.
+    struct mmsghdr msgs_[BATCH_SIZE];
+};
+
+/// Write flow for CAN frame-typed HubDeviceSelect ports. Takes the frames
+/// queued up for the port (up to BATCH_SIZE) and writes them with one sendmmsg
+/// call. Frames are written in the order they were queued.
+class HubDeviceSelectBatchWriteFlow : public CanHubPort
+{
+public:
+    /// Buffer type.
+    typedef CanHubFlow::buffer_type buffer_type;
+
+    /// Maximum number of frames written in one system call.
+    static constexpr unsigned BATCH_SIZE = 16;
+
+    /// Constructor. @param dev is the parent object.
+    HubDeviceSelectBatchWriteFlow(FdHubPortService *dev)
+        : CanHubPort(dev)
+    {
+        for (unsigned i = 0; i < BATCH_SIZE; ++i)
+        {
+            memset(&msgs_[i], 0, sizeof(msgs_[i]));
+            msgs_[i].msg_hdr.msg_iov = &iov_[i];
+            msgs_[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+
+    /// Destructor.
+    ~HubDeviceSelectBatchWriteFlow()
+    {
+        HASSERT(this->is_waiting());
+    }
+
+    /// Unregisters this object from the flows.
+    void shutdown()
+    {
+        // The fd must be set to negative already to ensure the shutdown
+        // completes successfully.
+        HASSERT(device()->fd() < 0);
+        auto *e = this->service()->executor();
+        if (!selectHelper_.is_empty() && e->is_selected(&selectHelper_))
+        {
+            e->unselect(&selectHelper_);
+            // try_write will see the closed fd and exit.
+            this->notify();
+        }
+    }
+
+    /// @return parent object.
+    FdHubPortService *device()
+    {
+        return static_cast<FdHubPortService *>(this->service());
+    }
+
+    /// @return how many sendmmsg calls were made.
+    unsigned syscall_count()
+    {
+        return numSyscalls_;
+    }
+
+    /// @return how many frames were written.
+    unsigned frame_count()
+    {
+        return numFrames_;
+    }
+
+    Action entry() override
+    {
+        if (device()->fd() < 0)
+        {
+            return release_and_exit();
+        }
+        batch_[0] = message();
+        numBatch_ = 1;
+        {
+            // Takes the frames queued behind the current one.
+            AtomicHolder h(this);
+            while (numBatch_ < BATCH_SIZE)
+            {
+                unsigned prio;
+                QMember *m = queue_next(&prio);
+                if (!m)
+                {
+                    break;
+                }
+                batch_[numBatch_++] = static_cast<buffer_type *>(
+                    MulticastEntry::resolve(static_cast<BufferBase *>(m)));
+            }
+        }
+        for (unsigned i = 0; i < numBatch_; ++i)
+        {
+            iov_[i].iov_base = batch_[i]->data()->data();
+            iov_[i].iov_len = batch_[i]->data()->size();
+        }
+        numSent_ = 0;
+        return call_immediately(STATE(try_write));
+    }
+
+private:
+    /// Writes the frames that are not yet sent. @return next state.
+    Action try_write()
+    {
+        if (device()->fd() < 0)
+        {
+            return call_immediately(STATE(write_done));
+        }
+        ++numSyscalls_;
+        int count = ::sendmmsg(device()->fd(), msgs_ + numSent_,
+            numBatch_ - numSent_, MSG_DONTWAIT);
+        if (count > 0)
+        {
+            numSent_ += count;
+            numFrames_ += count;
+            if (numSent_ < numBatch_)
+            {
+                return again();
+            }
+            return call_immediately(STATE(write_done));
+        }
+        if (count < 0 &&
+            (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        {
+            selectHelper_.reset(
+                Selectable::WRITE, device()->fd(), this->priority());
+            selectHelper_.set_wakeup(this);
+            service()->executor()->select(&selectHelper_);
+            return wait_and_call(STATE(try_write));
+        }
+        device()->report_write_error();
+        return call_immediately(STATE(write_done));
+    }
+
+    /// Releases all the buffers of the batch. @return next state.
+    Action write_done()
+    {
+        for (unsigned i = 1; i < numBatch_; ++i)
+        {
+            batch_[i]->unref();
+        }
+        numBatch_ = 0;
+        return release_and_exit();
+    }
+
+    /// Number of entries in batch_.
+    uint8_t numBatch_ {0};
+    /// How many entries of batch_ were written successfully.
+    uint8_t numSent_ {0};
+    /// Statistics: number of write calls.
+    unsigned numSyscalls_ {0};
+    /// Statistics: number of frames written.
+    unsigned numFrames_ {0};
+    /// Helper object for waiting for the fd to become writable.
+    StateFlowBase::StateFlowSelectHelper selectHelper_ {this};
+    /// Buffers being written. The first one is message().
+    buffer_type *batch_[BATCH_SIZE];
+    /// Scatter-gather entries pointing to the payloads in batch_.
+    struct iovec iov_[BATCH_SIZE];
+    /// Message headers for sendmmsg.
+    struct mmsghdr msgs_[BATCH_SIZE];
+};
+
+/// HubDeviceSelect port for CAN frame-typed hubs that uses one system call
+/// for many frames in both directions. Usage is the same as
+/// HubDeviceSelect<CanHubFlow>, e.g. with a fd from socketcan_open().
+typedef HubDeviceSelect<CanHubFlow, HubDeviceSelectBatchReadFlow,
+    HubDeviceSelectBatchWriteFlow>
+    HubDeviceSelectCanBatch;
+
+#endif // OPENMRN_FEATURE_EXECUTOR_SELECT && __linux__
+
+#endif // _UTILS_HUBDEVICESELECTBATCH_HXX_
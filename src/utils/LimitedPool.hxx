@@ -37,6 +37,8 @@
 #ifndef _UTILS_LIMITEDPOOL_HXX_
 #define _UTILS_LIMITEDPOOL_HXX_
 
+#include <algorithm>
+
 #include "utils/Buffer.hxx"
 
 /// Implementation of a Pool interface that takes memory from mainBufferPool
@@ -56,11 +58,53 @@ public:
     LimitedPool(
         unsigned entry_size, unsigned entry_count, Pool *base_pool = nullptr)
         : itemSize_(entry_size)
+        , entryCount_(entry_count)
         , freeCount_(entry_count)
         , basePool_(base_pool)
     {
     }
 
+    /// Changes the maximum number of buffers that can be allocated at the
+    /// same time. If the new limit is below the number of buffers currently
+    /// allocated, further allocations are blocked until enough of them get
+    /// freed.
+    /// @param entry_count new max number of buffers.
+    void set_entry_count(unsigned entry_count)
+    {
+        Q woken;
+        {
+            AtomicHolder h(this);
+            if (entry_count >= entryCount_)
+            {
+                unsigned added = entry_count - entryCount_;
+                unsigned paid = std::min(added, (unsigned)debt_);
+                debt_ -= paid;
+                freeCount_ += added - paid;
+                while (freeCount_ > 0 && !waitingQueue_.empty())
+                {
+                    --freeCount_;
+                    woken.insert(waitingQueue_.next().item);
+                }
+            }
+            else
+            {
+                unsigned removed = entryCount_ - entry_count;
+                unsigned taken = std::min(removed, (unsigned)freeCount_);
+                freeCount_ -= taken;
+                debt_ += removed - taken;
+            }
+            entryCount_ = entry_count;
+        }
+        while (!woken.empty())
+        {
+            auto *flow = static_cast<Executable *>(woken.next().item);
+            BufferBase *b = base_pool()->alloc_untyped(itemSize_, nullptr);
+            HASSERT(b);
+            b->pool_ = this;
+            flow->alloc_result(b);
+        }
+    }
+
     /// Number of free items in the pool.
     size_t free_items() override
     {
@@ -114,10 +158,19 @@ protected:
         Executable *waiting = NULL;
         {
             AtomicHolder h(this);
-            waiting = static_cast<Executable *>(waitingQueue_.next().item);
-            if (!waiting)
+            if (debt_)
+            {
+                // The limit was lowered; this buffer is not given out again.
+                --debt_;
+            }
+            else
             {
-                ++freeCount_;
+                waiting =
+                    static_cast<Executable *>(waitingQueue_.next().item);
+                if (!waiting)
+                {
+                    ++freeCount_;
+                }
             }
         }
         if (waiting)
@@ -143,8 +196,13 @@ private:
 
     /// How many bytes each entry should be.
     uint16_t itemSize_;
+    /// Max number of entries allocated at the same time.
+    uint16_t entryCount_;
     /// How many entries can still be allocated.
     uint16_t freeCount_;
+    /// How many entries have to be freed before the allocation count gets
+    /// below the (lowered) limit.
+    uint16_t debt_ {0};
     /// Where to allocate memory from.
     Pool *basePool_;
     /// Async allocators waiting for free buffers.
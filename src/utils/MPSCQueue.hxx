@@ -0,0 +1,331 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file MPSCQueue.hxx
+ * Lock-free multiple-producer single-consumer queues of QMembers.
+ *
+ * @author Balazs Racz
+ * @date 17 Oct 2026
+ */
+
+#ifndef _UTILS_MPSCQUEUE_HXX_
+#define _UTILS_MPSCQUEUE_HXX_
+
+#include <atomic>
+
+#include "utils/QMember.hxx"
+#include "utils/Queue.hxx"
+#include "utils/macros.h"
+
+/** Intrusive lock-free queue with any number of producer threads and a single
+ * consumer thread. Uses the next pointer of the QMember, so it does not need
+ * any memory allocation, and can hold the same objects as a Q.
+ *
+ * Inserting is wait-free (one atomic exchange). Taking the next entry must
+ * always happen on the same thread, or be externally serialized.
+ *
+ * There is a short window while a producer is inserting during which the
+ * entries inserted by other producers after it are not visible to the
+ * consumer yet. The consumer is expected to be woken up by the producer after
+ * the insert call returns, so this never causes an entry to be lost. The
+ * empty() call reflects this: it returns false only after the insertion is
+ * complete.
+ *
+ * This is the algorithm by Dmitry Vyukov, with a stub node that is part of
+ * the queue object. */
+class MPSCQueue
+{
+public:
+    /// Constructor. Creates an empty queue.
+    MPSCQueue()
+        : head_(&stub_)
+        , tail_(&stub_)
+        , count_(0)
+    {
+    }
+
+    /** Add an item to the back of the queue. May be called from any thread.
+     * @param item to add to queue
+     * @param index unused parameter
+     */
+    void insert(QMember *item, unsigned index = 0)
+    {
+        HASSERT(item->next == nullptr);
+        push(item);
+        count_.fetch_add(1, std::memory_order_release);
+    }
+
+    /** Add an item to the back of the queue. Same as insert, since there is
+     * no lock to hold.
+     * @param item to add to queue
+     * @param index unused parameter
+     */
+    void insert_locked(QMember *item, unsigned index = 0)
+    {
+        insert(item, index);
+    }
+
+    /** Get an item from the front of the queue. Must be called on the
+     * consumer thread.
+     * @return @ref Result structure with item retrieved from queue, NULL if
+     *         no item available
+     */
+    Result next()
+    {
+        QMember *tail = tail_;
+        QMember *next = load_next(tail);
+        if (tail == &stub_)
+        {
+            if (!next)
+            {
+                return Result();
+            }
+            // Skips the stub.
+            tail_ = next;
+            tail = next;
+            next = load_next(next);
+        }
+        if (next)
+        {
+            return take(tail, next);
+        }
+        if (tail != head_.load(std::memory_order_acquire))
+        {
+            // A producer is in the middle of adding after tail.
+            return Result();
+        }
+        // Tail is the last entry. Puts the stub back so that we can detach
+        // the tail.
+        push(&stub_);
+        next = load_next(tail);
+        if (next)
+        {
+            return take(tail, next);
+        }
+        return Result();
+    }
+
+    /** Get an item from the front of the queue. Same as next().
+     * @return @ref Result structure with item retrieved from queue, NULL if
+     *         no item available
+     */
+    Result next_locked()
+    {
+        return next();
+    }
+
+    /** Get the number of pending items in the queue.
+     * @return number of pending items in the queue
+     */
+    size_t pending()
+    {
+        int count = count_.load(std::memory_order_acquire);
+        return count > 0 ? count : 0;
+    }
+
+    /** Test if the queue is empty. May be called from any thread.
+     * @return true if empty, else false
+     */
+    bool empty()
+    {
+        return count_.load(std::memory_order_acquire) <= 0;
+    }
+
+private:
+    /// Helper class to be able to construct a QMember.
+    class Stub : public QMember
+    {
+    };
+
+    /// Links an entry to the end of the queue.
+    /// @param item entry to add.
+    void push(QMember *item)
+    {
+        __atomic_store_n(&item->next, nullptr, __ATOMIC_RELAXED);
+        QMember *prev = head_.exchange(item, std::memory_order_acq_rel);
+        __atomic_store_n(&prev->next, item, __ATOMIC_RELEASE);
+    }
+
+    /// @return the next pointer of an entry, as written by a producer.
+    /// @param item entry in the queue.
+    static QMember *load_next(QMember *item)
+    {
+        return __atomic_load_n(&item->next, __ATOMIC_ACQUIRE);
+    }
+
+    /// Removes the front entry.
+    /// @param tail the front entry.
+    /// @param next the entry after tail.
+    /// @return result to return from next().
+    Result take(QMember *tail, QMember *next)
+    {
+        tail_ = next;
+        tail->next = nullptr;
+        count_.fetch_sub(1, std::memory_order_relaxed);
+        return Result(tail, 0);
+    }
+
+    /// Last entry in the queue. Producers swap themselves in here.
+    std::atomic<QMember *> head_;
+    /// First entry in the queue. Accessed only by the consumer.
+    QMember *tail_;
+    /// Number of completely inserted entries. May be temporarily negative,
+    /// when the consumer takes an entry before its producer got to counting
+    /// it.
+    std::atomic<int> count_;
+    /// Placeholder entry, which is in the queue when it is empty.
+    Stub stub_;
+
+    DISALLOW_COPY_AND_ASSIGN(MPSCQueue);
+};
+
+/** A list of lock-free queues with priorities. Index 0 is the highest
+ * priority. This is a drop-in replacement for a QList as long as there is only
+ * one thread taking entries from the queue. */
+template <unsigned ITEMS> class MPSCQList
+{
+public:
+    /// Constructor.
+    MPSCQList()
+    {
+    }
+
+    typedef ::Result Result;
+
+    /** Add an item to the back of the queue. May be called from any thread.
+     * @param item to add to queue
+     * @param index in the list to operate on
+     */
+    void insert(QMember *item, unsigned index)
+    {
+        if (index >= ITEMS)
+        {
+            index = ITEMS - 1;
+        }
+        list_[index].insert(item);
+    }
+
+    /** Add an item to the back of the queue. Same as insert.
+     * @param item to add to queue
+     * @param index in the list to operate on
+     */
+    void insert_locked(QMember *item, unsigned index)
+    {
+        insert(item, index);
+    }
+
+    /** Get an item from the front of the queue queue in priority order. Must
+     * be called on the consumer thread.
+     * @return item retrieved from queue + index, NULL if no item available
+     */
+    Result next()
+    {
+        for (unsigned i = 0; i < ITEMS; ++i)
+        {
+            // Skips the queues that have nothing to take. This is cheaper
+            // than next() on an empty queue.
+            if (list_[i].empty())
+            {
+                continue;
+            }
+            QMember *result = list_[i].next().item;
+            if (result)
+            {
+                return Result(result, i);
+            }
+        }
+        return Result();
+    }
+
+    /** Get an item from the front of the queue queue in priority order. Same
+     * as next().
+     * @return item retrieved from queue + index, NULL if no item available
+     */
+    Result next_locked()
+    {
+        return next();
+    }
+
+    /** Get the number of pending items in the queue.
+     * @param index in the list to operate on
+     * @return number of pending items in the queue
+     */
+    size_t pending(unsigned index)
+    {
+        return list_[index].pending();
+    }
+
+    /** Test if one of the queues is empty.
+     * @param index in the list to operate on
+     * @return true if empty, else false
+     */
+    bool empty(unsigned index)
+    {
+        return list_[index].empty();
+    }
+
+    /** Get the total number of pending items in all queues in the list.
+     * @return number of total pending items in all queues in the list
+     */
+    size_t pending()
+    {
+        size_t result = 0;
+        for (unsigned i = 0; i < ITEMS; ++i)
+        {
+            result += list_[i].pending();
+        }
+        return result;
+    }
+
+    /// @return how many entries are enqueued right now (across all lists).
+    size_t size()
+    {
+        return pending();
+    }
+
+    /** Test if all the queues are empty. May be called from any thread.
+     * @return true if empty (all lists), else false
+     */
+    bool empty()
+    {
+        for (unsigned i = 0; i < ITEMS; ++i)
+        {
+            if (!list_[i].empty())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    /// The queues, one per priority band.
+    MPSCQueue list_[ITEMS];
+
+    DISALLOW_COPY_AND_ASSIGN(MPSCQList);
+};
+
+#endif // _UTILS_MPSCQUEUE_HXX_
@@ -68,6 +68,10 @@ protected:
     friend class Q;
     /** This class is a helper of SimpleQueue */
     friend class SimpleQueue;
+    /** This class is a helper of MPSCQueue */
+    friend class MPSCQueue;
+    /** DynamicPool keeps lists of free buffers in the thread caches. */
+    friend class DynamicPool;
     /** ActiveTimers needs to iterate through the queue. */
     friend class ActiveTimers;
     /** ActiveTimers needs to iterate through the queue. */
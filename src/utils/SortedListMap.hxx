@@ -162,13 +162,34 @@ private:
     /// Reestablishes sorted order in case anything was inserted or removed.
     void lazy_init()
     {
-        if (sortedCount_ != container_.size())
+        if (sortedCount_ >= container_.size())
         {
-            sort(container_.begin(), container_.end(), cmp_);
+            // Removing entries keeps the order.
             sortedCount_ = container_.size();
+            return;
+        }
+        if (container_.size() - sortedCount_ > MAX_INCREMENTAL_INSERT)
+        {
+            sort(container_.begin(), container_.end(), cmp_);
         }
+        else
+        {
+            // Typically one entry was added since the last lookup. Moving it
+            // to its place is linear, as opposed to sorting everything.
+            for (size_t i = sortedCount_; i < container_.size(); ++i)
+            {
+                auto it = container_.begin() + i;
+                auto pos = std::upper_bound(container_.begin(), it, *it, cmp_);
+                std::rotate(pos, it, it + 1);
+            }
+        }
+        sortedCount_ = container_.size();
     }
 
+    /// If more entries than this were added since the last lookup, we sort
+    /// the entire container instead of inserting them one by one.
+    static constexpr size_t MAX_INCREMENTAL_INSERT = 8;
+
     /// Holds the actual data elements.
     container_type container_;
 
@@ -165,6 +165,14 @@ DEFAULT_CONST(directhub_port_incoming_buffer_size, 1460);
 // drain.
 DEFAULT_CONST(directhub_port_max_incoming_packets, 2);
 
+/// How many shared buffer references can be waiting in queues at the same
+/// time. When these run out, hubs fall back to copying the buffers.
+DEFAULT_CONST(multicast_entry_pool_size, 32);
+
+/// Per-thread free buffer caches in the main buffer pool are off by default.
+/// Multi-threaded hubs can enable them to reduce lock contention.
+DEFAULT_CONST(buffer_pool_thread_cache_size, 0);
+
 #ifdef ESP_PLATFORM
 /// Use a stack size of 3kb for SocketListener tasks.
 DEFAULT_CONST(socket_listener_stack_size, 3072);